@@ -0,0 +1,297 @@
+#include <CD/Common/AllocationTracker.hpp>
+#include <CD/Common/Debug.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace CD::Memory {
+
+namespace {
+
+enum AllocationCounter : std::uint8_t {
+	AllocationCounter_Allocations,
+	AllocationCounter_Frees,
+	AllocationCounter_AllocatedBytes,
+	AllocationCounter_FreedBytes,
+	AllocationCounter_Count
+};
+
+using Counters = std::atomic<std::uint64_t>[MemoryTag_Count][AllocationCounter_Count];
+
+const char* tag_names[MemoryTag_Count] {
+	"Untagged",
+	"Graphics",
+	"RenderQueue",
+	"Upload",
+	"GPU",
+	"Loader",
+	"Jobs",
+	"Profiler"
+};
+
+Counters total_counters;
+Counters frame_counters;
+std::atomic<std::uint64_t> steady_state_violations;
+
+std::atomic<std::uint32_t> frame_index;
+std::atomic<std::uint32_t> steady_state_frame;
+std::atomic<bool> steady_state;
+std::atomic<std::uint32_t> suspended_checks;
+
+std::mutex frame_stats_mutex;
+AllocationStats frame_stats;
+
+thread_local MemoryTag thread_tag = MemoryTag_Untagged;
+thread_local std::uint32_t no_allocation_depth = 0;
+thread_local bool reporting = false;
+
+void read_counters(Counters& counters, AllocationStats& stats, bool reset) {
+	stats.total = {};
+	for(std::size_t tag = 0; tag < MemoryTag_Count; ++tag) {
+		std::uint64_t values[AllocationCounter_Count];
+		for(std::size_t counter = 0; counter < AllocationCounter_Count; ++counter) {
+			values[counter] = reset ?
+				counters[tag][counter].exchange(0, std::memory_order_relaxed) :
+				counters[tag][counter].load(std::memory_order_relaxed);
+		}
+
+		AllocationCounters& tag_stats = stats.tags[tag];
+		tag_stats.allocations = values[AllocationCounter_Allocations];
+		tag_stats.frees = values[AllocationCounter_Frees];
+		tag_stats.allocated_bytes = values[AllocationCounter_AllocatedBytes];
+		tag_stats.freed_bytes = values[AllocationCounter_FreedBytes];
+
+		stats.total.allocations += tag_stats.allocations;
+		stats.total.frees += tag_stats.frees;
+		stats.total.allocated_bytes += tag_stats.allocated_bytes;
+		stats.total.freed_bytes += tag_stats.freed_bytes;
+	}
+}
+
+}
+
+void record_allocation(MemoryTag tag, std::size_t num_bytes) {
+	total_counters[tag][AllocationCounter_Allocations].fetch_add(1, std::memory_order_relaxed);
+	total_counters[tag][AllocationCounter_AllocatedBytes].fetch_add(num_bytes, std::memory_order_relaxed);
+	frame_counters[tag][AllocationCounter_Allocations].fetch_add(1, std::memory_order_relaxed);
+	frame_counters[tag][AllocationCounter_AllocatedBytes].fetch_add(num_bytes, std::memory_order_relaxed);
+
+	if(no_allocation_depth && !reporting && steady_state.load(std::memory_order_relaxed) && !suspended_checks.load(std::memory_order_relaxed)) {
+		reporting = true;
+		steady_state_violations.fetch_add(1, std::memory_order_relaxed);
+		CD_FAIL("heap allocation inside a steady-state frame");
+		reporting = false;
+	}
+}
+
+void record_free(MemoryTag tag, std::size_t num_bytes) {
+	total_counters[tag][AllocationCounter_Frees].fetch_add(1, std::memory_order_relaxed);
+	total_counters[tag][AllocationCounter_FreedBytes].fetch_add(num_bytes, std::memory_order_relaxed);
+	frame_counters[tag][AllocationCounter_Frees].fetch_add(1, std::memory_order_relaxed);
+	frame_counters[tag][AllocationCounter_FreedBytes].fetch_add(num_bytes, std::memory_order_relaxed);
+}
+
+const char* get_tag_name(MemoryTag tag) {
+	CD_ASSERT(tag < MemoryTag_Count);
+	return tag_names[tag];
+}
+
+MemoryTag get_thread_tag() {
+	return thread_tag;
+}
+
+MemoryTag set_thread_tag(MemoryTag tag) {
+	MemoryTag previous = thread_tag;
+	thread_tag = tag;
+	return previous;
+}
+
+void begin_frame() {
+	AllocationStats stats {};
+	stats.frame = frame_index.fetch_add(1, std::memory_order_relaxed);
+	stats.steady_state_violations = steady_state_violations.load(std::memory_order_relaxed);
+	read_counters(frame_counters, stats, true);
+
+	{
+		std::lock_guard lock(frame_stats_mutex);
+		frame_stats = stats;
+	}
+
+	std::uint32_t first_steady_frame = steady_state_frame.load(std::memory_order_relaxed);
+	steady_state.store(first_steady_frame && stats.frame + 1 >= first_steady_frame, std::memory_order_relaxed);
+}
+
+void set_steady_state_frame(std::uint32_t frame) {
+	steady_state_frame.store(frame, std::memory_order_relaxed);
+	steady_state.store(frame && frame_index.load(std::memory_order_relaxed) >= frame, std::memory_order_relaxed);
+}
+
+bool is_steady_state() {
+	return steady_state.load(std::memory_order_relaxed);
+}
+
+void begin_no_allocation_scope() {
+	++no_allocation_depth;
+}
+
+void end_no_allocation_scope() {
+	CD_ASSERT(no_allocation_depth > 0);
+	--no_allocation_depth;
+}
+
+void suspend_no_allocation_checks() {
+	suspended_checks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void resume_no_allocation_checks() {
+	CD_ASSERT(suspended_checks.load(std::memory_order_relaxed) > 0);
+	suspended_checks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+AllocationStats get_frame_stats() {
+	std::lock_guard lock(frame_stats_mutex);
+	return frame_stats;
+}
+
+AllocationStats get_total_stats() {
+	AllocationStats stats {};
+	stats.frame = frame_index.load(std::memory_order_relaxed);
+	stats.steady_state_violations = steady_state_violations.load(std::memory_order_relaxed);
+	read_counters(total_counters, stats, false);
+	return stats;
+}
+
+}
+
+#if CD_ALLOCATION_TRACKING
+
+namespace {
+
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+	std::size_t num_bytes;
+	std::uint32_t offset;
+	CD::Memory::MemoryTag tag;
+};
+
+void* tracked_allocate(std::size_t num_bytes, std::size_t alignment) {
+	alignment = alignment < alignof(AllocationHeader) ? alignof(AllocationHeader) : alignment;
+
+	void* memory = std::malloc(num_bytes + sizeof(AllocationHeader) + alignment - 1);
+	if(!memory) {
+		return nullptr;
+	}
+
+	std::uintptr_t base = reinterpret_cast<std::uintptr_t>(memory);
+	std::uintptr_t address = CD::align(base + sizeof(AllocationHeader), alignment);
+
+	AllocationHeader* header = reinterpret_cast<AllocationHeader*>(address) - 1;
+	header->num_bytes = num_bytes;
+	header->offset = static_cast<std::uint32_t>(address - base);
+	header->tag = CD::Memory::get_thread_tag();
+
+	CD::Memory::record_allocation(header->tag, num_bytes);
+	return reinterpret_cast<void*>(address);
+}
+
+void* tracked_allocate_or_throw(std::size_t num_bytes, std::size_t alignment) {
+	void* memory = tracked_allocate(num_bytes, alignment);
+	if(!memory) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void tracked_free(void* memory) {
+	if(!memory) {
+		return;
+	}
+
+	AllocationHeader* header = static_cast<AllocationHeader*>(memory) - 1;
+	CD::Memory::record_free(header->tag, header->num_bytes);
+	std::free(static_cast<std::uint8_t*>(memory) - header->offset);
+}
+
+}
+
+void* operator new(std::size_t num_bytes) {
+	return tracked_allocate_or_throw(num_bytes, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t num_bytes) {
+	return tracked_allocate_or_throw(num_bytes, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t num_bytes, const std::nothrow_t&) noexcept {
+	return tracked_allocate(num_bytes, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t num_bytes, const std::nothrow_t&) noexcept {
+	return tracked_allocate(num_bytes, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t num_bytes, std::align_val_t alignment) {
+	return tracked_allocate_or_throw(num_bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t num_bytes, std::align_val_t alignment) {
+	return tracked_allocate_or_throw(num_bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t num_bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return tracked_allocate(num_bytes, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t num_bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return tracked_allocate(num_bytes, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+	tracked_free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+	tracked_free(memory);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <CD/Common/Common.hpp>
+
+#ifndef CD_ALLOCATION_TRACKING
+#define CD_ALLOCATION_TRACKING 0
+#endif
+
+namespace CD::Memory {
+
+enum MemoryTag : std::uint8_t {
+	MemoryTag_Untagged,
+	MemoryTag_Graphics,
+	MemoryTag_RenderQueue,
+	MemoryTag_Upload,
+	MemoryTag_GPU,
+	MemoryTag_Loader,
+	MemoryTag_Jobs,
+	MemoryTag_Profiler,
+	MemoryTag_Count
+};
+
+struct AllocationCounters {
+	std::uint64_t allocations;
+	std::uint64_t frees;
+	std::uint64_t allocated_bytes;
+	std::uint64_t freed_bytes;
+};
+
+struct AllocationStats {
+	std::uint32_t frame;
+	std::uint64_t steady_state_violations;
+	AllocationCounters total;
+	AllocationCounters tags[MemoryTag_Count];
+};
+
+const char* get_tag_name(MemoryTag);
+
+MemoryTag get_thread_tag();
+MemoryTag set_thread_tag(MemoryTag);
+
+void begin_frame();
+void set_steady_state_frame(std::uint32_t frame);
+bool is_steady_state();
+
+void begin_no_allocation_scope();
+void end_no_allocation_scope();
+
+// Work that knowingly allocates inside frames, such as a capture in progress, suspends the no-allocation checks on every
+// thread until it resumes them. The allocations are still counted.
+void suspend_no_allocation_checks();
+void resume_no_allocation_checks();
+
+AllocationStats get_frame_stats();
+AllocationStats get_total_stats();
+
+class ScopedMemoryTag {
+public:
+	ScopedMemoryTag(MemoryTag tag) :
+		previous(set_thread_tag(tag)) {
+	}
+
+	~ScopedMemoryTag() {
+		set_thread_tag(previous);
+	}
+
+	ScopedMemoryTag(const ScopedMemoryTag&) = delete;
+	ScopedMemoryTag& operator=(const ScopedMemoryTag&) = delete;
+private:
+	MemoryTag previous;
+};
+
+class NoAllocationScope {
+public:
+	NoAllocationScope() {
+		begin_no_allocation_scope();
+	}
+
+	~NoAllocationScope() {
+		end_no_allocation_scope();
+	}
+
+	NoAllocationScope(const NoAllocationScope&) = delete;
+	NoAllocationScope& operator=(const NoAllocationScope&) = delete;
+};
+
+}
+
+#define CD_MEMORY_CONCAT_IMPL(a, b) a##b
+#define CD_MEMORY_CONCAT(a, b) CD_MEMORY_CONCAT_IMPL(a, b)
+
+#if CD_ALLOCATION_TRACKING
+#define CD_MEMORY_TAG(tag) ::CD::Memory::ScopedMemoryTag CD_MEMORY_CONCAT(memory_tag_, __LINE__)(::CD::Memory::tag)
+#define CD_NO_ALLOCATION_SCOPE() ::CD::Memory::NoAllocationScope CD_MEMORY_CONCAT(no_allocation_scope_, __LINE__)
+#define CD_MEMORY_FRAME() ::CD::Memory::begin_frame()
+#else
+#define CD_MEMORY_TAG(tag) (void)0
+#define CD_NO_ALLOCATION_SCOPE() (void)0
+#define CD_MEMORY_FRAME() (void)0
+#endif
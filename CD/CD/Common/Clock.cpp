@@ -1,23 +1,147 @@
 #include <CD/Common/Clock.hpp>
-#include <profileapi.h>
+#include <thread>
+#ifdef _WIN32
+#include <Windows.h>
+#include <immintrin.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace CD {
 
+static void spin_pause() {
+#if defined(_WIN32) || defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
 Clock::Clock() {
-	LARGE_INTEGER frequency;
-	::QueryPerformanceFrequency(&frequency);
-	frequency_inv = 1000. / frequency.QuadPart;
 	reset();
 }
 
 void Clock::reset() {
-	::QueryPerformanceCounter(&start);
+	start = SourceClock::now();
 }
 
 double Clock::get_elapsed_time_ms() {
-	LARGE_INTEGER ticks;
-	::QueryPerformanceCounter(&ticks);
-	return (ticks.QuadPart - start.QuadPart) * frequency_inv;
+	return std::chrono::duration<double, std::milli>(SourceClock::now() - start).count();
+}
+
+FrameLimiter::FrameLimiter(double target_frame_ms) :
+	target_ns(),
+	next_deadline(),
+	last_wake(),
+	spin_ns(min_spin_ns * 5),
+	stats(),
+	timer() {
+#ifdef _WIN32
+	timer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+	set_target_frame_time(target_frame_ms);
 }
 
-}
\ No newline at end of file
+FrameLimiter::~FrameLimiter() {
+#ifdef _WIN32
+	if(timer) {
+		::CloseHandle(timer);
+	}
+#endif
+}
+
+void FrameLimiter::set_target_frame_time(double target_frame_ms) {
+	target_ns = target_frame_ms > 0. ? static_cast<std::uint64_t>(target_frame_ms * 1e6) : 0;
+	reset();
+}
+
+void FrameLimiter::reset() {
+	next_deadline = 0;
+	last_wake = 0;
+	stats = {};
+	stats.target_ms = target_ns / 1e6;
+}
+
+void FrameLimiter::wait() {
+	std::uint64_t now = Clock::timestamp_ns();
+	if(!target_ns) {
+		record_frame(now);
+		return;
+	}
+
+	if(!next_deadline) {
+		next_deadline = now + target_ns;
+		last_wake = now;
+		return;
+	}
+
+	if(now < next_deadline) {
+		if(next_deadline - now > spin_ns) {
+			sleep_until(next_deadline - spin_ns);
+		}
+		while((now = Clock::timestamp_ns()) < next_deadline) {
+			spin_pause();
+		}
+	}
+
+	record_frame(now);
+
+	next_deadline += target_ns;
+	if(now > next_deadline) {
+		next_deadline = now + target_ns;
+		++stats.resyncs;
+	}
+}
+
+void FrameLimiter::sleep_until(std::uint64_t deadline) {
+	std::uint64_t sleep_begin = Clock::timestamp_ns();
+	if(deadline <= sleep_begin) {
+		return;
+	}
+
+	std::uint64_t duration = deadline - sleep_begin;
+#ifdef _WIN32
+	if(timer) {
+		LARGE_INTEGER due_time;
+		due_time.QuadPart = -static_cast<LONGLONG>(duration / 100);
+		if(::SetWaitableTimerEx(timer, &due_time, 0, nullptr, nullptr, nullptr, 0)) {
+			::WaitForSingleObject(timer, INFINITE);
+		}
+	}
+	else {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(duration));
+	}
+#else
+	std::this_thread::sleep_for(std::chrono::nanoseconds(duration));
+#endif
+
+	std::uint64_t wake = Clock::timestamp_ns();
+	std::uint64_t oversleep = wake > deadline ? wake - deadline : 0;
+	std::uint64_t target_spin = oversleep * 2 < min_spin_ns ? min_spin_ns : oversleep * 2 > max_spin_ns ? max_spin_ns : oversleep * 2;
+	spin_ns = target_spin > spin_ns ? target_spin : spin_ns - (spin_ns - target_spin) / 16;
+}
+
+void FrameLimiter::record_frame(std::uint64_t wake) {
+	if(last_wake) {
+		double frame_ms = (wake - last_wake) / 1e6;
+		double error_ms = target_ns ? frame_ms - stats.target_ms : 0.;
+		double abs_error_ms = error_ms < 0. ? -error_ms : error_ms;
+
+		if(stats.frames) {
+			stats.average_ms += (frame_ms - stats.average_ms) * stats_weight;
+			stats.jitter_ms += (abs_error_ms - stats.jitter_ms) * stats_weight;
+		}
+		else {
+			stats.average_ms = frame_ms;
+			stats.jitter_ms = abs_error_ms;
+		}
+		stats.max_error_ms = abs_error_ms > stats.max_error_ms ? abs_error_ms : stats.max_error_ms;
+		++stats.frames;
+	}
+	last_wake = wake;
+}
+
+}
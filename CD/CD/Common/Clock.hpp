@@ -1,20 +1,76 @@
 #pragma once
 
 #include <CD/Common/Common.hpp>
-#include <windows.h>
+#include <chrono>
 
 namespace CD {
 
 class Clock {
 public:
+	using SourceClock = std::chrono::steady_clock;
+
 	Clock();
 
 	void reset();
 
 	double get_elapsed_time_ms();
+
+	static std::uint64_t timestamp_ns();
 private:
-	LARGE_INTEGER start;
-	double frequency_inv;
+	SourceClock::time_point start;
 };
 
+struct FramePacingStats {
+	double target_ms;
+	double average_ms;
+	double jitter_ms;
+	double max_error_ms;
+	std::uint64_t frames;
+	std::uint64_t resyncs;
+};
+
+class FrameLimiter {
+public:
+	FrameLimiter(double target_frame_ms = 0.);
+	~FrameLimiter();
+
+	FrameLimiter(const FrameLimiter&) = delete;
+	FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+	void set_target_frame_time(double target_frame_ms);
+	double get_target_frame_time() const;
+
+	void wait();
+	void reset();
+
+	const FramePacingStats& get_stats() const;
+private:
+	static constexpr std::uint64_t min_spin_ns = 200000;
+	static constexpr std::uint64_t max_spin_ns = 4000000;
+	static constexpr double stats_weight = .05;
+
+	std::uint64_t target_ns;
+	std::uint64_t next_deadline;
+	std::uint64_t last_wake;
+	std::uint64_t spin_ns;
+
+	FramePacingStats stats;
+	void* timer;
+
+	void sleep_until(std::uint64_t deadline);
+	void record_frame(std::uint64_t wake);
+};
+
+inline double FrameLimiter::get_target_frame_time() const {
+	return target_ns / 1e6;
+}
+
+inline const FramePacingStats& FrameLimiter::get_stats() const {
+	return stats;
+}
+
+inline std::uint64_t Clock::timestamp_ns() {
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(SourceClock::now().time_since_epoch()).count());
+}
+
 }
\ No newline at end of file
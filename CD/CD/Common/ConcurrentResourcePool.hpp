@@ -0,0 +1,189 @@
+#pragma once
+
+#include <CD/Common/ResourcePool.hpp>
+#include <atomic>
+#include <memory>
+
+namespace CD {
+
+template<typename ResourceType>
+class ConcurrentResourcePool {
+public:
+	ConcurrentResourcePool(std::uint32_t page_size = 1024);
+	~ConcurrentResourcePool();
+
+	ConcurrentResourcePool(const ConcurrentResourcePool&) = delete;
+	ConcurrentResourcePool& operator=(const ConcurrentResourcePool&) = delete;
+
+	std::uint32_t add(const ResourceType&);
+	template<typename T> void remove(T handle);
+	template<typename T> ResourceType& get(T handle);
+	template<typename T> bool is_valid(T handle) const;
+
+	std::uint32_t size() const;
+	std::uint32_t capacity() const;
+private:
+	struct Slot {
+		ResourceType resource;
+		std::atomic<std::uint32_t> generation;
+		std::atomic<std::uint32_t> next_free;
+	};
+
+	std::unique_ptr<std::atomic<Slot*>[]> pages;
+	std::uint32_t max_pages;
+	std::uint32_t page_shift;
+	std::uint32_t page_mask;
+
+	std::atomic<std::uint64_t> free_head;
+	std::atomic<std::uint32_t> offset;
+	std::atomic<std::uint32_t> count;
+	std::atomic<std::uint32_t> page_count;
+
+	static constexpr std::uint64_t free_head_value(std::uint32_t index, std::uint32_t tag);
+
+	std::uint32_t pop_free();
+	void push_free(std::uint32_t index);
+	Slot& slot(std::uint32_t index) const;
+	Slot& reserve_slot(std::uint32_t index);
+};
+
+template<typename ResourceType>
+inline ConcurrentResourcePool<ResourceType>::ConcurrentResourcePool(std::uint32_t page_size) :
+	max_pages(),
+	page_shift(),
+	page_mask(page_size - 1),
+	free_head(free_head_value(invalid_resource_index, 0)),
+	offset(),
+	count(),
+	page_count() {
+	CD_ASSERT(is_power_of_two(page_size));
+	while((1u << page_shift) < page_size) {
+		++page_shift;
+	}
+
+	max_pages = (max_resource_pool_size >> page_shift) + 1;
+	pages = std::make_unique<std::atomic<Slot*>[]>(max_pages);
+	for(std::uint32_t i = 0; i < max_pages; ++i) {
+		pages[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+template<typename ResourceType>
+inline ConcurrentResourcePool<ResourceType>::~ConcurrentResourcePool() {
+	for(std::uint32_t i = 0; i < max_pages; ++i) {
+		delete[] pages[i].load(std::memory_order_relaxed);
+	}
+}
+
+template<typename ResourceType>
+inline std::uint32_t ConcurrentResourcePool<ResourceType>::add(const ResourceType& resource) {
+	std::uint32_t index = pop_free();
+	Slot* entry = nullptr;
+	if(index != invalid_resource_index) {
+		entry = &slot(index);
+	}
+	else {
+		index = offset.fetch_add(1, std::memory_order_relaxed);
+		CD_ASSERT(index < max_resource_pool_size);
+		entry = &reserve_slot(index);
+	}
+
+	entry->resource = resource;
+	count.fetch_add(1, std::memory_order_relaxed);
+	return resource_handle(index, entry->generation.load(std::memory_order_relaxed));
+}
+
+template<typename ResourceType>
+template<typename T>
+inline void ConcurrentResourcePool<ResourceType>::remove(T handle) {
+	CD_ASSERT(is_valid(handle));
+	std::uint32_t index = resource_handle_index(static_cast<std::uint32_t>(handle));
+	Slot& entry = slot(index);
+	entry.resource = {};
+	entry.generation.store((entry.generation.load(std::memory_order_relaxed) + 1) & resource_handle_generation_mask, std::memory_order_relaxed);
+	count.fetch_sub(1, std::memory_order_relaxed);
+	push_free(index);
+}
+
+template<typename ResourceType>
+template<typename T>
+inline ResourceType& ConcurrentResourcePool<ResourceType>::get(T handle) {
+	std::uint32_t value = static_cast<std::uint32_t>(handle);
+	Slot& entry = slot(resource_handle_index(value));
+	CD_ASSERT(entry.generation.load(std::memory_order_relaxed) == resource_handle_generation(value));
+	return entry.resource;
+}
+
+template<typename ResourceType>
+template<typename T>
+inline bool ConcurrentResourcePool<ResourceType>::is_valid(T handle) const {
+	std::uint32_t value = static_cast<std::uint32_t>(handle);
+	std::uint32_t index = resource_handle_index(value);
+	// A slot past offset was never reserved, its page may already be installed with the generation still at zero.
+	if(index >= max_resource_pool_size || index >= offset.load(std::memory_order_acquire) || !pages[index >> page_shift].load(std::memory_order_acquire)) {
+		return false;
+	}
+	return slot(index).generation.load(std::memory_order_relaxed) == resource_handle_generation(value);
+}
+
+template<typename ResourceType>
+inline std::uint32_t ConcurrentResourcePool<ResourceType>::size() const {
+	return count.load(std::memory_order_relaxed);
+}
+
+template<typename ResourceType>
+inline std::uint32_t ConcurrentResourcePool<ResourceType>::capacity() const {
+	return page_count.load(std::memory_order_relaxed) << page_shift;
+}
+
+template<typename ResourceType>
+constexpr std::uint64_t ConcurrentResourcePool<ResourceType>::free_head_value(std::uint32_t index, std::uint32_t tag) {
+	return (static_cast<std::uint64_t>(tag) << 32) | index;
+}
+
+template<typename ResourceType>
+inline std::uint32_t ConcurrentResourcePool<ResourceType>::pop_free() {
+	std::uint64_t head = free_head.load(std::memory_order_acquire);
+	while(static_cast<std::uint32_t>(head) != invalid_resource_index) {
+		std::uint32_t index = static_cast<std::uint32_t>(head);
+		std::uint32_t next = slot(index).next_free.load(std::memory_order_relaxed);
+		std::uint32_t tag = static_cast<std::uint32_t>(head >> 32) + 1;
+		if(free_head.compare_exchange_weak(head, free_head_value(next, tag), std::memory_order_acquire, std::memory_order_acquire)) {
+			return index;
+		}
+	}
+	return invalid_resource_index;
+}
+
+template<typename ResourceType>
+inline void ConcurrentResourcePool<ResourceType>::push_free(std::uint32_t index) {
+	Slot& entry = slot(index);
+	std::uint64_t head = free_head.load(std::memory_order_relaxed);
+	do {
+		entry.next_free.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+	} while(!free_head.compare_exchange_weak(head, free_head_value(index, static_cast<std::uint32_t>(head >> 32) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<typename ResourceType>
+inline typename ConcurrentResourcePool<ResourceType>::Slot& ConcurrentResourcePool<ResourceType>::slot(std::uint32_t index) const {
+	return pages[index >> page_shift].load(std::memory_order_acquire)[index & page_mask];
+}
+
+template<typename ResourceType>
+inline typename ConcurrentResourcePool<ResourceType>::Slot& ConcurrentResourcePool<ResourceType>::reserve_slot(std::uint32_t index) {
+	std::atomic<Slot*>& page = pages[index >> page_shift];
+	Slot* current = page.load(std::memory_order_acquire);
+	if(!current) {
+		Slot* created = new Slot[page_mask + 1]();
+		if(page.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			page_count.fetch_add(1, std::memory_order_relaxed);
+			current = created;
+		}
+		else {
+			delete[] created;
+		}
+	}
+	return current[index & page_mask];
+}
+
+}
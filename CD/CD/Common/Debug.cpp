@@ -2,16 +2,24 @@
 #include <codecvt>
 
 #include <sstream>
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <cstdio>
+#endif
 
 namespace CD::Debug {
 
 void error_box(const std::string& message, const char* file, int line, const char* function) {
 	std::stringstream buffer;
 	buffer << message << "\n" << file << "\n" << line << "\n" << function;
+#ifdef _WIN32
 	std::wstring msg(std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(buffer.str()));
 
 	::MessageBoxW(nullptr, msg.c_str(), L"Assertion Failure", MB_ICONERROR);
+#else
+	std::fprintf(stderr, "Assertion Failure\n%s\n", buffer.str().c_str());
+#endif
 }
 
 }
\ No newline at end of file
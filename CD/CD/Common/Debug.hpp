@@ -7,7 +7,15 @@ namespace CD::Debug {
 
 void error_box(const std::string& message, const char* file, int line, const char* function);
 
-#define CD_FAIL(message) (Debug::error_box(message, __FILE__, __LINE__, __FUNCSIG__), __debugbreak())
+#ifdef _MSC_VER
+#define CD_FUNCTION_SIGNATURE __FUNCSIG__
+#define CD_DEBUG_BREAK() __debugbreak()
+#else
+#define CD_FUNCTION_SIGNATURE __PRETTY_FUNCTION__
+#define CD_DEBUG_BREAK() __builtin_trap()
+#endif
+
+#define CD_FAIL(message) (Debug::error_box(message, __FILE__, __LINE__, CD_FUNCTION_SIGNATURE), CD_DEBUG_BREAK())
 
 #define CD_ASSERT_ENABLED
 #ifdef CD_ASSERT_ENABLED
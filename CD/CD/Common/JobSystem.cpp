@@ -0,0 +1,319 @@
+#include <CD/Common/JobSystem.hpp>
+#include <CD/Common/Debug.hpp>
+#include <CD/Common/AllocationTracker.hpp>
+
+namespace CD {
+
+namespace {
+
+thread_local std::uint32_t current_thread_index = invalid_thread_index;
+
+constexpr std::uint32_t job_spin_count = 64;
+
+}
+
+struct JobSystem::Queue {
+	struct Slot {
+		std::atomic<JobFunction> function;
+		std::atomic<void*> data;
+		std::atomic<std::uint64_t> range;
+		std::atomic<JobCounter*> counter;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	alignas(64) std::atomic<std::int64_t> top;
+	alignas(64) std::atomic<std::int64_t> bottom;
+
+	Queue();
+
+	bool push(const Job&);
+	bool pop(Job&);
+	bool steal(Job&);
+
+	void store(std::int64_t index, const Job&);
+	Job load(std::int64_t index) const;
+};
+
+JobSystem::Queue::Queue() :
+	slots(std::make_unique<Slot[]>(job_queue_capacity)),
+	top(),
+	bottom() {
+}
+
+bool JobSystem::Queue::push(const Job& job) {
+	std::int64_t b = bottom.load(std::memory_order_relaxed);
+	std::int64_t t = top.load(std::memory_order_acquire);
+	if(b - t >= static_cast<std::int64_t>(job_queue_capacity)) {
+		return false;
+	}
+
+	store(b, job);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+bool JobSystem::Queue::pop(Job& job) {
+	std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.exchange(b, std::memory_order_seq_cst);
+	std::int64_t t = top.load(std::memory_order_seq_cst);
+
+	if(t > b) {
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	job = load(b);
+	if(t == b) {
+		bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+bool JobSystem::Queue::steal(Job& job) {
+	std::int64_t t = top.load(std::memory_order_seq_cst);
+	std::int64_t b = bottom.load(std::memory_order_seq_cst);
+	if(t >= b) {
+		return false;
+	}
+
+	job = load(t);
+	return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+void JobSystem::Queue::store(std::int64_t index, const Job& job) {
+	Slot& slot = slots[index & (job_queue_capacity - 1)];
+	slot.function.store(job.function, std::memory_order_relaxed);
+	slot.data.store(job.data, std::memory_order_relaxed);
+	slot.range.store((static_cast<std::uint64_t>(job.end) << 32) | job.begin, std::memory_order_relaxed);
+	slot.counter.store(job.counter, std::memory_order_relaxed);
+}
+
+JobSystem::Job JobSystem::Queue::load(std::int64_t index) const {
+	const Slot& slot = slots[index & (job_queue_capacity - 1)];
+	std::uint64_t range = slot.range.load(std::memory_order_relaxed);
+	return {
+		slot.function.load(std::memory_order_relaxed),
+		slot.data.load(std::memory_order_relaxed),
+		static_cast<std::uint32_t>(range),
+		static_cast<std::uint32_t>(range >> 32),
+		slot.counter.load(std::memory_order_relaxed)
+	};
+}
+
+JobSystem::JobSystem(std::uint32_t worker_count) :
+	waiting_jobs(std::make_unique<WaitingJob[]>(max_waiting_jobs)),
+	free_waiting_job(),
+	thread_count(),
+	running(true),
+	queued_jobs(),
+	sleeping_workers() {
+	static_assert(is_power_of_two(job_queue_capacity));
+
+	if(!worker_count) {
+		std::uint32_t hardware_threads = std::thread::hardware_concurrency();
+		worker_count = hardware_threads > 1 ? hardware_threads - 1 : 0;
+	}
+	if(worker_count > max_job_workers - 1) {
+		worker_count = max_job_workers - 1;
+	}
+
+	CD_ASSERT(current_thread_index == invalid_thread_index);
+	current_thread_index = 0;
+
+	for(std::uint32_t i = 0; i < max_waiting_jobs; ++i) {
+		waiting_jobs[i].next = i + 1 < max_waiting_jobs ? i + 1 : invalid_waiting_job;
+	}
+
+	thread_count = worker_count + 1;
+	queues = std::make_unique<Queue[]>(thread_count);
+
+	workers.reserve(worker_count);
+	for(std::uint32_t i = 1; i < thread_count; ++i) {
+		workers.emplace_back(&JobSystem::worker_main, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard lock(sleep_mutex);
+		running.store(false);
+	}
+	wake.notify_all();
+
+	for(auto& worker : workers) {
+		worker.join();
+	}
+
+	current_thread_index = invalid_thread_index;
+}
+
+void JobSystem::run(const JobDesc* jobs, std::uint32_t num_jobs, JobCounter* counter, JobCounter* dependency) {
+	std::uint32_t thread_index = current_thread_index;
+	CD_ASSERT(thread_index < thread_count);
+
+	if(counter) {
+		counter->pending.fetch_add(num_jobs, std::memory_order_relaxed);
+	}
+
+	std::uint32_t first_job = 0;
+	if(dependency) {
+		std::lock_guard lock(dependency_mutex);
+		while(first_job < num_jobs && !dependency->is_done() && free_waiting_job != invalid_waiting_job) {
+			const JobDesc& desc = jobs[first_job++];
+			std::uint32_t index = free_waiting_job;
+			WaitingJob& waiting = waiting_jobs[index];
+			free_waiting_job = waiting.next;
+			waiting.job = {desc.function, desc.data, desc.begin, desc.end, counter};
+			waiting.next = dependency->waiting;
+			dependency->waiting = index;
+		}
+	}
+
+	if(first_job < num_jobs && dependency && !dependency->is_done()) {
+		wait(*dependency);
+	}
+
+	for(std::uint32_t i = first_job; i < num_jobs; ++i) {
+		push(thread_index, {jobs[i].function, jobs[i].data, jobs[i].begin, jobs[i].end, counter});
+	}
+
+	wake_workers(num_jobs - first_job);
+}
+
+void JobSystem::wait(const JobCounter& counter) {
+	std::uint32_t thread_index = current_thread_index;
+	CD_ASSERT(thread_index < thread_count);
+
+	while(!counter.is_done()) {
+		if(!try_execute(thread_index)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+std::uint32_t JobSystem::get_thread_index() {
+	return current_thread_index;
+}
+
+void JobSystem::worker_main(std::uint32_t thread_index) {
+	current_thread_index = thread_index;
+	CD_MEMORY_TAG(MemoryTag_Jobs);
+
+	while(running.load(std::memory_order_relaxed)) {
+		bool found = false;
+		for(std::uint32_t spin = 0; spin < job_spin_count && !found; ++spin) {
+			found = try_execute(thread_index);
+		}
+		if(found) {
+			continue;
+		}
+
+		std::unique_lock lock(sleep_mutex);
+		sleeping_workers.fetch_add(1);
+		wake.wait(lock, [this] { return !running.load() || queued_jobs.load() > 0; });
+		sleeping_workers.fetch_sub(1);
+	}
+}
+
+void JobSystem::push(std::uint32_t thread_index, const Job& job) {
+	queued_jobs.fetch_add(1);
+	if(!queues[thread_index].push(job)) {
+		queued_jobs.fetch_sub(1);
+		execute(job);
+	}
+}
+
+bool JobSystem::find_job(std::uint32_t thread_index, Job& job) {
+	if(queues[thread_index].pop(job)) {
+		return true;
+	}
+
+	for(std::uint32_t i = 1; i < thread_count; ++i) {
+		if(queues[(thread_index + i) % thread_count].steal(job)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::try_execute(std::uint32_t thread_index) {
+	Job job;
+	if(!find_job(thread_index, job)) {
+		return false;
+	}
+	queued_jobs.fetch_sub(1);
+
+	execute(job);
+	return true;
+}
+
+void JobSystem::execute(const Job& job) {
+	job.function(job.data, job.begin, job.end);
+	if(job.counter) {
+		complete_job(*job.counter);
+	}
+}
+
+// A waiter may destroy the counter as soon as it reaches zero, so the last job detaches the waiting list under the
+// dependency lock and only then makes the final decrement. The counter is not touched afterwards.
+void JobSystem::complete_job(JobCounter& counter) {
+	std::uint32_t pending = counter.pending.load(std::memory_order_relaxed);
+	while(pending > 1) {
+		if(counter.pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+
+	std::uint32_t first = invalid_waiting_job;
+	{
+		std::lock_guard lock(dependency_mutex);
+		first = counter.waiting;
+		counter.waiting = invalid_waiting_job;
+		if(counter.pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			counter.waiting = first;
+			return;
+		}
+	}
+
+	if(first == invalid_waiting_job) {
+		return;
+	}
+
+	std::uint32_t thread_index = current_thread_index;
+	std::uint32_t last = first;
+	std::uint32_t num_released = 0;
+	for(std::uint32_t index = first; index != invalid_waiting_job; index = waiting_jobs[index].next) {
+		push(thread_index, waiting_jobs[index].job);
+		last = index;
+		++num_released;
+	}
+
+	{
+		std::lock_guard lock(dependency_mutex);
+		waiting_jobs[last].next = free_waiting_job;
+		free_waiting_job = first;
+	}
+
+	wake_workers(num_released);
+}
+
+void JobSystem::wake_workers(std::uint32_t count) {
+	if(!count || !sleeping_workers.load()) {
+		return;
+	}
+
+	{
+		std::lock_guard lock(sleep_mutex);
+	}
+
+	if(count == 1) {
+		wake.notify_one();
+	}
+	else {
+		wake.notify_all();
+	}
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <CD/Common/Common.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace CD {
+
+constexpr std::uint32_t max_job_workers = 64;
+constexpr std::uint32_t job_queue_capacity = 4096;
+constexpr std::uint32_t max_waiting_jobs = 4096;
+constexpr std::uint32_t invalid_waiting_job = ~0u;
+constexpr std::uint32_t invalid_thread_index = ~0u;
+
+using JobFunction = void(*)(void* data, std::uint32_t begin, std::uint32_t end);
+
+// Jobs that depend on a counter are parked in its waiting list until the counter reaches zero, the job that
+// completes it pushes them to its own queue.
+struct JobCounter {
+	std::atomic<std::uint32_t> pending;
+	std::uint32_t waiting;
+
+	JobCounter();
+	bool is_done() const;
+};
+
+struct JobDesc {
+	JobFunction function;
+	void* data;
+	std::uint32_t begin;
+	std::uint32_t end;
+};
+
+class JobSystem {
+public:
+	JobSystem(std::uint32_t worker_count = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void run(const JobDesc*, std::uint32_t num_jobs, JobCounter*, JobCounter* dependency = nullptr);
+	void wait(const JobCounter&);
+
+	template<typename Function>
+	void parallel_for(std::uint32_t begin, std::uint32_t end, std::uint32_t grain, Function&&);
+
+	std::uint32_t get_thread_count() const;
+	static std::uint32_t get_thread_index();
+private:
+	struct Job {
+		JobFunction function;
+		void* data;
+		std::uint32_t begin;
+		std::uint32_t end;
+		JobCounter* counter;
+	};
+
+	struct WaitingJob {
+		Job job;
+		std::uint32_t next;
+	};
+
+	struct Queue;
+
+	std::unique_ptr<Queue[]> queues;
+	std::unique_ptr<WaitingJob[]> waiting_jobs;
+	std::uint32_t free_waiting_job;
+	std::mutex dependency_mutex;
+	std::vector<std::thread> workers;
+	std::uint32_t thread_count;
+
+	std::atomic<bool> running;
+	std::atomic<std::uint32_t> queued_jobs;
+	std::atomic<std::uint32_t> sleeping_workers;
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+
+	void worker_main(std::uint32_t thread_index);
+	void push(std::uint32_t thread_index, const Job&);
+	bool find_job(std::uint32_t thread_index, Job&);
+	bool try_execute(std::uint32_t thread_index);
+	void execute(const Job&);
+	void complete_job(JobCounter&);
+	void wake_workers(std::uint32_t count);
+};
+
+inline JobCounter::JobCounter() :
+	pending(),
+	waiting(invalid_waiting_job) {
+}
+
+inline bool JobCounter::is_done() const {
+	return pending.load(std::memory_order_acquire) == 0;
+}
+
+inline std::uint32_t JobSystem::get_thread_count() const {
+	return thread_count;
+}
+
+template<typename Function>
+inline void JobSystem::parallel_for(std::uint32_t begin, std::uint32_t end, std::uint32_t grain, Function&& function) {
+	if(begin >= end) {
+		return;
+	}
+
+	std::uint32_t count = end - begin;
+	std::uint32_t max_chunks = job_queue_capacity / 2;
+	grain = grain ? grain : 1;
+	if((count + grain - 1) / grain > max_chunks) {
+		grain = (count + max_chunks - 1) / max_chunks;
+	}
+
+	if(count <= grain || thread_count == 1) {
+		function(begin, end);
+		return;
+	}
+
+	using FunctionType = std::remove_reference_t<Function>;
+	JobFunction trampoline = [](void* data, std::uint32_t chunk_begin, std::uint32_t chunk_end) {
+		(*static_cast<FunctionType*>(data))(chunk_begin, chunk_end);
+	};
+
+	JobCounter counter;
+	JobDesc chunks[64];
+	std::uint32_t num_chunks = 0;
+	for(std::uint32_t chunk_begin = begin; chunk_begin < end; chunk_begin += grain) {
+		std::uint32_t chunk_end = end - chunk_begin > grain ? chunk_begin + grain : end;
+		chunks[num_chunks++] = {trampoline, const_cast<void*>(static_cast<const void*>(&function)), chunk_begin, chunk_end};
+		if(num_chunks == std::size(chunks)) {
+			run(chunks, num_chunks, &counter);
+			num_chunks = 0;
+		}
+	}
+
+	if(num_chunks) {
+		run(chunks, num_chunks, &counter);
+	}
+	wait(counter);
+}
+
+}
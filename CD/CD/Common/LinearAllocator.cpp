@@ -0,0 +1,78 @@
+#include <CD/Common/LinearAllocator.hpp>
+#include <CD/Common/Debug.hpp>
+
+namespace CD {
+
+LinearAllocator::LinearAllocator(std::size_t block_size) :
+	block_size(block_size),
+	current_block(),
+	offset(),
+	allocated_bytes() {
+	add_block(block_size);
+}
+
+void* LinearAllocator::allocate(std::size_t num_bytes, std::size_t alignment) {
+	CD_ASSERT(is_power_of_two(alignment));
+
+	Block* block = &blocks[current_block];
+	std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block->memory.get());
+	std::size_t aligned_offset = align(base + offset, alignment) - base;
+
+	if(aligned_offset + num_bytes > block->size) {
+		do {
+			++current_block;
+		} while(current_block < blocks.size() && blocks[current_block].size < num_bytes + alignment);
+
+		if(current_block == blocks.size()) {
+			add_block(num_bytes + alignment);
+		}
+
+		block = &blocks[current_block];
+		base = reinterpret_cast<std::uintptr_t>(block->memory.get());
+		aligned_offset = align(base, alignment) - base;
+	}
+
+	offset = aligned_offset + num_bytes;
+	allocated_bytes += num_bytes;
+	return block->memory.get() + aligned_offset;
+}
+
+void LinearAllocator::reset() {
+	if(blocks.size() > 1) {
+		std::size_t capacity = get_capacity();
+		blocks.clear();
+		add_block(capacity);
+	}
+
+	current_block = 0;
+	offset = 0;
+	allocated_bytes = 0;
+}
+
+std::size_t LinearAllocator::get_capacity() const {
+	std::size_t capacity = 0;
+	for(const Block& block : blocks) {
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+void LinearAllocator::add_block(std::size_t min_size) {
+	std::size_t size = min_size > block_size ? min_size : block_size;
+	blocks.push_back({std::make_unique<std::uint8_t[]>(size), size});
+}
+
+FrameAllocator::FrameAllocator(std::uint32_t num_frames, std::size_t block_size) :
+	index() {
+	CD_ASSERT(num_frames > 0);
+	for(std::uint32_t i = 0; i < num_frames; ++i) {
+		allocators.emplace_back(std::make_unique<LinearAllocator>(block_size));
+	}
+}
+
+void FrameAllocator::next_frame() {
+	index = (index + 1) % allocators.size();
+	allocators[index]->reset();
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <CD/Common/Common.hpp>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace CD {
+
+class LinearAllocator {
+public:
+	LinearAllocator(std::size_t block_size = 1 << 20);
+
+	LinearAllocator(const LinearAllocator&) = delete;
+	LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+	void* allocate(std::size_t num_bytes, std::size_t alignment = alignof(std::max_align_t));
+	void reset();
+
+	std::size_t get_allocated_bytes() const;
+	std::size_t get_capacity() const;
+private:
+	struct Block {
+		std::unique_ptr<std::uint8_t[]> memory;
+		std::size_t size;
+	};
+
+	std::vector<Block> blocks;
+	std::size_t block_size;
+	std::size_t current_block;
+	std::size_t offset;
+	std::size_t allocated_bytes;
+
+	void add_block(std::size_t min_size);
+};
+
+class FrameAllocator {
+public:
+	FrameAllocator(std::uint32_t num_frames, std::size_t block_size = 1 << 20);
+
+	LinearAllocator& get();
+	void next_frame();
+private:
+	std::vector<std::unique_ptr<LinearAllocator>> allocators;
+	std::uint32_t index;
+};
+
+template<typename T>
+class ArenaAllocator {
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() :
+		arena(nullptr) {
+	}
+
+	ArenaAllocator(LinearAllocator& arena) :
+		arena(&arena) {
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) :
+		arena(other.get_arena()) {
+	}
+
+	T* allocate(std::size_t count) {
+		return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, std::size_t) {
+	}
+
+	LinearAllocator* get_arena() const {
+		return arena;
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const {
+		return arena == other.get_arena();
+	}
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const {
+		return arena != other.get_arena();
+	}
+private:
+	LinearAllocator* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<typename T>
+inline void rebind_arena_vector(ArenaVector<T>& vector, LinearAllocator& arena) {
+	std::size_t count = vector.size();
+	vector = ArenaVector<T>(ArenaAllocator<T>(arena));
+	vector.reserve(count);
+}
+
+inline std::size_t LinearAllocator::get_allocated_bytes() const {
+	return allocated_bytes;
+}
+
+inline LinearAllocator& FrameAllocator::get() {
+	return *allocators[index];
+}
+
+}
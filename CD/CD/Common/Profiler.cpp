@@ -0,0 +1,179 @@
+#include <CD/Common/Profiler.hpp>
+#include <CD/Common/Debug.hpp>
+#include <CD/Common/AllocationTracker.hpp>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace CD::Profiler {
+
+constexpr std::uint32_t frame_marker_depth = ~0u;
+
+struct ThreadBuffer {
+	std::unique_ptr<Event[]> events;
+	std::atomic<std::uint64_t> head;
+	std::uint32_t depth;
+	std::uint32_t thread_id;
+	char name[max_thread_name_length];
+};
+
+namespace {
+
+std::mutex registry_mutex;
+std::unique_ptr<ThreadBuffer> registry[max_profiler_threads];
+std::uint32_t thread_count;
+
+std::atomic<bool> enabled(true);
+std::atomic<std::uint32_t> frame_index;
+const std::uint64_t trace_start = Clock::timestamp_ns();
+
+thread_local ThreadBuffer* thread_buffer = nullptr;
+
+void write_event(ThreadBuffer& buffer, const Event& event) {
+	std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	buffer.events[head & (profiler_buffer_size - 1)] = event;
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void write_string(std::ostream& stream, const char* string) {
+	stream << '"';
+	for(; *string; ++string) {
+		if(*string == '"' || *string == '\\') {
+			stream << '\\';
+		}
+		stream << *string;
+	}
+	stream << '"';
+}
+
+double to_microseconds(std::uint64_t timestamp) {
+	return timestamp >= trace_start ? (timestamp - trace_start) / 1000. : 0.;
+}
+
+}
+
+ThreadBuffer& get_thread_buffer() {
+	if(!thread_buffer) {
+		static_assert(is_power_of_two(profiler_buffer_size));
+		CD_MEMORY_TAG(MemoryTag_Profiler);
+
+		std::lock_guard lock(registry_mutex);
+		CD_ASSERT(thread_count < max_profiler_threads);
+
+		auto& buffer = registry[thread_count];
+		buffer = std::make_unique<ThreadBuffer>();
+		buffer->events = std::make_unique<Event[]>(profiler_buffer_size);
+		buffer->head.store(0, std::memory_order_relaxed);
+		buffer->depth = 0;
+		buffer->thread_id = thread_count;
+		std::snprintf(buffer->name, max_thread_name_length, "Thread %u", thread_count);
+
+		thread_buffer = buffer.get();
+		++thread_count;
+	}
+
+	return *thread_buffer;
+}
+
+std::uint32_t begin_scope(ThreadBuffer& buffer) {
+	return buffer.depth++;
+}
+
+void end_scope(ThreadBuffer& buffer, const char* name, std::uint64_t begin, std::uint32_t frame, std::uint32_t depth) {
+	--buffer.depth;
+	write_event(buffer, {name, begin, Clock::timestamp_ns(), frame, depth});
+}
+
+void set_enabled(bool enable) {
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool is_enabled() {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void set_thread_name(const char* name) {
+	ThreadBuffer& buffer = get_thread_buffer();
+
+	std::lock_guard lock(registry_mutex);
+	std::snprintf(buffer.name, max_thread_name_length, "%s", name);
+}
+
+void begin_frame() {
+	std::uint32_t frame = frame_index.fetch_add(1, std::memory_order_relaxed) + 1;
+	if(is_enabled()) {
+		std::uint64_t timestamp = Clock::timestamp_ns();
+		write_event(get_thread_buffer(), {"Frame", timestamp, timestamp, frame, frame_marker_depth});
+	}
+}
+
+std::uint32_t get_frame_index() {
+	return frame_index.load(std::memory_order_relaxed);
+}
+
+void export_chrome_trace(std::ostream& stream) {
+	std::lock_guard lock(registry_mutex);
+
+	std::vector<Event> events;
+	bool first = true;
+	auto separator = [&]() -> std::ostream& {
+		stream << (first ? "\n" : ",\n");
+		first = false;
+		return stream;
+	};
+
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for(std::uint32_t thread = 0; thread < thread_count; ++thread) {
+		const ThreadBuffer& buffer = *registry[thread];
+
+		separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer.thread_id << ",\"args\":{\"name\":";
+		write_string(stream, buffer.name);
+		stream << "}}";
+
+		std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+		std::uint64_t tail = head > profiler_buffer_size ? head - profiler_buffer_size : 0;
+		events.clear();
+		for(std::uint64_t i = tail; i < head; ++i) {
+			events.push_back(buffer.events[i & (profiler_buffer_size - 1)]);
+		}
+
+		std::uint64_t current_head = buffer.head.load(std::memory_order_acquire);
+		std::uint64_t overwritten = current_head > profiler_buffer_size ? current_head - profiler_buffer_size : 0;
+		std::size_t skip = overwritten > tail ? static_cast<std::size_t>(overwritten - tail) : 0;
+
+		for(std::size_t i = skip; i < events.size(); ++i) {
+			const Event& event = events[i];
+			separator() << "{\"name\":";
+			write_string(stream, event.name);
+			if(event.depth == frame_marker_depth) {
+				stream << ",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":" << buffer.thread_id
+					<< ",\"ts\":" << to_microseconds(event.begin)
+					<< ",\"args\":{\"frame\":" << event.frame << "}}";
+			}
+			else {
+				stream << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer.thread_id
+					<< ",\"ts\":" << to_microseconds(event.begin)
+					<< ",\"dur\":" << (event.end - event.begin) / 1000.
+					<< ",\"args\":{\"frame\":" << event.frame << ",\"depth\":" << event.depth << "}}";
+			}
+		}
+	}
+	stream << "\n]}\n";
+}
+
+bool export_chrome_trace(const char* path) {
+	std::ofstream file(path);
+	if(!file) {
+		return false;
+	}
+
+	file.precision(3);
+	file << std::fixed;
+	export_chrome_trace(file);
+	return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <CD/Common/Clock.hpp>
+#include <ostream>
+
+#ifndef CD_PROFILER_ENABLED
+#define CD_PROFILER_ENABLED 1
+#endif
+
+namespace CD::Profiler {
+
+constexpr std::size_t max_profiler_threads = 64;
+constexpr std::size_t profiler_buffer_size = 1 << 16;
+constexpr std::size_t max_thread_name_length = 32;
+
+struct Event {
+	const char* name;
+	std::uint64_t begin;
+	std::uint64_t end;
+	std::uint32_t frame;
+	std::uint32_t depth;
+};
+
+struct ThreadBuffer;
+
+ThreadBuffer& get_thread_buffer();
+std::uint32_t begin_scope(ThreadBuffer&);
+void end_scope(ThreadBuffer&, const char* name, std::uint64_t begin, std::uint32_t frame, std::uint32_t depth);
+
+void set_enabled(bool);
+bool is_enabled();
+void set_thread_name(const char*);
+
+void begin_frame();
+std::uint32_t get_frame_index();
+
+void export_chrome_trace(std::ostream&);
+bool export_chrome_trace(const char* path);
+
+class ScopedEvent {
+public:
+	ScopedEvent(const char* name);
+	~ScopedEvent();
+
+	ScopedEvent(const ScopedEvent&) = delete;
+	ScopedEvent& operator=(const ScopedEvent&) = delete;
+private:
+	ThreadBuffer* buffer;
+	const char* name;
+	std::uint64_t begin;
+	std::uint32_t frame;
+	std::uint32_t depth;
+};
+
+inline ScopedEvent::ScopedEvent(const char* name) :
+	buffer(is_enabled() ? &get_thread_buffer() : nullptr),
+	name(name),
+	begin(),
+	frame(),
+	depth() {
+	if(buffer) {
+		depth = begin_scope(*buffer);
+		frame = get_frame_index();
+		begin = Clock::timestamp_ns();
+	}
+}
+
+inline ScopedEvent::~ScopedEvent() {
+	if(buffer) {
+		end_scope(*buffer, name, begin, frame, depth);
+	}
+}
+
+}
+
+#define CD_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CD_PROFILE_CONCAT(a, b) CD_PROFILE_CONCAT_IMPL(a, b)
+
+#if CD_PROFILER_ENABLED
+#define CD_PROFILE_SCOPE(name) ::CD::Profiler::ScopedEvent CD_PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define CD_PROFILE_FUNCTION() CD_PROFILE_SCOPE(__func__)
+#define CD_PROFILE_FRAME() ::CD::Profiler::begin_frame()
+#define CD_PROFILE_THREAD(name) ::CD::Profiler::set_thread_name(name)
+#else
+#define CD_PROFILE_SCOPE(name) (void)0
+#define CD_PROFILE_FUNCTION() (void)0
+#define CD_PROFILE_FRAME() (void)0
+#define CD_PROFILE_THREAD(name) (void)0
+#endif
@@ -6,53 +6,138 @@
 
 namespace CD {
 
+constexpr std::uint32_t resource_handle_index_bits = 20;
+constexpr std::uint32_t resource_handle_generation_bits = 32 - resource_handle_index_bits;
+constexpr std::uint32_t resource_handle_index_mask = (1u << resource_handle_index_bits) - 1;
+constexpr std::uint32_t resource_handle_generation_mask = (1u << resource_handle_generation_bits) - 1;
+constexpr std::uint32_t max_resource_pool_size = resource_handle_index_mask;
+constexpr std::uint32_t invalid_resource_index = ~0u;
+
+constexpr std::uint32_t resource_handle(std::uint32_t index, std::uint32_t generation) {
+	return (generation << resource_handle_index_bits) | index;
+}
+
+constexpr std::uint32_t resource_handle_index(std::uint32_t handle) {
+	return handle & resource_handle_index_mask;
+}
+
+constexpr std::uint32_t resource_handle_generation(std::uint32_t handle) {
+	return handle >> resource_handle_index_bits;
+}
+
 template<typename ResourceType>
 class ResourcePool {
 public:
-	ResourcePool(std::size_t size);
+	ResourcePool(std::uint32_t page_size = 1024);
+
+	std::uint32_t add(const ResourceType&);
+	template<typename T> void remove(T handle);
+	template<typename T> ResourceType& get(T handle);
+	template<typename T> bool is_valid(T handle) const;
 
-	std::size_t add(const ResourceType&);
-	void remove(std::size_t index);
-	template<typename T> ResourceType& get(T index);
+	std::uint32_t size() const;
+	std::uint32_t capacity() const;
 private:
-	std::unique_ptr<ResourceType[]> resources;
-	std::vector<std::size_t> release_list;
-	std::size_t offset;
-	std::size_t size;
+	struct Slot {
+		ResourceType resource;
+		std::uint32_t generation;
+		std::uint32_t next_free;
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> pages;
+	std::uint32_t page_shift;
+	std::uint32_t page_mask;
+	std::uint32_t free_head;
+	std::uint32_t offset;
+	std::uint32_t count;
+
+	Slot& slot(std::uint32_t index);
+	const Slot& slot(std::uint32_t index) const;
 };
 
 template<typename ResourceType>
-inline ResourcePool<ResourceType>::ResourcePool(std::size_t size) :
-	resources(std::make_unique<ResourceType[]>(size)),
+inline ResourcePool<ResourceType>::ResourcePool(std::uint32_t page_size) :
+	page_shift(),
+	page_mask(page_size - 1),
+	free_head(invalid_resource_index),
 	offset(),
-	size(size) {
+	count() {
+	CD_ASSERT(is_power_of_two(page_size));
+	while((1u << page_shift) < page_size) {
+		++page_shift;
+	}
 }
 
 template<typename ResourceType>
-inline std::size_t ResourcePool<ResourceType>::add(const ResourceType& resource) {
-	std::size_t index = 0;
-	if(release_list.size()) {
-		index = release_list.front();
-		release_list.pop_back();
+inline std::uint32_t ResourcePool<ResourceType>::add(const ResourceType& resource) {
+	std::uint32_t index = free_head;
+	if(index != invalid_resource_index) {
+		free_head = slot(index).next_free;
 	}
 	else {
-		CD_ASSERT(offset < size);
+		CD_ASSERT(offset < max_resource_pool_size);
 		index = offset;
+		if((index >> page_shift) == pages.size()) {
+			pages.emplace_back(std::make_unique<Slot[]>(page_mask + 1));
+		}
 		++offset;
 	}
-	resources[index] = resource;
-	return index;
+
+	Slot& entry = slot(index);
+	entry.resource = resource;
+	entry.next_free = invalid_resource_index;
+	++count;
+	return resource_handle(index, entry.generation);
+}
+
+template<typename ResourceType>
+template<typename T>
+inline void ResourcePool<ResourceType>::remove(T handle) {
+	CD_ASSERT(is_valid(handle));
+	std::uint32_t index = resource_handle_index(static_cast<std::uint32_t>(handle));
+	Slot& entry = slot(index);
+	entry.resource = {};
+	entry.generation = (entry.generation + 1) & resource_handle_generation_mask;
+	entry.next_free = free_head;
+	free_head = index;
+	--count;
 }
 
 template<typename ResourceType>
-inline void ResourcePool<ResourceType>::remove(std::size_t index) {
-	release_list.push_back(index);
+template<typename T>
+inline ResourceType& ResourcePool<ResourceType>::get(T handle) {
+	std::uint32_t value = static_cast<std::uint32_t>(handle);
+	Slot& entry = slot(resource_handle_index(value));
+	CD_ASSERT(entry.generation == resource_handle_generation(value));
+	return entry.resource;
 }
 
 template<typename ResourceType>
 template<typename T>
-inline ResourceType& ResourcePool<ResourceType>::get(T index) {
-	return resources[static_cast<std::size_t>(index)];
+inline bool ResourcePool<ResourceType>::is_valid(T handle) const {
+	std::uint32_t value = static_cast<std::uint32_t>(handle);
+	std::uint32_t index = resource_handle_index(value);
+	return index < offset && slot(index).generation == resource_handle_generation(value);
+}
+
+template<typename ResourceType>
+inline std::uint32_t ResourcePool<ResourceType>::size() const {
+	return count;
+}
+
+template<typename ResourceType>
+inline std::uint32_t ResourcePool<ResourceType>::capacity() const {
+	return static_cast<std::uint32_t>(pages.size()) << page_shift;
 }
 
-}
\ No newline at end of file
+template<typename ResourceType>
+inline typename ResourcePool<ResourceType>::Slot& ResourcePool<ResourceType>::slot(std::uint32_t index) {
+	return pages[index >> page_shift][index & page_mask];
+}
+
+template<typename ResourceType>
+inline const typename ResourcePool<ResourceType>::Slot& ResourcePool<ResourceType>::slot(std::uint32_t index) const {
+	return pages[index >> page_shift][index & page_mask];
+}
+
+}
@@ -0,0 +1,344 @@
+#include <CD/Common/TransformBatch.hpp>
+#include <CD/Common/Debug.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CD_TRANSFORM_BATCH_SSE
+#include <xmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace CD {
+
+#ifdef CD_TRANSFORM_BATCH_AVX2
+void matrix_transform_batch_avx2(const float* const* components, std::size_t count, float* out);
+void matrix_affine_inverse_batch_avx2(const float* in, std::size_t count, float* out);
+void matrix_multiply_batch_avx2(const float* l, const float* r, std::size_t count, float* out);
+#endif
+
+static bool cpu_supports_avx2() {
+#if defined(CD_TRANSFORM_BATCH_AVX2) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7) {
+		return false;
+	}
+
+	__cpuid(info, 1);
+	bool osxsave = info[2] & (1 << 27);
+	bool avx = info[2] & (1 << 28);
+	if(!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+#elif defined(CD_TRANSFORM_BATCH_AVX2)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+static TransformBatchPath detect_transform_batch_path() {
+	if(cpu_supports_avx2()) {
+		return TransformBatchPath::AVX2;
+	}
+#ifdef CD_TRANSFORM_BATCH_SSE
+	return TransformBatchPath::SSE;
+#else
+	return TransformBatchPath::Scalar;
+#endif
+}
+
+static TransformBatchPath& current_transform_batch_path() {
+	static TransformBatchPath path = detect_transform_batch_path();
+	return path;
+}
+
+TransformBatchPath transform_batch_path() {
+	return current_transform_batch_path();
+}
+
+void set_transform_batch_path(TransformBatchPath path) {
+	TransformBatchPath supported = detect_transform_batch_path();
+	CD_ASSERT(path <= supported);
+	current_transform_batch_path() = path <= supported ? path : supported;
+}
+
+void matrix_transform_batch_scalar(const TransformStreams& streams, std::size_t count, Matrix4x4* out) {
+	const float* const* c = streams.components;
+
+	for(std::size_t i = 0; i < count; ++i) {
+		float x = c[TransformComponent_OrientationX][i];
+		float y = c[TransformComponent_OrientationY][i];
+		float z = c[TransformComponent_OrientationZ][i];
+		float w = c[TransformComponent_OrientationW][i];
+		float sx = c[TransformComponent_ScaleX][i];
+		float sy = c[TransformComponent_ScaleY][i];
+		float sz = c[TransformComponent_ScaleZ][i];
+
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+
+		float (&m)[4][4] = out[i].m;
+		m[0][0] = (1.f - 2.f * (yy + zz)) * sx;
+		m[0][1] = 2.f * (xy + wz) * sx;
+		m[0][2] = 2.f * (xz - wy) * sx;
+		m[0][3] = 0.f;
+
+		m[1][0] = 2.f * (xy - wz) * sy;
+		m[1][1] = (1.f - 2.f * (xx + zz)) * sy;
+		m[1][2] = 2.f * (yz + wx) * sy;
+		m[1][3] = 0.f;
+
+		m[2][0] = 2.f * (xz + wy) * sz;
+		m[2][1] = 2.f * (yz - wx) * sz;
+		m[2][2] = (1.f - 2.f * (xx + yy)) * sz;
+		m[2][3] = 0.f;
+
+		m[3][0] = c[TransformComponent_PositionX][i];
+		m[3][1] = c[TransformComponent_PositionY][i];
+		m[3][2] = c[TransformComponent_PositionZ][i];
+		m[3][3] = 1.f;
+	}
+}
+
+void matrix_affine_inverse_batch_scalar(const Matrix4x4* in, std::size_t count, Matrix4x4* out) {
+	for(std::size_t i = 0; i < count; ++i) {
+		const float (&m)[4][4] = in[i].m;
+
+		float c[3][3] {
+			{m[1][1] * m[2][2] - m[1][2] * m[2][1], m[1][2] * m[2][0] - m[1][0] * m[2][2], m[1][0] * m[2][1] - m[1][1] * m[2][0]},
+			{m[2][1] * m[0][2] - m[2][2] * m[0][1], m[2][2] * m[0][0] - m[2][0] * m[0][2], m[2][0] * m[0][1] - m[2][1] * m[0][0]},
+			{m[0][1] * m[1][2] - m[0][2] * m[1][1], m[0][2] * m[1][0] - m[0][0] * m[1][2], m[0][0] * m[1][1] - m[0][1] * m[1][0]}
+		};
+		float inv_det = 1.f / (m[0][0] * c[0][0] + m[0][1] * c[0][1] + m[0][2] * c[0][2]);
+
+		float (&r)[4][4] = out[i].m;
+		float t[3] {m[3][0], m[3][1], m[3][2]};
+		for(std::size_t row = 0; row < 3; ++row) {
+			for(std::size_t column = 0; column < 3; ++column) {
+				r[row][column] = c[column][row] * inv_det;
+			}
+			r[row][3] = 0.f;
+		}
+		for(std::size_t column = 0; column < 3; ++column) {
+			r[3][column] = -(t[0] * r[0][column] + t[1] * r[1][column] + t[2] * r[2][column]);
+		}
+		r[3][3] = 1.f;
+	}
+}
+
+void matrix_multiply_batch_scalar(const Matrix4x4* l, const Matrix4x4* r, std::size_t count, Matrix4x4* out) {
+	for(std::size_t i = 0; i < count; ++i) {
+		Matrix4x4 result;
+		for(std::size_t row = 0; row < 4; ++row) {
+			for(std::size_t column = 0; column < 4; ++column) {
+				result.m[row][column] =
+					l[i].m[row][0] * r[i].m[0][column] +
+					l[i].m[row][1] * r[i].m[1][column] +
+					l[i].m[row][2] * r[i].m[2][column] +
+					l[i].m[row][3] * r[i].m[3][column];
+			}
+		}
+		out[i] = result;
+	}
+}
+
+#ifdef CD_TRANSFORM_BATCH_SSE
+
+static void matrix_transform_batch_sse(const TransformStreams& streams, std::size_t count, Matrix4x4* out) {
+	const float* const* c = streams.components;
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 two = _mm_set1_ps(2.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	std::size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(c[TransformComponent_OrientationX] + i);
+		__m128 y = _mm_loadu_ps(c[TransformComponent_OrientationY] + i);
+		__m128 z = _mm_loadu_ps(c[TransformComponent_OrientationZ] + i);
+		__m128 w = _mm_loadu_ps(c[TransformComponent_OrientationW] + i);
+		__m128 sx = _mm_loadu_ps(c[TransformComponent_ScaleX] + i);
+		__m128 sy = _mm_loadu_ps(c[TransformComponent_ScaleY] + i);
+		__m128 sz = _mm_loadu_ps(c[TransformComponent_ScaleZ] + i);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		__m128 rows[4][4] {
+			{
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+				zero
+			},
+			{
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+				zero
+			},
+			{
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+				zero
+			},
+			{
+				_mm_loadu_ps(c[TransformComponent_PositionX] + i),
+				_mm_loadu_ps(c[TransformComponent_PositionY] + i),
+				_mm_loadu_ps(c[TransformComponent_PositionZ] + i),
+				one
+			}
+		};
+
+		for(std::size_t row = 0; row < 4; ++row) {
+			_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+			for(std::size_t lane = 0; lane < 4; ++lane) {
+				_mm_storeu_ps(out[i + lane].m[row], rows[row][lane]);
+			}
+		}
+	}
+
+	if(i < count) {
+		TransformStreams tail;
+		for(std::size_t component = 0; component < TransformComponent_Count; ++component) {
+			tail.components[component] = c[component] + i;
+		}
+		matrix_transform_batch_scalar(tail, count - i, out + i);
+	}
+}
+
+static void matrix_affine_inverse_batch_sse(const Matrix4x4* in, std::size_t count, Matrix4x4* out) {
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	std::size_t i = 0;
+	for(; i + 4 <= count; i += 4) {
+		__m128 m[4][4];
+		for(std::size_t row = 0; row < 4; ++row) {
+			for(std::size_t lane = 0; lane < 4; ++lane) {
+				m[row][lane] = _mm_loadu_ps(in[i + lane].m[row]);
+			}
+			_MM_TRANSPOSE4_PS(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		__m128 c00 = _mm_sub_ps(_mm_mul_ps(m[1][1], m[2][2]), _mm_mul_ps(m[1][2], m[2][1]));
+		__m128 c01 = _mm_sub_ps(_mm_mul_ps(m[1][2], m[2][0]), _mm_mul_ps(m[1][0], m[2][2]));
+		__m128 c02 = _mm_sub_ps(_mm_mul_ps(m[1][0], m[2][1]), _mm_mul_ps(m[1][1], m[2][0]));
+		__m128 c10 = _mm_sub_ps(_mm_mul_ps(m[2][1], m[0][2]), _mm_mul_ps(m[2][2], m[0][1]));
+		__m128 c11 = _mm_sub_ps(_mm_mul_ps(m[2][2], m[0][0]), _mm_mul_ps(m[2][0], m[0][2]));
+		__m128 c12 = _mm_sub_ps(_mm_mul_ps(m[2][0], m[0][1]), _mm_mul_ps(m[2][1], m[0][0]));
+		__m128 c20 = _mm_sub_ps(_mm_mul_ps(m[0][1], m[1][2]), _mm_mul_ps(m[0][2], m[1][1]));
+		__m128 c21 = _mm_sub_ps(_mm_mul_ps(m[0][2], m[1][0]), _mm_mul_ps(m[0][0], m[1][2]));
+		__m128 c22 = _mm_sub_ps(_mm_mul_ps(m[0][0], m[1][1]), _mm_mul_ps(m[0][1], m[1][0]));
+
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][0], c00), _mm_mul_ps(m[0][1], c01)), _mm_mul_ps(m[0][2], c02));
+		__m128 inv_det = _mm_div_ps(one, det);
+
+		__m128 r[4][4] {
+			{_mm_mul_ps(c00, inv_det), _mm_mul_ps(c10, inv_det), _mm_mul_ps(c20, inv_det), zero},
+			{_mm_mul_ps(c01, inv_det), _mm_mul_ps(c11, inv_det), _mm_mul_ps(c21, inv_det), zero},
+			{_mm_mul_ps(c02, inv_det), _mm_mul_ps(c12, inv_det), _mm_mul_ps(c22, inv_det), zero},
+			{zero, zero, zero, one}
+		};
+		for(std::size_t column = 0; column < 3; ++column) {
+			__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3][0], r[0][column]), _mm_mul_ps(m[3][1], r[1][column])), _mm_mul_ps(m[3][2], r[2][column]));
+			r[3][column] = _mm_sub_ps(zero, t);
+		}
+
+		for(std::size_t row = 0; row < 4; ++row) {
+			_MM_TRANSPOSE4_PS(r[row][0], r[row][1], r[row][2], r[row][3]);
+			for(std::size_t lane = 0; lane < 4; ++lane) {
+				_mm_storeu_ps(out[i + lane].m[row], r[row][lane]);
+			}
+		}
+	}
+
+	matrix_affine_inverse_batch_scalar(in + i, count - i, out + i);
+}
+
+static void matrix_multiply_batch_sse(const Matrix4x4* l, const Matrix4x4* r, std::size_t count, Matrix4x4* out) {
+	for(std::size_t i = 0; i < count; ++i) {
+		__m128 r0 = _mm_loadu_ps(r[i].m[0]);
+		__m128 r1 = _mm_loadu_ps(r[i].m[1]);
+		__m128 r2 = _mm_loadu_ps(r[i].m[2]);
+		__m128 r3 = _mm_loadu_ps(r[i].m[3]);
+
+		__m128 rows[4];
+		for(std::size_t row = 0; row < 4; ++row) {
+			__m128 a = _mm_loadu_ps(l[i].m[row]);
+			__m128 result = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+			rows[row] = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+		}
+
+		for(std::size_t row = 0; row < 4; ++row) {
+			_mm_storeu_ps(out[i].m[row], rows[row]);
+		}
+	}
+}
+
+#endif
+
+void matrix_transform_batch(const TransformStreams& streams, std::size_t count, Matrix4x4* out) {
+	switch(transform_batch_path()) {
+#ifdef CD_TRANSFORM_BATCH_AVX2
+	case TransformBatchPath::AVX2:
+		matrix_transform_batch_avx2(streams.components, count, reinterpret_cast<float*>(out));
+		return;
+#endif
+#ifdef CD_TRANSFORM_BATCH_SSE
+	case TransformBatchPath::SSE:
+		matrix_transform_batch_sse(streams, count, out);
+		return;
+#endif
+	default:
+		matrix_transform_batch_scalar(streams, count, out);
+		return;
+	}
+}
+
+void matrix_affine_inverse_batch(const Matrix4x4* in, std::size_t count, Matrix4x4* out) {
+	switch(transform_batch_path()) {
+#ifdef CD_TRANSFORM_BATCH_AVX2
+	case TransformBatchPath::AVX2:
+		matrix_affine_inverse_batch_avx2(reinterpret_cast<const float*>(in), count, reinterpret_cast<float*>(out));
+		return;
+#endif
+#ifdef CD_TRANSFORM_BATCH_SSE
+	case TransformBatchPath::SSE:
+		matrix_affine_inverse_batch_sse(in, count, out);
+		return;
+#endif
+	default:
+		matrix_affine_inverse_batch_scalar(in, count, out);
+		return;
+	}
+}
+
+void matrix_multiply_batch(const Matrix4x4* l, const Matrix4x4* r, std::size_t count, Matrix4x4* out) {
+	switch(transform_batch_path()) {
+#ifdef CD_TRANSFORM_BATCH_AVX2
+	case TransformBatchPath::AVX2:
+		matrix_multiply_batch_avx2(reinterpret_cast<const float*>(l), reinterpret_cast<const float*>(r), count, reinterpret_cast<float*>(out));
+		return;
+#endif
+#ifdef CD_TRANSFORM_BATCH_SSE
+	case TransformBatchPath::SSE:
+		matrix_multiply_batch_sse(l, r, count, out);
+		return;
+#endif
+	default:
+		matrix_multiply_batch_scalar(l, r, count, out);
+		return;
+	}
+}
+
+}
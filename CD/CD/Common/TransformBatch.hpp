@@ -0,0 +1,43 @@
+#pragma once
+
+#include <CD/Common/Transform.hpp>
+#include <cstdint>
+
+namespace CD {
+
+enum TransformComponent : std::uint8_t {
+	TransformComponent_OrientationX,
+	TransformComponent_OrientationY,
+	TransformComponent_OrientationZ,
+	TransformComponent_OrientationW,
+	TransformComponent_PositionX,
+	TransformComponent_PositionY,
+	TransformComponent_PositionZ,
+	TransformComponent_ScaleX,
+	TransformComponent_ScaleY,
+	TransformComponent_ScaleZ,
+	TransformComponent_Count
+};
+
+struct TransformStreams {
+	const float* components[TransformComponent_Count];
+};
+
+enum class TransformBatchPath : std::uint8_t {
+	Scalar,
+	SSE,
+	AVX2
+};
+
+TransformBatchPath transform_batch_path();
+void set_transform_batch_path(TransformBatchPath);
+
+void matrix_transform_batch(const TransformStreams&, std::size_t count, Matrix4x4* out);
+void matrix_affine_inverse_batch(const Matrix4x4* in, std::size_t count, Matrix4x4* out);
+void matrix_multiply_batch(const Matrix4x4* l, const Matrix4x4* r, std::size_t count, Matrix4x4* out);
+
+void matrix_transform_batch_scalar(const TransformStreams&, std::size_t count, Matrix4x4* out);
+void matrix_affine_inverse_batch_scalar(const Matrix4x4* in, std::size_t count, Matrix4x4* out);
+void matrix_multiply_batch_scalar(const Matrix4x4* l, const Matrix4x4* r, std::size_t count, Matrix4x4* out);
+
+}
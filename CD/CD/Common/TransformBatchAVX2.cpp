@@ -0,0 +1,213 @@
+#include <immintrin.h>
+#include <cstddef>
+
+namespace CD {
+
+namespace {
+
+constexpr std::size_t matrix_stride = 16;
+
+enum TransformStream : std::size_t {
+	OrientationX,
+	OrientationY,
+	OrientationZ,
+	OrientationW,
+	PositionX,
+	PositionY,
+	PositionZ,
+	ScaleX,
+	ScaleY,
+	ScaleZ
+};
+
+}
+
+static inline void transpose4_lanes(__m256& a, __m256& b, __m256& c, __m256& d) {
+	__m256 t0 = _mm256_unpacklo_ps(a, b);
+	__m256 t1 = _mm256_unpacklo_ps(c, d);
+	__m256 t2 = _mm256_unpackhi_ps(a, b);
+	__m256 t3 = _mm256_unpackhi_ps(c, d);
+	a = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	b = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	c = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	d = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+static inline __m256 load_matrix_rows(const float* matrices, std::size_t row, std::size_t lane) {
+	__m128 lo = _mm_loadu_ps(matrices + lane * matrix_stride + row * 4);
+	__m128 hi = _mm_loadu_ps(matrices + (lane + 4) * matrix_stride + row * 4);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+static inline void store_matrix_rows(float* matrices, std::size_t row, __m256 (&columns)[4]) {
+	transpose4_lanes(columns[0], columns[1], columns[2], columns[3]);
+	for(std::size_t lane = 0; lane < 4; ++lane) {
+		_mm_storeu_ps(matrices + lane * matrix_stride + row * 4, _mm256_castps256_ps128(columns[lane]));
+		_mm_storeu_ps(matrices + (lane + 4) * matrix_stride + row * 4, _mm256_extractf128_ps(columns[lane], 1));
+	}
+}
+
+static void matrix_transform_scalar_tail(const float* const* c, std::size_t i, float* out) {
+	float x = c[OrientationX][i], y = c[OrientationY][i], z = c[OrientationZ][i], w = c[OrientationW][i];
+	float sx = c[ScaleX][i], sy = c[ScaleY][i], sz = c[ScaleZ][i];
+
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float wx = w * x, wy = w * y, wz = w * z;
+
+	float m[matrix_stride] {
+		(1.f - 2.f * (yy + zz)) * sx, 2.f * (xy + wz) * sx, 2.f * (xz - wy) * sx, 0.f,
+		2.f * (xy - wz) * sy, (1.f - 2.f * (xx + zz)) * sy, 2.f * (yz + wx) * sy, 0.f,
+		2.f * (xz + wy) * sz, 2.f * (yz - wx) * sz, (1.f - 2.f * (xx + yy)) * sz, 0.f,
+		c[PositionX][i], c[PositionY][i], c[PositionZ][i], 1.f
+	};
+	for(std::size_t e = 0; e < matrix_stride; ++e) {
+		out[e] = m[e];
+	}
+}
+
+void matrix_transform_batch_avx2(const float* const* c, std::size_t count, float* out) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 two = _mm256_set1_ps(2.f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	std::size_t i = 0;
+	for(; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(c[OrientationX] + i);
+		__m256 y = _mm256_loadu_ps(c[OrientationY] + i);
+		__m256 z = _mm256_loadu_ps(c[OrientationZ] + i);
+		__m256 w = _mm256_loadu_ps(c[OrientationW] + i);
+		__m256 sx = _mm256_loadu_ps(c[ScaleX] + i);
+		__m256 sy = _mm256_loadu_ps(c[ScaleY] + i);
+		__m256 sz = _mm256_loadu_ps(c[ScaleZ] + i);
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		__m256 rows[4][4] {
+			{
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+				zero
+			},
+			{
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+				zero
+			},
+			{
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+				zero
+			},
+			{
+				_mm256_loadu_ps(c[PositionX] + i),
+				_mm256_loadu_ps(c[PositionY] + i),
+				_mm256_loadu_ps(c[PositionZ] + i),
+				one
+			}
+		};
+
+		for(std::size_t row = 0; row < 4; ++row) {
+			store_matrix_rows(out + i * matrix_stride, row, rows[row]);
+		}
+	}
+
+	for(; i < count; ++i) {
+		matrix_transform_scalar_tail(c, i, out + i * matrix_stride);
+	}
+}
+
+void matrix_affine_inverse_batch_avx2(const float* in, std::size_t count, float* out) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	std::size_t i = 0;
+	for(; i < count; i += 8) {
+		float padded_in[8 * matrix_stride];
+		float padded_out[8 * matrix_stride];
+		const float* src = in + i * matrix_stride;
+		float* dst = out + i * matrix_stride;
+		std::size_t lanes = count - i < 8 ? count - i : 8;
+
+		if(lanes < 8) {
+			for(std::size_t e = 0; e < 8 * matrix_stride; ++e) {
+				padded_in[e] = e < lanes * matrix_stride ? src[e] : ((e % matrix_stride) % 5 == 0 ? 1.f : 0.f);
+			}
+			src = padded_in;
+			dst = padded_out;
+		}
+
+		__m256 m[4][4];
+		for(std::size_t row = 0; row < 4; ++row) {
+			for(std::size_t lane = 0; lane < 4; ++lane) {
+				m[row][lane] = load_matrix_rows(src, row, lane);
+			}
+			transpose4_lanes(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		__m256 c00 = _mm256_sub_ps(_mm256_mul_ps(m[1][1], m[2][2]), _mm256_mul_ps(m[1][2], m[2][1]));
+		__m256 c01 = _mm256_sub_ps(_mm256_mul_ps(m[1][2], m[2][0]), _mm256_mul_ps(m[1][0], m[2][2]));
+		__m256 c02 = _mm256_sub_ps(_mm256_mul_ps(m[1][0], m[2][1]), _mm256_mul_ps(m[1][1], m[2][0]));
+		__m256 c10 = _mm256_sub_ps(_mm256_mul_ps(m[2][1], m[0][2]), _mm256_mul_ps(m[2][2], m[0][1]));
+		__m256 c11 = _mm256_sub_ps(_mm256_mul_ps(m[2][2], m[0][0]), _mm256_mul_ps(m[2][0], m[0][2]));
+		__m256 c12 = _mm256_sub_ps(_mm256_mul_ps(m[2][0], m[0][1]), _mm256_mul_ps(m[2][1], m[0][0]));
+		__m256 c20 = _mm256_sub_ps(_mm256_mul_ps(m[0][1], m[1][2]), _mm256_mul_ps(m[0][2], m[1][1]));
+		__m256 c21 = _mm256_sub_ps(_mm256_mul_ps(m[0][2], m[1][0]), _mm256_mul_ps(m[0][0], m[1][2]));
+		__m256 c22 = _mm256_sub_ps(_mm256_mul_ps(m[0][0], m[1][1]), _mm256_mul_ps(m[0][1], m[1][0]));
+
+		__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0][0], c00), _mm256_mul_ps(m[0][1], c01)), _mm256_mul_ps(m[0][2], c02));
+		__m256 inv_det = _mm256_div_ps(one, det);
+
+		__m256 r[4][4] {
+			{_mm256_mul_ps(c00, inv_det), _mm256_mul_ps(c10, inv_det), _mm256_mul_ps(c20, inv_det), zero},
+			{_mm256_mul_ps(c01, inv_det), _mm256_mul_ps(c11, inv_det), _mm256_mul_ps(c21, inv_det), zero},
+			{_mm256_mul_ps(c02, inv_det), _mm256_mul_ps(c12, inv_det), _mm256_mul_ps(c22, inv_det), zero},
+			{zero, zero, zero, one}
+		};
+		for(std::size_t column = 0; column < 3; ++column) {
+			__m256 t = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[3][0], r[0][column]), _mm256_mul_ps(m[3][1], r[1][column])), _mm256_mul_ps(m[3][2], r[2][column]));
+			r[3][column] = _mm256_sub_ps(zero, t);
+		}
+
+		for(std::size_t row = 0; row < 4; ++row) {
+			store_matrix_rows(dst, row, r[row]);
+		}
+
+		if(lanes < 8) {
+			for(std::size_t e = 0; e < lanes * matrix_stride; ++e) {
+				out[i * matrix_stride + e] = padded_out[e];
+			}
+		}
+	}
+}
+
+void matrix_multiply_batch_avx2(const float* l, const float* r, std::size_t count, float* out) {
+	for(std::size_t i = 0; i < count; ++i) {
+		const float* lm = l + i * matrix_stride;
+		const float* rm = r + i * matrix_stride;
+
+		__m256 r0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rm));
+		__m256 r1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rm + 4));
+		__m256 r2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rm + 8));
+		__m256 r3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(rm + 12));
+
+		__m256 rows[2];
+		for(std::size_t half = 0; half < 2; ++half) {
+			__m256 a = _mm256_loadu_ps(lm + half * 8);
+			__m256 result = _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+			result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+			result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+			rows[half] = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+		}
+
+		_mm256_storeu_ps(out + i * matrix_stride, rows[0]);
+		_mm256_storeu_ps(out + i * matrix_stride + 8, rows[1]);
+	}
+}
+
+}
@@ -0,0 +1,471 @@
+#include <CD/GPU/Capture/Device.hpp>
+#include <CD/Common/AllocationTracker.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <algorithm>
+
+namespace CD::GPU::Capture {
+
+static void write_shader(RecordWriter& record, const Shader& shader) {
+	record.write<std::uint64_t>(shader.bytecode ? shader.size : 0);
+	if(shader.bytecode) {
+		record.write_bytes(shader.bytecode, shader.size);
+	}
+}
+
+Device::Device(GPU::Device& device) :
+	device(device),
+	journal_sequence(),
+	capturing(false),
+	frames_remaining() {
+}
+
+Device::~Device() {
+	if(is_capturing()) {
+		Memory::resume_no_allocation_checks();
+	}
+}
+
+BufferHandle Device::create_buffer(const BufferDesc& desc) {
+	BufferHandle handle = device.create_buffer(desc);
+
+	RecordWriter record(RecordType::CreateBuffer);
+	record.write(handle);
+	record.write(desc);
+
+	std::lock_guard lock(mutex);
+	buffer_descs[static_cast<std::uint32_t>(handle)] = desc;
+	add_journal_entry(resource_key(handle), record);
+	return handle;
+}
+
+TextureHandle Device::create_texture(const TextureDesc& desc) {
+	TextureHandle handle = device.create_texture(desc);
+
+	RecordWriter record(RecordType::CreateTexture);
+	record.write(handle);
+	record.write(desc);
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+	return handle;
+}
+
+PipelineHandle Device::create_render_pass(const RenderPassDesc& desc) {
+	PipelineHandle handle = device.create_render_pass(desc);
+
+	RenderPassDesc stored = desc;
+	stored.depth_stencil_target = nullptr;
+
+	RecordWriter record(RecordType::CreateRenderPass);
+	record.write(handle);
+	record.write(stored);
+	record.write(desc.depth_stencil_target != nullptr);
+	if(desc.depth_stencil_target) {
+		record.write(*desc.depth_stencil_target);
+	}
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+	return handle;
+}
+
+PipelineHandle Device::create_pipeline_input_list(std::uint32_t num_descriptors) {
+	PipelineHandle handle = device.create_pipeline_input_list(num_descriptors);
+
+	RecordWriter record(RecordType::CreatePipelineInputList);
+	record.write(handle);
+	record.write(num_descriptors);
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+	return handle;
+}
+
+PipelineHandle Device::create_pipeline_state(const GraphicsPipelineDesc& desc, const PipelineInputLayout& layout) {
+	PipelineHandle handle = device.create_pipeline_state(desc, layout);
+
+	GraphicsPipelineDesc stored = desc;
+	stored.input_layout = {};
+	stored.vs = {};
+	stored.ps = {};
+	stored.gs = {};
+	stored.ds = {};
+	stored.hs = {};
+
+	RecordWriter record(RecordType::CreateGraphicsPipeline);
+	record.write(handle);
+	record.write(stored);
+	record.write(layout);
+
+	record.write(desc.input_layout.num_elements);
+	for(std::uint32_t i = 0; i < desc.input_layout.num_elements; ++i) {
+		InputElement element = desc.input_layout.elements[i];
+		const std::uint32_t name_size = element.name ? static_cast<std::uint32_t>(std::strlen(element.name)) : 0;
+		element.name = nullptr;
+		record.write(element);
+		record.write(name_size);
+		record.write_bytes(desc.input_layout.elements[i].name, name_size);
+	}
+
+	for(const Shader* shader : {&desc.vs, &desc.ps, &desc.gs, &desc.ds, &desc.hs}) {
+		write_shader(record, *shader);
+	}
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+	return handle;
+}
+
+PipelineHandle Device::create_pipeline_state(const ComputePipelineDesc& desc, const PipelineInputLayout& layout) {
+	PipelineHandle handle = device.create_pipeline_state(desc, layout);
+
+	RecordWriter record(RecordType::CreateComputePipeline);
+	record.write(handle);
+	record.write(layout);
+	write_shader(record, desc.compute_shader);
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+	return handle;
+}
+
+void Device::destroy_buffer(BufferHandle handle) {
+	{
+		std::lock_guard lock(mutex);
+		remove_journal_entries(resource_key(handle));
+		buffer_descs.erase(static_cast<std::uint32_t>(handle));
+		mapped_buffers.erase(static_cast<std::uint32_t>(handle));
+
+		if(is_capturing()) {
+			RecordWriter record(RecordType::DestroyBuffer);
+			record.write(handle);
+			write_record(record);
+		}
+	}
+
+	device.destroy_buffer(handle);
+}
+
+void Device::destroy_texture(TextureHandle handle) {
+	{
+		std::lock_guard lock(mutex);
+		remove_journal_entries(resource_key(handle));
+
+		if(is_capturing()) {
+			RecordWriter record(RecordType::DestroyTexture);
+			record.write(handle);
+			write_record(record);
+		}
+	}
+
+	device.destroy_texture(handle);
+}
+
+void Device::destroy_pipeline_resource(PipelineHandle handle) {
+	{
+		std::lock_guard lock(mutex);
+		remove_journal_entries(resource_key(handle));
+
+		if(is_capturing()) {
+			RecordWriter record(RecordType::DestroyPipelineResource);
+			record.write(handle);
+			write_record(record);
+		}
+	}
+
+	device.destroy_pipeline_resource(handle);
+}
+
+void Device::map_buffer(BufferHandle handle, void** data, std::uint64_t offset, std::uint64_t size) {
+	device.map_buffer(handle, data, offset, size);
+
+	std::lock_guard lock(mutex);
+	mapped_buffers[static_cast<std::uint32_t>(handle)] = static_cast<std::uint8_t*>(*data) - offset;
+}
+
+void Device::unmap_buffer(BufferHandle handle, std::uint64_t offset, std::uint64_t size) {
+	{
+		std::lock_guard lock(mutex);
+		if(is_capturing()) {
+			write_buffer_range(handle, offset, size);
+		}
+		mapped_buffers.erase(static_cast<std::uint32_t>(handle));
+	}
+
+	device.unmap_buffer(handle, offset, size);
+}
+
+void Device::update_pipeline_input_list(PipelineHandle handle, DescriptorType type, const TextureView* views, std::uint64_t num_textures, std::uint64_t offset) {
+	device.update_pipeline_input_list(handle, type, views, num_textures, offset);
+
+	RecordWriter record(RecordType::UpdateInputListTextures);
+	record.write(handle);
+	record.write(type);
+	record.write(offset);
+	record.write(num_textures);
+	record.write_bytes(views, num_textures * sizeof(TextureView));
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+}
+
+void Device::update_pipeline_input_list(PipelineHandle handle, DescriptorType type, const BufferView* views, std::uint64_t num_buffers, std::uint64_t offset) {
+	device.update_pipeline_input_list(handle, type, views, num_buffers, offset);
+
+	RecordWriter record(RecordType::UpdateInputListBuffers);
+	record.write(handle);
+	record.write(type);
+	record.write(offset);
+	record.write(num_buffers);
+	record.write_bytes(views, num_buffers * sizeof(BufferView));
+
+	std::lock_guard lock(mutex);
+	add_journal_entry(resource_key(handle), record);
+}
+
+void Device::signal(CommandQueueType queue) {
+	device.signal(queue);
+
+	if(is_capturing()) {
+		RecordWriter record(RecordType::Signal);
+		record.write(queue);
+
+		std::lock_guard lock(mutex);
+		write_record(record);
+	}
+}
+
+void Device::wait(const Signal& producer, CommandQueueType queue) {
+	device.wait(producer, queue);
+
+	if(is_capturing()) {
+		RecordWriter record(RecordType::Wait);
+		record.write(producer);
+		record.write(queue);
+
+		std::lock_guard lock(mutex);
+		write_record(record);
+	}
+}
+
+void Device::wait_for_fence(const Signal& producer) {
+	device.wait_for_fence(producer);
+
+	if(is_capturing()) {
+		RecordWriter record(RecordType::WaitForFence);
+		record.write(producer);
+
+		std::lock_guard lock(mutex);
+		write_record(record);
+	}
+}
+
+Signal Device::submit_commands(const CommandBuffer& command_buffer, CommandQueueType queue) {
+	const CommandBuffer* command_buffers[] {&command_buffer};
+	return submit_commands(command_buffers, 1, queue);
+}
+
+Signal Device::submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType queue) {
+	Signal signal = device.submit_commands(command_buffers, num_command_buffers, queue);
+
+	if(is_capturing()) {
+		CD_PROFILE_SCOPE("Capture::Device::submit_commands");
+
+		RecordWriter record(RecordType::Submit);
+		record.write(queue);
+		record.write(signal);
+		record.write(static_cast<std::uint32_t>(num_command_buffers));
+
+		for(std::size_t i = 0; i < num_command_buffers; ++i) {
+			const CommandBuffer& command_buffer = *command_buffers[i];
+
+			record.write(command_buffer.get_command_count());
+			record.write(command_buffer.get_statistics().command_bytes);
+			for(const std::uint8_t* command : command_buffer) {
+				record.write_bytes(command, command_buffer.get_command_size(command));
+			}
+		}
+
+		std::lock_guard lock(mutex);
+		for(std::size_t i = 0; i < num_command_buffers; ++i) {
+			write_upload_sources(*command_buffers[i]);
+		}
+		write_record(record);
+	}
+
+	return signal;
+}
+
+Signal Device::reset() {
+	Signal signal = device.reset();
+
+	if(is_capturing()) {
+		RecordWriter record(RecordType::Present);
+		record.write(signal);
+
+		std::lock_guard lock(mutex);
+		write_record(record);
+
+		if(--frames_remaining) {
+			RecordWriter begin_frame(RecordType::BeginFrame);
+			write_record(begin_frame);
+		}
+		else {
+			file.close();
+			capturing.store(false, std::memory_order_release);
+			Memory::resume_no_allocation_checks();
+		}
+	}
+
+	return signal;
+}
+
+const SubmitStatistics& Device::get_submit_statistics() const {
+	return device.get_submit_statistics();
+}
+
+void Device::reset_submit_statistics() {
+	device.reset_submit_statistics();
+}
+
+void Device::resize_buffers(std::uint32_t width, std::uint32_t height) {
+	device.resize_buffers(width, height);
+
+	if(is_capturing()) {
+		RecordWriter record(RecordType::ResizeBuffers);
+		record.write(width);
+		record.write(height);
+
+		std::lock_guard lock(mutex);
+		write_record(record);
+	}
+}
+
+// Only the latest reservation of a query type is journaled, a replay grows its heaps once before the first submit.
+void Device::reserve_queries(QueryType type, std::uint32_t count) {
+	device.reserve_queries(type, count);
+
+	RecordWriter record(RecordType::ReserveQueries);
+	record.write(type);
+	record.write(count);
+
+	std::lock_guard lock(mutex);
+	remove_journal_entries(query_reservation_key(type));
+	add_journal_entry(query_reservation_key(type), record);
+}
+
+DeviceFeatureInfo Device::report_feature_info() {
+	return device.report_feature_info();
+}
+
+GPU::ShaderCompiler& Device::get_shader_compiler() {
+	return device.get_shader_compiler();
+}
+
+bool Device::begin_capture(const std::string& path, std::uint32_t num_frames) {
+	CD_ASSERT(num_frames);
+
+	std::lock_guard lock(mutex);
+	if(is_capturing()) {
+		return false;
+	}
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if(!file) {
+		return false;
+	}
+
+	const FileHeader header = file_header();
+	file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+
+	for(const auto& [sequence, entry] : journal) {
+		file.write(reinterpret_cast<const char*>(entry.record.data()), entry.record.size());
+	}
+
+	RecordWriter begin_frame(RecordType::BeginFrame);
+	write_record(begin_frame);
+
+	// Records, journal owners and file writes allocate while the captured frames run.
+	Memory::suspend_no_allocation_checks();
+	frames_remaining = num_frames;
+	capturing.store(true, std::memory_order_release);
+	return true;
+}
+
+void Device::add_journal_entry(std::uint64_t owner, RecordWriter& record) {
+	const std::uint64_t sequence = journal_sequence++;
+	journal.emplace(sequence, JournalEntry {owner, record.finish()});
+	journal_owners[owner].push_back(sequence);
+
+	if(is_capturing()) {
+		write_record(record);
+	}
+}
+
+void Device::remove_journal_entries(std::uint64_t owner) {
+	auto it = journal_owners.find(owner);
+	if(it != journal_owners.end()) {
+		for(std::uint64_t sequence : it->second) {
+			journal.erase(sequence);
+		}
+		journal_owners.erase(it);
+	}
+}
+
+void Device::write_record(RecordWriter& record) {
+	const std::vector<std::uint8_t>& data = record.finish();
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void Device::write_buffer_range(BufferHandle handle, std::uint64_t offset, std::uint64_t size) {
+	auto memory = mapped_buffers.find(static_cast<std::uint32_t>(handle));
+	auto desc = buffer_descs.find(static_cast<std::uint32_t>(handle));
+	if(memory == mapped_buffers.end() || desc == buffer_descs.end() || offset >= desc->second.size) {
+		return;
+	}
+
+	size = std::min(size, desc->second.size - offset);
+
+	RecordWriter record(RecordType::WriteBuffer);
+	record.write(handle);
+	record.write(offset);
+	record.write(size);
+	record.write_bytes(memory->second + offset, size);
+	write_record(record);
+}
+
+// Ranges copied out of mapped upload buffers and indirect arguments kept in them are stored right before
+// the submit that reads them.
+// Upload memory read by shaders directly (constant buffers, vertex streams) is not captured.
+void Device::write_upload_sources(const CommandBuffer& command_buffer) {
+	for(const std::uint8_t* command : command_buffer) {
+		switch(command_buffer.get_command_type(command)) {
+		case CommandType::CopyBuffer: {
+			const CopyBufferDesc& desc = *static_cast<const CopyBufferDesc*>(static_cast<const void*>(command));
+			write_buffer_range(desc.src, desc.src_offset, desc.num_bytes);
+			break;
+		}
+		case CommandType::CopyBufferToTexture: {
+			const CopyBufferToTextureDesc& desc = *static_cast<const CopyBufferToTextureDesc*>(static_cast<const void*>(command));
+			write_buffer_range(desc.buffer, desc.buffer_offset, static_cast<std::uint64_t>(desc.row_size) * desc.height);
+			break;
+		}
+		case CommandType::DrawIndirect: {
+			const DrawIndirectDesc& desc = *static_cast<const DrawIndirectDesc*>(static_cast<const void*>(command));
+			write_buffer_range(desc.args, desc.offset, static_cast<std::uint64_t>(desc.max_draws) * draw_indirect_stride(desc.num_constants));
+			write_buffer_range(desc.count, desc.count_offset, sizeof(std::uint32_t));
+			break;
+		}
+		case CommandType::DrawIndexedIndirect: {
+			const DrawIndexedIndirectDesc& desc = *static_cast<const DrawIndexedIndirectDesc*>(static_cast<const void*>(command));
+			write_buffer_range(desc.args, desc.offset, static_cast<std::uint64_t>(desc.max_draws) * draw_indexed_indirect_stride(desc.num_constants));
+			write_buffer_range(desc.count, desc.count_offset, sizeof(std::uint32_t));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+}
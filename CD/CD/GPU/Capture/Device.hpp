@@ -0,0 +1,92 @@
+#pragma once
+
+#include <CD/GPU/Device.hpp>
+#include <CD/GPU/Capture/Format.hpp>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CD::GPU::Capture {
+
+// Forwards every call to the wrapped device. While a capture is running, the live resources are written
+// first, followed by every call made until the requested number of frames has been presented.
+class Device : public GPU::Device {
+public:
+	Device(GPU::Device&);
+	~Device();
+
+	BufferHandle create_buffer(const BufferDesc&) final;
+	TextureHandle create_texture(const TextureDesc&) final;
+	PipelineHandle create_render_pass(const RenderPassDesc&) final;
+	PipelineHandle create_pipeline_input_list(std::uint32_t num_descriptors) final;
+	PipelineHandle create_pipeline_state(const GraphicsPipelineDesc&, const PipelineInputLayout&) final;
+	PipelineHandle create_pipeline_state(const ComputePipelineDesc&, const PipelineInputLayout&) final;
+
+	void destroy_buffer(BufferHandle) final;
+	void destroy_texture(TextureHandle) final;
+	void destroy_pipeline_resource(PipelineHandle) final;
+
+	void map_buffer(BufferHandle, void** data, std::uint64_t offset, std::uint64_t size) final;
+	void unmap_buffer(BufferHandle, std::uint64_t offset, std::uint64_t size) final;
+
+	void update_pipeline_input_list(PipelineHandle, DescriptorType, const TextureView* views, std::uint64_t num_textures, std::uint64_t offset) final;
+	void update_pipeline_input_list(PipelineHandle, DescriptorType, const BufferView* views, std::uint64_t num_buffers, std::uint64_t offset) final;
+
+	void signal(CommandQueueType) final;
+	void wait(const Signal& producer, CommandQueueType queue) final;
+	void wait_for_fence(const Signal&) final;
+	Signal submit_commands(const CommandBuffer&, CommandQueueType) final;
+	Signal submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType) final;
+	Signal reset() final;
+
+	const SubmitStatistics& get_submit_statistics() const final;
+	void reset_submit_statistics() final;
+
+	void resize_buffers(std::uint32_t width, std::uint32_t height) final;
+	void reserve_queries(QueryType, std::uint32_t count) final;
+	DeviceFeatureInfo report_feature_info() final;
+	GPU::ShaderCompiler& get_shader_compiler() final;
+
+	bool begin_capture(const std::string& path, std::uint32_t num_frames);
+	bool is_capturing() const;
+	GPU::Device& get_device();
+private:
+	struct JournalEntry {
+		std::uint64_t owner;
+		std::vector<std::uint8_t> record;
+	};
+
+	GPU::Device& device;
+
+	std::mutex mutex;
+	std::map<std::uint64_t, JournalEntry> journal;
+	std::unordered_map<std::uint64_t, std::vector<std::uint64_t>> journal_owners;
+	std::uint64_t journal_sequence;
+
+	std::unordered_map<std::uint32_t, BufferDesc> buffer_descs;
+	std::unordered_map<std::uint32_t, std::uint8_t*> mapped_buffers;
+
+	std::ofstream file;
+	std::atomic<bool> capturing;
+	std::uint32_t frames_remaining;
+
+	void add_journal_entry(std::uint64_t owner, RecordWriter&);
+	void remove_journal_entries(std::uint64_t owner);
+	void write_record(RecordWriter&);
+	void write_buffer_range(BufferHandle, std::uint64_t offset, std::uint64_t size);
+	void write_upload_sources(const CommandBuffer&);
+};
+
+inline bool Device::is_capturing() const {
+	return capturing.load(std::memory_order_acquire);
+}
+
+inline GPU::Device& Device::get_device() {
+	return device;
+}
+
+}
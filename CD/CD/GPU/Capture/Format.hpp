@@ -0,0 +1,153 @@
+#pragma once
+
+#include <CD/GPU/CommandBuffer.hpp>
+#include <CD/Common/Debug.hpp>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace CD::GPU::Capture {
+
+constexpr std::uint32_t capture_magic = 0x50434443; // "CDCP"
+constexpr std::uint32_t capture_version = 5;
+
+// Descs and commands are stored as raw structs, so a capture is only valid for the build layout it was written with.
+struct FileHeader {
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t pointer_size;
+	std::uint32_t num_command_types;
+};
+
+enum class RecordType : std::uint32_t {
+	CreateBuffer,
+	CreateTexture,
+	CreateRenderPass,
+	CreatePipelineInputList,
+	CreateGraphicsPipeline,
+	CreateComputePipeline,
+	DestroyBuffer,
+	DestroyTexture,
+	DestroyPipelineResource,
+	UpdateInputListTextures,
+	UpdateInputListBuffers,
+	WriteBuffer,
+	Signal,
+	Wait,
+	WaitForFence,
+	Submit,
+	BeginFrame,
+	Present,
+	ResizeBuffers,
+	ReserveQueries,
+	Count
+};
+
+struct RecordHeader {
+	RecordType type;
+	std::uint32_t reserved;
+	std::uint64_t size;
+};
+
+// Journal owner of the reservation of a query type, resource keys start at 1 << 32.
+constexpr std::uint64_t query_reservation_key(QueryType type) {
+	return static_cast<std::uint64_t>(type);
+}
+
+constexpr std::uint64_t resource_key(BufferHandle handle) {
+	return 1ull << 32 | static_cast<std::uint32_t>(handle);
+}
+
+constexpr std::uint64_t resource_key(TextureHandle handle) {
+	return 2ull << 32 | static_cast<std::uint32_t>(handle);
+}
+
+constexpr std::uint64_t resource_key(PipelineHandle handle) {
+	return (3ull + static_cast<std::uint64_t>(handle.type)) << 32 | handle.handle;
+}
+
+constexpr FileHeader file_header() {
+	return {
+		capture_magic,
+		capture_version,
+		sizeof(void*),
+		static_cast<std::uint32_t>(CommandType::Invalid)
+	};
+}
+
+class RecordWriter {
+public:
+	RecordWriter(RecordType);
+
+	template<typename T> void write(const T&);
+	void write_bytes(const void* data, std::size_t size);
+
+	const std::vector<std::uint8_t>& finish();
+private:
+	std::vector<std::uint8_t> data;
+};
+
+class RecordReader {
+public:
+	RecordReader(const std::uint8_t* data, std::size_t size);
+
+	template<typename T> T read();
+	const std::uint8_t* read_bytes(std::size_t size);
+
+	bool at_end() const;
+private:
+	const std::uint8_t* data;
+	std::size_t size;
+	std::size_t offset;
+};
+
+inline RecordWriter::RecordWriter(RecordType type) :
+	data(sizeof(RecordHeader)) {
+
+	RecordHeader header {type, 0, 0};
+	std::memcpy(data.data(), &header, sizeof(RecordHeader));
+}
+
+template<typename T>
+inline void RecordWriter::write(const T& value) {
+	static_assert(std::is_trivially_copyable<T>::value);
+	write_bytes(&value, sizeof(T));
+}
+
+inline void RecordWriter::write_bytes(const void* bytes, std::size_t size) {
+	const std::uint8_t* begin = static_cast<const std::uint8_t*>(bytes);
+	data.insert(data.end(), begin, begin + size);
+}
+
+inline const std::vector<std::uint8_t>& RecordWriter::finish() {
+	std::uint64_t size = data.size() - sizeof(RecordHeader);
+	std::memcpy(data.data() + offsetof(RecordHeader, size), &size, sizeof(size));
+	return data;
+}
+
+inline RecordReader::RecordReader(const std::uint8_t* data, std::size_t size) :
+	data(data),
+	size(size),
+	offset() {
+}
+
+template<typename T>
+inline T RecordReader::read() {
+	static_assert(std::is_trivially_copyable<T>::value);
+	T value;
+	std::memcpy(&value, read_bytes(sizeof(T)), sizeof(T));
+	return value;
+}
+
+inline const std::uint8_t* RecordReader::read_bytes(std::size_t num_bytes) {
+	CD_ASSERT(offset + num_bytes <= size);
+	const std::uint8_t* bytes = data + offset;
+	offset += num_bytes;
+	return bytes;
+}
+
+inline bool RecordReader::at_end() const {
+	return offset == size;
+}
+
+}
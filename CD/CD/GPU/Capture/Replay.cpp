@@ -0,0 +1,610 @@
+#include <CD/GPU/Capture/Replay.hpp>
+#include <CD/Common/Clock.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+namespace CD::GPU::Capture {
+
+static std::uint64_t signal_key(const Signal& signal) {
+	return static_cast<std::uint64_t>(signal.queue) << 56 | signal.value;
+}
+
+static void remap(TextureView& view, const HandleTable& handles) {
+	view.texture = handles.get(view.texture);
+}
+
+static void remap(PipelineInputElement& element, PipelineInputGroupType type, const HandleTable& handles) {
+	if(type == PipelineInputGroupType::ResourceList) {
+		element.resource_list = handles.get(element.resource_list);
+	}
+	else if(type == PipelineInputGroupType::Buffer) {
+		element.buffer.buffer = handles.get(element.buffer.buffer);
+	}
+}
+
+static void remap(PipelineInputState& state, const HandleTable& handles) {
+	for(std::uint32_t i = 0; i < state.num_elements; ++i) {
+		remap(state.input_elements[i], state.types[i], handles);
+	}
+}
+
+template<typename CommandDesc>
+static void remap_command(CommandDesc&, const HandleTable&) {
+}
+
+static void remap_command(DrawIndirectDesc& desc, const HandleTable& handles) {
+	desc.args = handles.get(desc.args);
+	desc.count = handles.get(desc.count);
+}
+
+static void remap_command(DrawIndexedIndirectDesc& desc, const HandleTable& handles) {
+	desc.args = handles.get(desc.args);
+	desc.count = handles.get(desc.count);
+}
+
+static void remap_command(SetGraphicsPipelineDesc& desc, const HandleTable& handles) {
+	desc.graphics_pipeline = handles.get(desc.graphics_pipeline);
+}
+
+static void remap_command(SetInputGroupDesc& desc, const HandleTable& handles) {
+	remap(desc.input, desc.type, handles);
+}
+
+static void remap_command(SetVertexStreamsDesc& desc, const HandleTable& handles) {
+	desc.input_buffer = handles.get(desc.input_buffer);
+}
+
+static void remap_command(SetIndexBufferDesc& desc, const HandleTable& handles) {
+	desc.index_buffer = handles.get(desc.index_buffer);
+}
+
+static void remap_command(LayoutBarrierDesc& desc, const HandleTable& handles) {
+	remap(desc.texture, handles);
+}
+
+static void remap_command(ResourceBarrierDesc& desc, const HandleTable& handles) {
+	for(std::uint32_t i = 0; i < desc.num_buffer_barriers; ++i) {
+		desc.buffers[i] = handles.get(desc.buffers[i]);
+	}
+	for(std::uint32_t i = 0; i < desc.num_texture_barriers; ++i) {
+		desc.textures[i] = handles.get(desc.textures[i]);
+	}
+}
+
+static void remap_command(DispatchDesc& desc, const HandleTable& handles) {
+	desc.compute_pipeline = handles.get(desc.compute_pipeline);
+	remap(desc.pipeline_input_state, handles);
+}
+
+static void remap_command(DispatchIndirectDesc& desc, const HandleTable& handles) {
+	desc.compute_pipeline = handles.get(desc.compute_pipeline);
+	remap(desc.pipeline_input_state, handles);
+	desc.args = handles.get(desc.args);
+}
+
+static void remap_command(BeginRenderPassDesc& desc, const HandleTable& handles) {
+	for(std::uint32_t i = 0; i < desc.render_target_count; ++i) {
+		remap(desc.color[i], handles);
+	}
+	remap(desc.depth_stencil_target, handles);
+	desc.render_pass = handles.get(desc.render_pass);
+}
+
+static void remap_command(CopyBufferDesc& desc, const HandleTable& handles) {
+	desc.dst = handles.get(desc.dst);
+	desc.src = handles.get(desc.src);
+}
+
+static void remap_command(CopyBufferToTextureDesc& desc, const HandleTable& handles) {
+	remap(desc.texture, handles);
+	desc.buffer = handles.get(desc.buffer);
+}
+
+static void remap_command(CopyTextureDesc& desc, const HandleTable& handles) {
+	remap(desc.dst, handles);
+	remap(desc.src, handles);
+}
+
+static void remap_command(CopyTextureToBufferDesc& desc, const HandleTable& handles) {
+	remap(desc.texture, handles);
+	desc.buffer = handles.get(desc.buffer);
+}
+
+static void remap_command(ResolveTimestampsDesc& desc, const HandleTable& handles) {
+	desc.dest = handles.get(desc.dest);
+}
+
+static void remap_command(CopyToSwapChainDesc& desc, const HandleTable& handles) {
+	remap(desc.texture, handles);
+}
+
+static void remap_command(UseTextureDesc& desc, const HandleTable& handles) {
+	remap(desc.texture, handles);
+}
+
+static void remap_command(ResolvePipelineStatisticsDesc& desc, const HandleTable& handles) {
+	desc.dest = handles.get(desc.dest);
+}
+
+template<typename CommandDesc>
+static void add_command(CommandBuffer& command_buffer, const std::uint8_t* command, std::uint32_t size, const HandleTable& handles) {
+	const std::uint32_t command_size = std::min(size, static_cast<std::uint32_t>(sizeof(CommandDesc)));
+
+	CommandDesc desc;
+	std::memcpy(&desc, command, command_size);
+	remap_command(desc, handles);
+	command_buffer.add_command(desc, command_size);
+}
+
+static Shader read_shader(RecordReader& reader) {
+	const std::uint64_t size = reader.read<std::uint64_t>();
+	if(!size) {
+		return {};
+	}
+	return {reader.read_bytes(size), size};
+}
+
+HandleTable::HandleTable(GPU::Device& device) :
+	device(device) {
+}
+
+BufferHandle HandleTable::get(BufferHandle captured) const {
+	auto it = buffers.find(resource_key(captured));
+	return it != buffers.end() ? it->second : BufferHandle::Null;
+}
+
+TextureHandle HandleTable::get(TextureHandle captured) const {
+	auto it = textures.find(resource_key(captured));
+	return it != textures.end() ? it->second : TextureHandle::Null;
+}
+
+PipelineHandle HandleTable::get(PipelineHandle captured) const {
+	auto it = pipeline_resources.find(resource_key(captured));
+	return it != pipeline_resources.end() ? it->second : PipelineHandle {0, captured.type};
+}
+
+void HandleTable::add(BufferHandle captured, BufferHandle handle) {
+	remove(captured);
+	buffers.emplace(resource_key(captured), handle);
+}
+
+void HandleTable::add(TextureHandle captured, TextureHandle handle) {
+	remove(captured);
+	textures.emplace(resource_key(captured), handle);
+}
+
+void HandleTable::add(PipelineHandle captured, PipelineHandle handle) {
+	remove(captured);
+	pipeline_resources.emplace(resource_key(captured), handle);
+}
+
+void HandleTable::remove(BufferHandle captured) {
+	auto it = buffers.find(resource_key(captured));
+	if(it != buffers.end()) {
+		device.destroy_buffer(it->second);
+		buffers.erase(it);
+	}
+}
+
+void HandleTable::remove(TextureHandle captured) {
+	auto it = textures.find(resource_key(captured));
+	if(it != textures.end()) {
+		device.destroy_texture(it->second);
+		textures.erase(it);
+	}
+}
+
+void HandleTable::remove(PipelineHandle captured) {
+	auto it = pipeline_resources.find(resource_key(captured));
+	if(it != pipeline_resources.end()) {
+		device.destroy_pipeline_resource(it->second);
+		pipeline_resources.erase(it);
+	}
+}
+
+void HandleTable::clear() {
+	for(const auto& [key, handle] : pipeline_resources) {
+		device.destroy_pipeline_resource(handle);
+	}
+	for(const auto& [key, handle] : textures) {
+		device.destroy_texture(handle);
+	}
+	for(const auto& [key, handle] : buffers) {
+		device.destroy_buffer(handle);
+	}
+
+	pipeline_resources.clear();
+	textures.clear();
+	buffers.clear();
+}
+
+Replay::Replay(GPU::Device& device) :
+	device(device),
+	num_setup_records(),
+	handles(device),
+	statistics() {
+}
+
+Replay::~Replay() {
+	destroy_resources();
+}
+
+bool Replay::load(std::istream& stream) {
+	capture.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	records.clear();
+	frames.clear();
+	num_setup_records = 0;
+
+	const FileHeader expected = file_header();
+	FileHeader header {};
+	if(capture.size() < sizeof(FileHeader)) {
+		return false;
+	}
+	std::memcpy(&header, capture.data(), sizeof(FileHeader));
+	if(std::memcmp(&header, &expected, sizeof(FileHeader))) {
+		return false;
+	}
+
+	std::size_t offset = sizeof(FileHeader);
+	while(offset + sizeof(RecordHeader) <= capture.size()) {
+		RecordHeader record;
+		std::memcpy(&record, &capture[offset], sizeof(RecordHeader));
+		offset += sizeof(RecordHeader);
+
+		if(record.type >= RecordType::Count || record.size > capture.size() - offset) {
+			return false;
+		}
+
+		if(record.type == RecordType::BeginFrame) {
+			if(frames.empty()) {
+				num_setup_records = records.size();
+			}
+			frames.push_back({records.size(), records.size()});
+		}
+
+		records.push_back({record.type, &capture[offset], record.size});
+		offset += record.size;
+
+		if(!frames.empty()) {
+			frames.back().end = records.size();
+		}
+	}
+
+	if(frames.empty()) {
+		num_setup_records = records.size();
+	}
+
+	return offset == capture.size();
+}
+
+void Replay::create_resources() {
+	CD_PROFILE_SCOPE("Capture::Replay::create_resources");
+	for(std::size_t i = 0; i < num_setup_records; ++i) {
+		replay_record(records[i]);
+	}
+}
+
+void Replay::replay_frame(std::size_t index) {
+	CD_PROFILE_SCOPE("Capture::Replay::replay_frame");
+	CD_ASSERT(index < frames.size());
+
+	for(std::size_t i = frames[index].begin; i < frames[index].end; ++i) {
+		replay_record(records[i]);
+	}
+}
+
+void Replay::destroy_resources() {
+	handles.clear();
+	signals.clear();
+}
+
+void Replay::reset_statistics() {
+	statistics = {};
+}
+
+void Replay::replay_record(const Record& record) {
+	RecordReader reader(record.data, record.size);
+
+	switch(record.type) {
+	case RecordType::CreateBuffer: {
+		BufferHandle captured = reader.read<BufferHandle>();
+		handles.add(captured, device.create_buffer(reader.read<BufferDesc>()));
+		break;
+	}
+	case RecordType::CreateTexture: {
+		TextureHandle captured = reader.read<TextureHandle>();
+		handles.add(captured, device.create_texture(reader.read<TextureDesc>()));
+		break;
+	}
+	case RecordType::CreateRenderPass: {
+		PipelineHandle captured = reader.read<PipelineHandle>();
+		RenderPassDesc desc = reader.read<RenderPassDesc>();
+		RenderPassDepthStencilTargetDesc depth_stencil_target;
+		if(reader.read<bool>()) {
+			depth_stencil_target = reader.read<RenderPassDepthStencilTargetDesc>();
+			desc.depth_stencil_target = &depth_stencil_target;
+		}
+		handles.add(captured, device.create_render_pass(desc));
+		break;
+	}
+	case RecordType::CreatePipelineInputList: {
+		PipelineHandle captured = reader.read<PipelineHandle>();
+		handles.add(captured, device.create_pipeline_input_list(reader.read<std::uint32_t>()));
+		break;
+	}
+	case RecordType::CreateGraphicsPipeline: {
+		PipelineHandle captured = reader.read<PipelineHandle>();
+		GraphicsPipelineDesc desc = reader.read<GraphicsPipelineDesc>();
+		PipelineInputLayout layout = reader.read<PipelineInputLayout>();
+
+		const std::uint32_t num_elements = reader.read<std::uint32_t>();
+		std::vector<InputElement> elements(num_elements);
+		std::vector<std::string> names(num_elements);
+		for(std::uint32_t i = 0; i < num_elements; ++i) {
+			elements[i] = reader.read<InputElement>();
+			const std::uint32_t name_size = reader.read<std::uint32_t>();
+			names[i].assign(reinterpret_cast<const char*>(reader.read_bytes(name_size)), name_size);
+			elements[i].name = names[i].c_str();
+		}
+		desc.input_layout = {elements.data(), num_elements};
+
+		desc.vs = read_shader(reader);
+		desc.ps = read_shader(reader);
+		desc.gs = read_shader(reader);
+		desc.ds = read_shader(reader);
+		desc.hs = read_shader(reader);
+
+		handles.add(captured, device.create_pipeline_state(desc, layout));
+		break;
+	}
+	case RecordType::CreateComputePipeline: {
+		PipelineHandle captured = reader.read<PipelineHandle>();
+		PipelineInputLayout layout = reader.read<PipelineInputLayout>();
+		ComputePipelineDesc desc {read_shader(reader)};
+		handles.add(captured, device.create_pipeline_state(desc, layout));
+		break;
+	}
+	case RecordType::DestroyBuffer:
+		handles.remove(reader.read<BufferHandle>());
+		break;
+	case RecordType::DestroyTexture:
+		handles.remove(reader.read<TextureHandle>());
+		break;
+	case RecordType::DestroyPipelineResource:
+		handles.remove(reader.read<PipelineHandle>());
+		break;
+	case RecordType::UpdateInputListTextures: {
+		PipelineHandle list = handles.get(reader.read<PipelineHandle>());
+		DescriptorType type = reader.read<DescriptorType>();
+		std::uint64_t offset = reader.read<std::uint64_t>();
+		std::vector<TextureView> views(reader.read<std::uint64_t>());
+		for(TextureView& view : views) {
+			view = reader.read<TextureView>();
+			remap(view, handles);
+		}
+		device.update_pipeline_input_list(list, type, views.data(), views.size(), offset);
+		break;
+	}
+	case RecordType::UpdateInputListBuffers: {
+		PipelineHandle list = handles.get(reader.read<PipelineHandle>());
+		DescriptorType type = reader.read<DescriptorType>();
+		std::uint64_t offset = reader.read<std::uint64_t>();
+		std::vector<BufferView> views(reader.read<std::uint64_t>());
+		for(BufferView& view : views) {
+			view = reader.read<BufferView>();
+			view.buffer = handles.get(view.buffer);
+		}
+		device.update_pipeline_input_list(list, type, views.data(), views.size(), offset);
+		break;
+	}
+	case RecordType::WriteBuffer: {
+		BufferHandle buffer = handles.get(reader.read<BufferHandle>());
+		std::uint64_t offset = reader.read<std::uint64_t>();
+		std::uint64_t size = reader.read<std::uint64_t>();
+		const std::uint8_t* data = reader.read_bytes(size);
+		if(buffer != BufferHandle::Null) {
+			void* memory;
+			device.map_buffer(buffer, &memory, offset, size);
+			std::memcpy(memory, data, size);
+			device.unmap_buffer(buffer, offset, size);
+		}
+		break;
+	}
+	case RecordType::Signal:
+		device.signal(reader.read<CommandQueueType>());
+		break;
+	case RecordType::Wait: {
+		Signal producer = reader.read<Signal>();
+		CommandQueueType queue = reader.read<CommandQueueType>();
+		if(const Signal* signal = find_signal(producer)) {
+			device.wait(*signal, queue);
+		}
+		break;
+	}
+	case RecordType::WaitForFence:
+		if(const Signal* signal = find_signal(reader.read<Signal>())) {
+			device.wait_for_fence(*signal);
+		}
+		break;
+	case RecordType::Submit:
+		replay_submit(reader);
+		break;
+	case RecordType::BeginFrame:
+		break;
+	case RecordType::Present: {
+		Signal captured = reader.read<Signal>();
+		add_signal(captured, device.reset());
+		++statistics.frames;
+		break;
+	}
+	case RecordType::ResizeBuffers: {
+		std::uint32_t width = reader.read<std::uint32_t>();
+		std::uint32_t height = reader.read<std::uint32_t>();
+		device.resize_buffers(width, height);
+		break;
+	}
+	case RecordType::ReserveQueries: {
+		QueryType type = reader.read<QueryType>();
+		std::uint32_t count = reader.read<std::uint32_t>();
+		device.reserve_queries(type, count);
+		break;
+	}
+	default:
+		CD_FAIL("unknown capture record");
+		break;
+	}
+
+	CD_ASSERT(reader.at_end());
+}
+
+void Replay::replay_submit(RecordReader& reader) {
+	CommandQueueType queue = reader.read<CommandQueueType>();
+	Signal captured = reader.read<Signal>();
+	std::uint32_t num_command_buffers = reader.read<std::uint32_t>();
+	CD_ASSERT(num_command_buffers <= max_submit_command_buffers);
+
+	while(command_buffers.size() < num_command_buffers) {
+		command_buffers.push_back(std::make_unique<CommandBuffer>(command_pages));
+	}
+
+	const CommandBuffer* submitted[max_submit_command_buffers];
+	for(std::uint32_t i = 0; i < num_command_buffers; ++i) {
+		std::uint32_t num_commands = reader.read<std::uint32_t>();
+		std::uint64_t num_bytes = reader.read<std::uint64_t>();
+
+		CommandBuffer& command_buffer = *command_buffers[i];
+		replay_commands(command_buffer, reader.read_bytes(num_bytes), num_bytes);
+		CD_ASSERT(command_buffer.get_command_count() == num_commands);
+
+		submitted[i] = &command_buffer;
+		statistics.commands += num_commands;
+		statistics.command_bytes += num_bytes;
+	}
+
+	Clock clock;
+	Signal signal = device.submit_commands(submitted, num_command_buffers, queue);
+	statistics.submit_ms += clock.get_elapsed_time_ms();
+
+	++statistics.submits;
+	statistics.command_buffers += num_command_buffers;
+	add_signal(captured, signal);
+
+	for(std::uint32_t i = 0; i < num_command_buffers; ++i) {
+		command_buffers[i]->reset();
+	}
+}
+
+void Replay::replay_commands(CommandBuffer& command_buffer, const std::uint8_t* data, std::uint64_t num_bytes) {
+	for(std::uint64_t offset = 0; offset < num_bytes;) {
+		const std::uint8_t* command = data + offset;
+
+		CommandBase base(CommandType::Invalid, 0);
+		std::memcpy(&base, command, sizeof(CommandBase));
+		CD_ASSERT(base.size && offset + base.size <= num_bytes);
+
+		switch(base.type) {
+		case CommandType::Draw:
+			add_command<DrawDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::DrawIndexed:
+			add_command<DrawIndexedDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::DrawIndirect:
+			add_command<DrawIndirectDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::DrawIndexedIndirect:
+			add_command<DrawIndexedIndirectDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::SetGraphicsPipeline:
+			add_command<SetGraphicsPipelineDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::SetInputGroup:
+			add_command<SetInputGroupDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::SetVertexStreams:
+			add_command<SetVertexStreamsDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::SetIndexBuffer:
+			add_command<SetIndexBufferDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::SetScissor:
+			add_command<SetScissorDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::LayoutBarrier:
+			add_command<LayoutBarrierDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::ResourceBarrier:
+			add_command<ResourceBarrierDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::Dispatch:
+			add_command<DispatchDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::DispatchIndirect:
+			add_command<DispatchIndirectDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::BeginRenderPass:
+			add_command<BeginRenderPassDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::EndRenderPass:
+			add_command<EndRenderPassDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::CopyBuffer:
+			add_command<CopyBufferDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::CopyBufferToTexture:
+			add_command<CopyBufferToTextureDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::CopyTexture:
+			add_command<CopyTextureDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::CopyTextureToBuffer:
+			add_command<CopyTextureToBufferDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::InsertTimestamp:
+			add_command<InsertTimestampDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::ResolveTimestamps:
+			add_command<ResolveTimestampsDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::CopyToSwapChain:
+			add_command<CopyToSwapChainDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::BeginScope:
+			add_command<BeginScopeDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::EndScope:
+			add_command<EndScopeDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::UseTexture:
+			add_command<UseTextureDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::BeginPipelineStatistics:
+			add_command<BeginPipelineStatisticsDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::EndPipelineStatistics:
+			add_command<EndPipelineStatisticsDesc>(command_buffer, command, base.size, handles);
+			break;
+		case CommandType::ResolvePipelineStatistics:
+			add_command<ResolvePipelineStatisticsDesc>(command_buffer, command, base.size, handles);
+			break;
+		default:
+			CD_FAIL("unknown command in capture");
+			break;
+		}
+
+		offset += base.size;
+	}
+}
+
+void Replay::add_signal(const Signal& captured, const Signal& signal) {
+	signals[signal_key(captured)] = signal;
+}
+
+const Signal* Replay::find_signal(const Signal& captured) const {
+	auto it = signals.find(signal_key(captured));
+	return it != signals.end() ? &it->second : nullptr;
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <CD/GPU/Device.hpp>
+#include <CD/GPU/Capture/Format.hpp>
+#include <istream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace CD::GPU::Capture {
+
+struct ReplayStatistics {
+	std::uint64_t frames;
+	std::uint64_t submits;
+	std::uint64_t command_buffers;
+	std::uint64_t commands;
+	std::uint64_t command_bytes;
+	double submit_ms;
+};
+
+// Maps the handles stored in a capture to the resources recreated on the replay device.
+class HandleTable {
+public:
+	HandleTable(GPU::Device&);
+
+	BufferHandle get(BufferHandle captured) const;
+	TextureHandle get(TextureHandle captured) const;
+	PipelineHandle get(PipelineHandle captured) const;
+
+	void add(BufferHandle captured, BufferHandle);
+	void add(TextureHandle captured, TextureHandle);
+	void add(PipelineHandle captured, PipelineHandle);
+
+	void remove(BufferHandle captured);
+	void remove(TextureHandle captured);
+	void remove(PipelineHandle captured);
+	void clear();
+private:
+	GPU::Device& device;
+
+	std::unordered_map<std::uint64_t, BufferHandle> buffers;
+	std::unordered_map<std::uint64_t, TextureHandle> textures;
+	std::unordered_map<std::uint64_t, PipelineHandle> pipeline_resources;
+};
+
+// Feeds a capture back into any device. Records before the first frame recreate the resources that
+// were alive when the capture started, each frame can then be replayed any number of times.
+class Replay {
+public:
+	Replay(GPU::Device&);
+	~Replay();
+
+	Replay(const Replay&) = delete;
+	Replay& operator=(const Replay&) = delete;
+
+	bool load(std::istream&);
+
+	void create_resources();
+	void replay_frame(std::size_t index);
+	void destroy_resources();
+
+	std::size_t get_frame_count() const;
+	const ReplayStatistics& get_statistics() const;
+	void reset_statistics();
+private:
+	struct Record {
+		RecordType type;
+		const std::uint8_t* data;
+		std::size_t size;
+	};
+
+	struct FrameRange {
+		std::size_t begin;
+		std::size_t end;
+	};
+
+	GPU::Device& device;
+
+	std::vector<std::uint8_t> capture;
+	std::vector<Record> records;
+	std::vector<FrameRange> frames;
+	std::size_t num_setup_records;
+
+	HandleTable handles;
+	std::unordered_map<std::uint64_t, Signal> signals;
+
+	CommandPagePool command_pages;
+	std::vector<std::unique_ptr<CommandBuffer>> command_buffers;
+
+	ReplayStatistics statistics;
+
+	void replay_record(const Record&);
+	void replay_submit(RecordReader&);
+	void replay_commands(CommandBuffer&, const std::uint8_t* data, std::uint64_t num_bytes);
+
+	void add_signal(const Signal& captured, const Signal&);
+	const Signal* find_signal(const Signal& captured) const;
+};
+
+inline std::size_t Replay::get_frame_count() const {
+	return frames.size();
+}
+
+inline const ReplayStatistics& Replay::get_statistics() const {
+	return statistics;
+}
+
+}
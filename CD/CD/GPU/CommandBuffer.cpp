@@ -0,0 +1,144 @@
+#include <CD/GPU/CommandBuffer.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace CD::GPU {
+
+const char* get_command_type_name(CommandType type) {
+	constexpr const char* names[command_type_count] {
+		"Draw",
+		"DrawIndexed",
+		"DrawIndirect",
+		"DrawIndexedIndirect",
+		"SetGraphicsPipeline",
+		"SetInputGroup",
+		"SetVertexStreams",
+		"SetIndexBuffer",
+		"SetScissor",
+		"LayoutBarrier",
+		"ResourceBarrier",
+		"Dispatch",
+		"DispatchIndirect",
+		"BeginRenderPass",
+		"EndRenderPass",
+		"CopyBuffer",
+		"CopyBufferToTexture",
+		"CopyTexture",
+		"CopyTextureToBuffer",
+		"InsertTimestamp",
+		"ResolveTimestamps",
+		"CopyToSwapChain",
+		"BeginScope",
+		"EndScope",
+		"UseTexture",
+		"BeginPipelineStatistics",
+		"EndPipelineStatistics",
+		"ResolvePipelineStatistics"
+	};
+
+	CD_ASSERT(type < CommandType::Invalid);
+	return names[static_cast<std::size_t>(type)];
+}
+
+void add_command_buffer_statistics(SubmitStatistics& total, const CommandBufferStatistics& statistics) {
+	for(std::size_t type = 0; type < command_type_count; ++type) {
+		total.command_counts[type] += statistics.command_counts[type];
+	}
+	total.command_bytes += statistics.command_bytes;
+}
+
+void add_submit_statistics(SubmitStatistics& total, const SubmitStatistics& statistics) {
+	total.submits += statistics.submits;
+	total.command_buffers += statistics.command_buffers;
+	total.reused_command_buffers += statistics.reused_command_buffers;
+	for(std::size_t type = 0; type < command_type_count; ++type) {
+		total.command_counts[type] += statistics.command_counts[type];
+	}
+	total.command_bytes += statistics.command_bytes;
+	total.pipeline_switches += statistics.pipeline_switches;
+	total.root_signature_switches += statistics.root_signature_switches;
+	total.root_argument_binds += statistics.root_argument_binds;
+	total.root_argument_hits += statistics.root_argument_hits;
+	total.barriers += statistics.barriers;
+	total.barrier_calls += statistics.barrier_calls;
+	total.translation_ns += statistics.translation_ns;
+	total.command_allocators += statistics.command_allocators;
+	total.command_allocator_acquires += statistics.command_allocator_acquires;
+	total.command_allocator_reuses += statistics.command_allocator_reuses;
+	total.state_fixups += statistics.state_fixups;
+	total.split_barriers += statistics.split_barriers;
+	total.async_batches += statistics.async_batches;
+	total.queue_waits += statistics.queue_waits;
+	total.async_work += statistics.async_work;
+	total.overlapped_work += statistics.overlapped_work;
+}
+
+CommandPage* CommandPagePool::acquire() {
+	std::lock_guard lock(mutex);
+
+	CommandPage* page = nullptr;
+	if(free_pages.empty()) {
+		page = pages.emplace_back(std::make_unique<CommandPage>()).get();
+		free_pages.reserve(pages.size());
+	}
+	else {
+		page = free_pages.back();
+		free_pages.pop_back();
+	}
+
+	page->next = nullptr;
+	page->offset = 0;
+	return page;
+}
+
+void CommandPagePool::release(CommandPage* first) {
+	std::lock_guard lock(mutex);
+
+	for(CommandPage* page = first; page; page = page->next) {
+		free_pages.push_back(page);
+	}
+}
+
+std::size_t CommandPagePool::get_page_count() const {
+	std::lock_guard lock(mutex);
+	return pages.size();
+}
+
+std::size_t CommandPagePool::get_free_page_count() const {
+	std::lock_guard lock(mutex);
+	return free_pages.size();
+}
+
+std::uint64_t CommandBuffer::allocate_id() {
+	static std::atomic<std::uint64_t> next_id = 1;
+	return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+void begin_scope(CommandBuffer& command_buffer, const char* label, std::uint32_t timestamp_index) {
+	BeginScopeDesc begin {};
+	begin.timestamp_index = timestamp_index;
+
+	const std::size_t label_length = std::min(std::strlen(label), max_scope_label_length - 1);
+	std::memcpy(begin.label, label, label_length);
+	begin.label[label_length] = '\0';
+
+	command_buffer.add_command(begin, begin_scope_command_size(label_length));
+}
+
+void end_scope(CommandBuffer& command_buffer, std::uint32_t timestamp_index) {
+	EndScopeDesc end {};
+	end.timestamp_index = timestamp_index;
+	command_buffer.add_command(end);
+}
+
+CommandScope::CommandScope(CommandBuffer& command_buffer, const char* label, std::uint32_t timestamp_index) :
+	command_buffer(command_buffer),
+	end_timestamp_index(timestamp_index != no_scope_timestamp ? timestamp_index + 1 : no_scope_timestamp) {
+	begin_scope(command_buffer, label, timestamp_index);
+}
+
+CommandScope::~CommandScope() {
+	end_scope(command_buffer, end_timestamp_index);
+}
+
+}
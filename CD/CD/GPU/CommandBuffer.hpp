@@ -2,12 +2,24 @@
 
 #include <CD/GPU/Common.hpp>
 #include <CD/Common/Debug.hpp>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
 
 namespace CD::GPU {
 
 enum class CommandType : std::uint8_t {
 	Draw,
+	DrawIndexed,
+	DrawIndirect,
+	DrawIndexedIndirect,
+	SetGraphicsPipeline,
+	SetInputGroup,
+	SetVertexStreams,
+	SetIndexBuffer,
+	SetScissor,
 	LayoutBarrier,
 	ResourceBarrier,
 	Dispatch,
@@ -21,9 +33,19 @@ enum class CommandType : std::uint8_t {
 	InsertTimestamp,
 	ResolveTimestamps,
 	CopyToSwapChain,
+	BeginScope,
+	EndScope,
+	UseTexture,
+	BeginPipelineStatistics,
+	EndPipelineStatistics,
+	ResolvePipelineStatistics,
 	Invalid
 };
 
+constexpr std::size_t command_type_count = static_cast<std::size_t>(CommandType::Invalid);
+
+const char* get_command_type_name(CommandType);
+
 struct CommandBase {
 	CommandBase(CommandType type, std::uint32_t size) :
 		type(type),
@@ -40,19 +62,86 @@ struct CommandTyped : CommandBase {
 };
 
 struct DrawDesc : CommandTyped<CommandType::Draw> {
+	std::uint32_t num_vertices;
+	std::uint32_t num_instances;
+	std::uint32_t first_vertex;
+};
+
+struct DrawIndexedDesc : CommandTyped<CommandType::DrawIndexed> {
+	std::uint32_t num_indices;
+	std::uint32_t num_instances;
+	std::uint32_t first_index;
+	std::int32_t base_vertex;
+};
+
+struct DrawIndirectBuffer {
+	std::uint32_t num_vertices;
+	std::uint32_t num_instances;
+	std::uint32_t first_vertex;
+	std::uint32_t first_instance;
+};
+
+struct DrawIndexedIndirectBuffer {
+	std::uint32_t num_indices;
+	std::uint32_t num_instances;
+	std::uint32_t first_index;
+	std::int32_t base_vertex;
+	std::uint32_t first_instance;
+};
+
+// Each record in args holds num_constants root constants for the Constants input group at constants_slot,
+// followed by the draw arguments. max_draws records are read, or the count stored in the count buffer when
+// it is smaller. first_instance is not added to SV_InstanceID, so per-draw ids go through the constants.
+struct DrawIndirectDesc : CommandTyped<CommandType::DrawIndirect> {
+	BufferHandle args;
+	std::uint32_t offset;
+	std::uint32_t max_draws;
+	BufferHandle count;
+	std::uint32_t count_offset;
+	std::uint32_t constants_slot;
+	std::uint32_t num_constants;
+};
+
+struct DrawIndexedIndirectDesc : CommandTyped<CommandType::DrawIndexedIndirect> {
+	BufferHandle args;
+	std::uint32_t offset;
+	std::uint32_t max_draws;
+	BufferHandle count;
+	std::uint32_t count_offset;
+	std::uint32_t constants_slot;
+	std::uint32_t num_constants;
+};
+
+struct SetGraphicsPipelineDesc : CommandTyped<CommandType::SetGraphicsPipeline> {
 	PipelineHandle graphics_pipeline;
-	PipelineInputState pipeline_input_state;
-	Scissor rect;
+};
+
+struct SetInputGroupDesc : CommandTyped<CommandType::SetInputGroup> {
+	std::uint32_t slot;
+	PipelineInputGroupType type;
+	PipelineInputElement input;
+};
+
+struct VertexStream {
+	std::uint32_t offset;
+	std::uint32_t size;
+	std::uint32_t stride;
+};
+
+struct SetVertexStreamsDesc : CommandTyped<CommandType::SetVertexStreams> {
 	BufferHandle input_buffer;
+	std::uint32_t num_streams;
+	VertexStream streams[max_vertex_buffers];
+};
+
+struct SetIndexBufferDesc : CommandTyped<CommandType::SetIndexBuffer> {
 	BufferHandle index_buffer;
-	std::uint16_t num_instances;
-	std::uint8_t num_vertex_buffers;
-	std::uint32_t num_elements;
-	std::uint32_t vertex_buffer_offsets[max_vertex_buffers];
-	std::uint32_t vertex_buffer_sizes[max_vertex_buffers];
-	std::uint32_t vertex_buffer_strides[max_vertex_buffers];
-	std::uint32_t index_buffer_size;
-	std::uint32_t index_buffer_offset;
+	std::uint32_t offset;
+	std::uint32_t size;
+};
+
+struct SetScissorDesc : CommandTyped<CommandType::SetScissor> {
+	Scissor rect;
 };
 
 struct LayoutBarrierDesc : CommandTyped<CommandType::LayoutBarrier> {
@@ -62,6 +151,15 @@ struct LayoutBarrierDesc : CommandTyped<CommandType::LayoutBarrier> {
 	bool all_subresources;
 };
 
+// Declares the state the following commands use a texture in, the backend tracks the current state of every
+// subresource and issues the transitions. A texture declared inside a scope may only be accessed until the scope
+// ends, which lets the backend begin the transition to its next declared state early.
+struct UseTextureDesc : CommandTyped<CommandType::UseTexture> {
+	TextureView texture;
+	ResourceState state;
+	bool all_subresources;
+};
+
 struct ResourceBarrierDesc : CommandTyped<CommandType::ResourceBarrier> {
 	BufferHandle buffers[max_resource_barriers];
 	TextureHandle textures[max_resource_barriers];
@@ -148,62 +246,305 @@ struct ResolveTimestampsDesc : CommandTyped<CommandType::ResolveTimestamps> {
 
 struct CopyToSwapChainDesc : CommandTyped<CommandType::CopyToSwapChain> {
 	TextureView texture;
-	ResourceState texture_state;
 	//bool resolve;
 };
 
+constexpr std::size_t max_scope_label_length = 64;
+constexpr std::uint32_t no_scope_timestamp = ~0u;
+
+// Scopes mark named ranges of commands for capture tools. When timestamp_index is set, the backend also writes
+// a timestamp query at that index, EndScope's index is usually the one following its BeginScope.
+struct BeginScopeDesc : CommandTyped<CommandType::BeginScope> {
+	std::uint32_t timestamp_index;
+	char label[max_scope_label_length];
+};
+
+struct EndScopeDesc : CommandTyped<CommandType::EndScope> {
+	std::uint32_t timestamp_index;
+};
+
+// Pipeline statistics queries count the work recorded between the Begin and End commands of an index. Both are
+// recorded in the same command buffer, on the same side of a render pass boundary.
+struct BeginPipelineStatisticsDesc : CommandTyped<CommandType::BeginPipelineStatistics> {
+	std::uint32_t index;
+};
+
+struct EndPipelineStatisticsDesc : CommandTyped<CommandType::EndPipelineStatistics> {
+	std::uint32_t index;
+};
+
+// Writes a PipelineStatistics struct per query.
+struct ResolvePipelineStatisticsDesc : CommandTyped<CommandType::ResolvePipelineStatistics> {
+	std::uint32_t index;
+	std::uint32_t query_count;
+	BufferHandle dest;
+	std::uint32_t aligned_offset;
+};
+
+constexpr std::uint32_t vertex_streams_command_size(std::uint32_t num_streams) {
+	return static_cast<std::uint32_t>(sizeof(SetVertexStreamsDesc) - (max_vertex_buffers - num_streams) * sizeof(VertexStream));
+}
+
+constexpr std::uint32_t begin_scope_command_size(std::size_t label_length) {
+	return static_cast<std::uint32_t>(sizeof(BeginScopeDesc) - (max_scope_label_length - label_length - 1));
+}
+
+constexpr std::uint32_t draw_indirect_stride(std::uint32_t num_constants) {
+	return static_cast<std::uint32_t>(num_constants * sizeof(std::uint32_t) + sizeof(DrawIndirectBuffer));
+}
+
+constexpr std::uint32_t draw_indexed_indirect_stride(std::uint32_t num_constants) {
+	return static_cast<std::uint32_t>(num_constants * sizeof(std::uint32_t) + sizeof(DrawIndexedIndirectBuffer));
+}
+
+constexpr std::size_t command_alignment = 8;
+constexpr std::size_t command_page_size = 1 << 16;
+
+struct CommandBufferStatistics {
+	std::uint32_t command_counts[command_type_count];
+	std::uint64_t command_bytes;
+};
+
+// Counters gathered by a device while submitting and translating command buffers. Root argument hits are binds
+// skipped because the argument was already set, barrier_calls counts the API calls issuing the barriers.
+// command_allocators is the number of allocators the backend holds when the frame is presented. state_fixups
+// counts the transitions inserted at submit time to bring textures into the state a command list starts with.
+// The async counters are filled in by the queue scheduler submitting the frame.
+struct SubmitStatistics {
+	std::uint64_t submits;
+	std::uint64_t command_buffers;
+	std::uint64_t reused_command_buffers;
+	std::uint64_t command_counts[command_type_count];
+	std::uint64_t command_bytes;
+	std::uint64_t pipeline_switches;
+	std::uint64_t root_signature_switches;
+	std::uint64_t root_argument_binds;
+	std::uint64_t root_argument_hits;
+	std::uint64_t barriers;
+	std::uint64_t barrier_calls;
+	std::uint64_t translation_ns;
+	std::uint64_t command_allocators;
+	std::uint64_t command_allocator_acquires;
+	std::uint64_t command_allocator_reuses;
+	std::uint64_t state_fixups;
+	std::uint64_t split_barriers;
+	std::uint64_t async_batches;
+	std::uint64_t queue_waits;
+	std::uint64_t async_work;
+	std::uint64_t overlapped_work;
+};
+
+void add_command_buffer_statistics(SubmitStatistics&, const CommandBufferStatistics&);
+void add_submit_statistics(SubmitStatistics&, const SubmitStatistics&);
+
+struct CommandPage {
+	CommandPage* next;
+	std::uint32_t offset;
+	alignas(command_alignment) std::uint8_t data[command_page_size];
+};
+
+class CommandPagePool {
+public:
+	CommandPagePool() = default;
+
+	CommandPagePool(const CommandPagePool&) = delete;
+	CommandPagePool& operator=(const CommandPagePool&) = delete;
+
+	CommandPage* acquire();
+	void release(CommandPage* first);
+
+	std::size_t get_page_count() const;
+	std::size_t get_free_page_count() const;
+private:
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<CommandPage>> pages;
+	std::vector<CommandPage*> free_pages;
+};
+
+class CommandIterator {
+public:
+	CommandIterator(const CommandPage* page = nullptr, std::uint32_t offset = 0);
+
+	const std::uint8_t* operator*() const;
+	CommandIterator& operator++();
+	bool operator!=(const CommandIterator&) const;
+private:
+	const CommandPage* page;
+	std::uint32_t offset;
+};
+
+// A retained command buffer is translated once by the backend and the result is resubmitted every time
+// the buffer is, until it is modified or reset. Buffers holding CopyToSwapChain are translated each time.
 class CommandBuffer {
 public:
-	CommandBuffer(std::size_t size = default_command_buffer_size);
+	CommandBuffer(CommandPagePool&);
+	~CommandBuffer();
+
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
 
 	template<typename CommandDesc> void add_command(CommandDesc&);
+	template<typename CommandDesc> void add_command(CommandDesc&, std::uint32_t size);
+	void add_command_data(const void* command, std::uint32_t size);
 	void reset();
 
-	const std::uint8_t* get_commands() const;
-	const std::uint8_t* end() const;
+	void set_retained(bool);
+	bool is_retained() const;
+	std::uint64_t get_id() const;
+	std::uint32_t get_generation() const;
+
+	CommandIterator begin() const;
+	CommandIterator end() const;
 	CommandType get_command_type(const void* command) const;
 	std::uint32_t get_command_size(const void* command) const;
 	std::uint32_t get_command_count() const;
+	std::uint32_t get_page_count() const;
+	const CommandBufferStatistics& get_statistics() const;
 private:
-	static constexpr std::size_t default_command_buffer_size = 1 << 20;
-
-	std::unique_ptr<std::uint8_t[]> commands;
-	std::size_t size;
-	std::size_t offset;
+	CommandPagePool& pool;
+	CommandPage* first_page;
+	CommandPage* current_page;
 
+	std::uint32_t page_counter;
 	std::uint32_t command_counter;
+
+	std::uint64_t id;
+	std::uint32_t generation;
+	bool retained;
+
+	CommandBufferStatistics statistics;
+
+	void add_page();
+
+	static std::uint64_t allocate_id();
 };
 
-inline CommandBuffer::CommandBuffer(std::size_t size) :
-	commands(std::make_unique<std::uint8_t[]>(size)),
-	size(size),
-	offset(),
-	command_counter() {
+void begin_scope(CommandBuffer&, const char* label, std::uint32_t timestamp_index = no_scope_timestamp);
+void end_scope(CommandBuffer&, std::uint32_t timestamp_index = no_scope_timestamp);
+
+// Opens a scope for its lifetime, with timestamps written at timestamp_index and timestamp_index + 1 when set.
+class CommandScope {
+public:
+	CommandScope(CommandBuffer&, const char* label, std::uint32_t timestamp_index = no_scope_timestamp);
+	CommandScope(const CommandScope&) = delete;
+	CommandScope(CommandScope&&) = delete;
+	CommandScope& operator=(const CommandScope&) = delete;
+	CommandScope& operator=(CommandScope&&) = delete;
+	~CommandScope();
+private:
+	CommandBuffer& command_buffer;
+	std::uint32_t end_timestamp_index;
+};
+
+inline CommandIterator::CommandIterator(const CommandPage* page, std::uint32_t offset) :
+	page(page),
+	offset(offset) {
+}
+
+inline const std::uint8_t* CommandIterator::operator*() const {
+	return &page->data[offset];
+}
+
+inline CommandIterator& CommandIterator::operator++() {
+	offset += static_cast<const CommandBase*>(static_cast<const void*>(&page->data[offset]))->size;
+	if(offset == page->offset) {
+		page = page->next;
+		offset = 0;
+	}
+	return *this;
+}
+
+inline bool CommandIterator::operator!=(const CommandIterator& other) const {
+	return page != other.page || offset != other.offset;
+}
+
+inline CommandBuffer::CommandBuffer(CommandPagePool& pool) :
+	pool(pool),
+	first_page(nullptr),
+	current_page(nullptr),
+	page_counter(),
+	command_counter(),
+	id(allocate_id()),
+	generation(),
+	retained(false),
+	statistics() {
+}
+
+inline CommandBuffer::~CommandBuffer() {
+	reset();
 }
 
 inline void CommandBuffer::reset() {
-	offset = 0;
+	pool.release(first_page);
+	first_page = nullptr;
+	current_page = nullptr;
+	page_counter = 0;
 	command_counter = 0;
+	++generation;
+	statistics = {};
 }
 
 template<typename CommandDesc>
 inline void CommandBuffer::add_command(CommandDesc& desc) {
+	add_command(desc, sizeof(CommandDesc));
+}
+
+template<typename CommandDesc>
+inline void CommandBuffer::add_command(CommandDesc& desc, std::uint32_t command_size) {
 	static_assert(std::is_trivially_destructible<CommandDesc>::value);
+	static_assert(alignof(CommandDesc) <= command_alignment);
+	static_assert(sizeof(CommandDesc) <= command_page_size);
+	CD_ASSERT(command_size <= sizeof(CommandDesc));
+
+	desc.size = static_cast<std::uint32_t>(align(command_size, command_alignment));
+	if(!current_page || current_page->offset + desc.size > command_page_size) {
+		add_page();
+	}
+
+	std::memcpy(&current_page->data[current_page->offset], &desc, command_size);
+	current_page->offset += desc.size;
+	++command_counter;
+	++generation;
+
+	++statistics.command_counts[static_cast<std::size_t>(desc.type)];
+	statistics.command_bytes += desc.size;
+}
+
+inline void CommandBuffer::add_command_data(const void* command, std::uint32_t size) {
+	CD_ASSERT(size && size == align(size, command_alignment) && size <= command_page_size);
+	CD_ASSERT(static_cast<const CommandBase*>(command)->size == size);
+
+	if(!current_page || current_page->offset + size > command_page_size) {
+		add_page();
+	}
 
-	desc.size = sizeof(desc);
-	std::size_t ptr = align(offset + sizeof(CommandDesc), alignof(CommandDesc));
-	CD_ASSERT(ptr < size);
-	std::memcpy(&commands[offset], &desc, sizeof(CommandDesc));
-	offset = ptr;
+	std::memcpy(&current_page->data[current_page->offset], command, size);
+	current_page->offset += size;
 	++command_counter;
+	++generation;
+
+	++statistics.command_counts[static_cast<std::size_t>(static_cast<const CommandBase*>(command)->type)];
+	statistics.command_bytes += size;
+}
+
+inline void CommandBuffer::add_page() {
+	CommandPage* page = pool.acquire();
+	if(current_page) {
+		current_page->next = page;
+	}
+	else {
+		first_page = page;
+	}
+	current_page = page;
+	++page_counter;
 }
 
-inline const std::uint8_t* CommandBuffer::get_commands() const {
-	return &commands[0];
+inline CommandIterator CommandBuffer::begin() const {
+	return {first_page, 0};
 }
 
-inline const std::uint8_t* CommandBuffer::end() const {
-	return &commands[offset];
+inline CommandIterator CommandBuffer::end() const {
+	return {};
 }
 
 inline CommandType CommandBuffer::get_command_type(const void* command) const {
@@ -218,4 +559,28 @@ inline std::uint32_t CommandBuffer::get_command_count() const {
 	return command_counter;
 }
 
+inline std::uint32_t CommandBuffer::get_page_count() const {
+	return page_counter;
+}
+
+inline const CommandBufferStatistics& CommandBuffer::get_statistics() const {
+	return statistics;
+}
+
+inline void CommandBuffer::set_retained(bool enable) {
+	retained = enable;
+}
+
+inline bool CommandBuffer::is_retained() const {
+	return retained;
+}
+
+inline std::uint64_t CommandBuffer::get_id() const {
+	return id;
+}
+
+inline std::uint32_t CommandBuffer::get_generation() const {
+	return generation;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,415 @@
+#include <CD/GPU/CommandOptimizer.hpp>
+#include <CD/GPU/Utils.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <algorithm>
+
+namespace CD::GPU {
+
+template<typename CommandDesc>
+static const CommandDesc& command_cast(const std::uint8_t* command) {
+	return *static_cast<const CommandDesc*>(static_cast<const void*>(command));
+}
+
+static std::uint64_t resource_key(BufferHandle handle) {
+	return 1ull << 32 | static_cast<std::uint32_t>(handle);
+}
+
+static std::uint64_t resource_key(TextureHandle handle) {
+	return 2ull << 32 | static_cast<std::uint32_t>(handle);
+}
+
+static std::uint64_t subresource_key(const TextureView& view) {
+	return static_cast<std::uint64_t>(view.mip_level) << 32 | static_cast<std::uint64_t>(view.index) << 16 | view.plane;
+}
+
+static bool same_subresources(const LayoutBarrierDesc& l, const LayoutBarrierDesc& r) {
+	if(l.all_subresources || r.all_subresources) {
+		return l.all_subresources == r.all_subresources;
+	}
+	return subresource_key(l.texture) == subresource_key(r.texture);
+}
+
+static bool is_copy(CommandType type) {
+	return type == CommandType::CopyBuffer ||
+		type == CommandType::CopyBufferToTexture ||
+		type == CommandType::CopyTexture ||
+		type == CommandType::CopyTextureToBuffer;
+}
+
+static CommandType command_type(const std::uint8_t* command) {
+	return command_cast<CommandBase>(command).type;
+}
+
+static std::uint64_t copy_source(const std::uint8_t* command) {
+	switch(command_type(command)) {
+	case CommandType::CopyBuffer:
+		return resource_key(command_cast<CopyBufferDesc>(command).src);
+	case CommandType::CopyBufferToTexture:
+		return resource_key(command_cast<CopyBufferToTextureDesc>(command).buffer);
+	case CommandType::CopyTexture:
+		return resource_key(command_cast<CopyTextureDesc>(command).src.texture);
+	case CommandType::CopyTextureToBuffer:
+		return resource_key(command_cast<CopyTextureToBufferDesc>(command).texture.texture);
+	default:
+		CD_FAIL("not a copy");
+	}
+	return 0;
+}
+
+CommandOptimizer::CommandOptimizer() :
+	state(),
+	num_barrier_commands(),
+	num_uav_commands(),
+	statistics() {
+}
+
+void CommandOptimizer::optimize(const CommandBuffer& input, CommandBuffer& output) {
+	CD_PROFILE_SCOPE("CommandOptimizer::optimize");
+
+	state = {};
+	const std::uint32_t output_begin = output.get_command_count();
+
+	for(const std::uint8_t* command : input) {
+		const CommandType type = input.get_command_type(command);
+
+		if(type == CommandType::LayoutBarrier || type == CommandType::ResourceBarrier) {
+			flush_copies(output);
+			if(type == CommandType::LayoutBarrier) {
+				add_transition(command_cast<LayoutBarrierDesc>(command));
+			}
+			else {
+				add_uav_barrier(command_cast<ResourceBarrierDesc>(command));
+			}
+			continue;
+		}
+
+		if(is_copy(type)) {
+			flush_barriers(output);
+			copies.push_back(command);
+			continue;
+		}
+
+		flush_barriers(output);
+		flush_copies(output);
+
+		bool keep = true;
+		switch(type) {
+		case CommandType::SetGraphicsPipeline:
+			keep = bind_graphics_pipeline(command_cast<SetGraphicsPipelineDesc>(command));
+			break;
+		case CommandType::SetInputGroup:
+			keep = bind_input_group(command_cast<SetInputGroupDesc>(command));
+			break;
+		case CommandType::SetVertexStreams:
+			keep = bind_vertex_streams(command_cast<SetVertexStreamsDesc>(command));
+			break;
+		case CommandType::SetIndexBuffer:
+			keep = bind_index_buffer(command_cast<SetIndexBufferDesc>(command));
+			break;
+		case CommandType::SetScissor:
+			keep = bind_scissor(command_cast<SetScissorDesc>(command));
+			break;
+		case CommandType::BeginRenderPass:
+			state.valid_scissor = false;
+			break;
+		case CommandType::DrawIndirect:
+			release_indirect_constants(command_cast<DrawIndirectDesc>(command).constants_slot, command_cast<DrawIndirectDesc>(command).num_constants);
+			break;
+		case CommandType::DrawIndexedIndirect:
+			release_indirect_constants(command_cast<DrawIndexedIndirectDesc>(command).constants_slot, command_cast<DrawIndexedIndirectDesc>(command).num_constants);
+			break;
+		default:
+			break;
+		}
+
+		if(keep) {
+			output.add_command_data(command, input.get_command_size(command));
+		}
+	}
+
+	flush_barriers(output);
+	flush_copies(output);
+
+	statistics.input_commands += input.get_command_count();
+	statistics.output_commands += output.get_command_count() - output_begin;
+}
+
+void CommandOptimizer::reset_statistics() {
+	statistics = {};
+}
+
+CommandOptimizer::CopyRange CommandOptimizer::copy_destination(const std::uint8_t* command) {
+	switch(command_type(command)) {
+	case CommandType::CopyBuffer: {
+		const CopyBufferDesc& copy = command_cast<CopyBufferDesc>(command);
+		return {resource_key(copy.dst), copy.dst_offset, copy.dst_offset + copy.num_bytes};
+	}
+	case CommandType::CopyBufferToTexture: {
+		const CopyBufferToTextureDesc& copy = command_cast<CopyBufferToTextureDesc>(command);
+		return {resource_key(copy.texture.texture), subresource_key(copy.texture), subresource_key(copy.texture) + 1};
+	}
+	case CommandType::CopyTexture: {
+		const CopyTextureDesc& copy = command_cast<CopyTextureDesc>(command);
+		return {resource_key(copy.dst.texture), subresource_key(copy.dst), subresource_key(copy.dst) + 1};
+	}
+	case CommandType::CopyTextureToBuffer: {
+		const CopyTextureToBufferDesc& copy = command_cast<CopyTextureToBufferDesc>(command);
+		return {resource_key(copy.buffer), copy.buffer_offset, copy.buffer_offset + static_cast<std::uint64_t>(copy.row_size) * copy.height};
+	}
+	default:
+		CD_FAIL("not a copy");
+	}
+	return {};
+}
+
+// Transitions of one texture are folded while the previous transition of that texture covers the same subresources.
+void CommandOptimizer::add_transition(const LayoutBarrierDesc& desc) {
+	++num_barrier_commands;
+
+	if(desc.before == desc.after) {
+		++statistics.redundant_transitions;
+		return;
+	}
+
+	for(auto it = transitions.rbegin(); it != transitions.rend(); ++it) {
+		if(it->texture.texture != desc.texture.texture) {
+			continue;
+		}
+
+		if(same_subresources(*it, desc) && it->after == desc.before) {
+			it->after = desc.after;
+			++statistics.redundant_transitions;
+
+			if(it->before == it->after) {
+				transitions.erase(std::next(it).base());
+				++statistics.redundant_transitions;
+			}
+			return;
+		}
+		break;
+	}
+
+	transitions.push_back(desc);
+}
+
+void CommandOptimizer::add_uav_barrier(const ResourceBarrierDesc& desc) {
+	++num_barrier_commands;
+	++num_uav_commands;
+
+	for(std::uint32_t i = 0; i < desc.num_buffer_barriers; ++i) {
+		if(std::find(uav_buffers.begin(), uav_buffers.end(), desc.buffers[i]) == uav_buffers.end()) {
+			uav_buffers.push_back(desc.buffers[i]);
+		}
+	}
+
+	for(std::uint32_t i = 0; i < desc.num_texture_barriers; ++i) {
+		if(std::find(uav_textures.begin(), uav_textures.end(), desc.textures[i]) == uav_textures.end()) {
+			uav_textures.push_back(desc.textures[i]);
+		}
+	}
+}
+
+void CommandOptimizer::flush_barriers(CommandBuffer& output) {
+	if(!num_barrier_commands) {
+		return;
+	}
+
+	for(LayoutBarrierDesc& transition : transitions) {
+		output.add_command(transition);
+	}
+
+	std::uint32_t num_uav_emitted = 0;
+
+	for(std::size_t buffer = 0, texture = 0; buffer < uav_buffers.size() || texture < uav_textures.size();) {
+		ResourceBarrierDesc barrier {};
+		for(; buffer < uav_buffers.size() && barrier.num_buffer_barriers < max_resource_barriers; ++buffer) {
+			barrier.buffers[barrier.num_buffer_barriers++] = uav_buffers[buffer];
+		}
+		for(; texture < uav_textures.size() && barrier.num_texture_barriers < max_resource_barriers; ++texture) {
+			barrier.textures[barrier.num_texture_barriers++] = uav_textures[texture];
+		}
+		output.add_command(barrier);
+		++num_uav_emitted;
+	}
+
+	statistics.merged_barriers += num_uav_commands - num_uav_emitted;
+
+	transitions.clear();
+	uav_buffers.clear();
+	uav_textures.clear();
+	num_barrier_commands = 0;
+	num_uav_commands = 0;
+}
+
+void CommandOptimizer::flush_copies(CommandBuffer& output) {
+	if(copies.empty()) {
+		return;
+	}
+
+	if(copies.size() > 1 && independent_copies()) {
+		auto by_destination = [](const std::uint8_t* l, const std::uint8_t* r) {
+			CopyRange dst_l = copy_destination(l);
+			CopyRange dst_r = copy_destination(r);
+			return dst_l.resource < dst_r.resource || (dst_l.resource == dst_r.resource && dst_l.begin < dst_r.begin);
+		};
+
+		if(!std::is_sorted(copies.begin(), copies.end(), by_destination)) {
+			std::vector<const std::uint8_t*> unsorted = copies;
+			std::stable_sort(copies.begin(), copies.end(), by_destination);
+			for(std::size_t i = 0; i < copies.size(); ++i) {
+				statistics.reordered_copies += copies[i] != unsorted[i];
+			}
+		}
+	}
+
+	CopyBufferDesc merged {};
+	bool pending = false;
+
+	for(const std::uint8_t* command : copies) {
+		if(command_type(command) == CommandType::CopyBuffer) {
+			const CopyBufferDesc& copy = command_cast<CopyBufferDesc>(command);
+			if(pending &&
+				merged.dst == copy.dst &&
+				merged.src == copy.src &&
+				merged.dst_offset + merged.num_bytes == copy.dst_offset &&
+				merged.src_offset + merged.num_bytes == copy.src_offset) {
+				merged.num_bytes += copy.num_bytes;
+				++statistics.merged_copies;
+				continue;
+			}
+
+			if(pending) {
+				output.add_command(merged);
+			}
+			merged = copy;
+			pending = true;
+			continue;
+		}
+
+		if(pending) {
+			output.add_command(merged);
+			pending = false;
+		}
+		output.add_command_data(command, command_cast<CommandBase>(command).size);
+	}
+
+	if(pending) {
+		output.add_command(merged);
+	}
+
+	copies.clear();
+}
+
+// A run of copies can be reordered when no copy reads a resource written in the run and no two writes overlap.
+bool CommandOptimizer::independent_copies() {
+	copy_writes.clear();
+	copy_reads.clear();
+
+	for(const std::uint8_t* command : copies) {
+		copy_writes.push_back(copy_destination(command));
+		copy_reads.push_back(copy_source(command));
+	}
+
+	std::sort(copy_writes.begin(), copy_writes.end(), [](const CopyRange& l, const CopyRange& r) {
+		return l.resource < r.resource || (l.resource == r.resource && l.begin < r.begin);
+	});
+	std::sort(copy_reads.begin(), copy_reads.end());
+
+	for(std::size_t i = 0; i < copy_writes.size(); ++i) {
+		if(i && copy_writes[i - 1].resource == copy_writes[i].resource && copy_writes[i].begin < copy_writes[i - 1].end) {
+			return false;
+		}
+		if(std::binary_search(copy_reads.begin(), copy_reads.end(), copy_writes[i].resource)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CommandOptimizer::bind_graphics_pipeline(const SetGraphicsPipelineDesc& desc) {
+	if(state.valid_pipeline && state.graphics_pipeline == desc.graphics_pipeline) {
+		++statistics.redundant_pipeline_binds;
+		return false;
+	}
+
+	state.graphics_pipeline = desc.graphics_pipeline;
+	state.valid_pipeline = true;
+	state.valid_inputs = 0;
+	return true;
+}
+
+bool CommandOptimizer::bind_input_group(const SetInputGroupDesc& desc) {
+	CD_ASSERT(desc.slot < max_pipeline_layout_entries);
+
+	const std::uint32_t slot_bit = 1 << desc.slot;
+	if(state.valid_inputs & slot_bit && state.input_types[desc.slot] == desc.type && same_input_element(desc.type, desc.input, state.inputs[desc.slot])) {
+		++statistics.redundant_input_binds;
+		return false;
+	}
+
+	state.input_types[desc.slot] = desc.type;
+	state.inputs[desc.slot] = desc.input;
+	state.valid_inputs |= slot_bit;
+	return true;
+}
+
+void CommandOptimizer::release_indirect_constants(std::uint32_t slot, std::uint32_t num_constants) {
+	if(num_constants) {
+		state.valid_inputs &= ~(1 << slot);
+	}
+}
+
+bool CommandOptimizer::bind_vertex_streams(const SetVertexStreamsDesc& desc) {
+	CD_ASSERT(desc.num_streams <= max_vertex_buffers);
+
+	SetVertexStreamsDesc& current = state.vertex_streams;
+	if(state.valid_vertex_streams &&
+		current.input_buffer == desc.input_buffer &&
+		current.num_streams == desc.num_streams &&
+		!std::memcmp(current.streams, desc.streams, desc.num_streams * sizeof(VertexStream))) {
+		++statistics.redundant_vertex_streams;
+		return false;
+	}
+
+	current.input_buffer = desc.input_buffer;
+	current.num_streams = desc.num_streams;
+	std::memcpy(current.streams, desc.streams, desc.num_streams * sizeof(VertexStream));
+	state.valid_vertex_streams = true;
+	return true;
+}
+
+bool CommandOptimizer::bind_index_buffer(const SetIndexBufferDesc& desc) {
+	SetIndexBufferDesc& current = state.index_buffer;
+	if(state.valid_index_buffer &&
+		current.index_buffer == desc.index_buffer &&
+		current.offset == desc.offset &&
+		current.size == desc.size) {
+		++statistics.redundant_index_buffers;
+		return false;
+	}
+
+	current.index_buffer = desc.index_buffer;
+	current.offset = desc.offset;
+	current.size = desc.size;
+	state.valid_index_buffer = true;
+	return true;
+}
+
+bool CommandOptimizer::bind_scissor(const SetScissorDesc& desc) {
+	const Scissor& current = state.scissor;
+	if(state.valid_scissor &&
+		current.left == desc.rect.left &&
+		current.top == desc.rect.top &&
+		current.right == desc.rect.right &&
+		current.bottom == desc.rect.bottom) {
+		++statistics.redundant_scissors;
+		return false;
+	}
+
+	state.scissor = desc.rect;
+	state.valid_scissor = true;
+	return true;
+}
+
+}
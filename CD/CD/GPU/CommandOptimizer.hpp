@@ -0,0 +1,91 @@
+#pragma once
+
+#include <CD/GPU/CommandBuffer.hpp>
+#include <vector>
+
+namespace CD::GPU {
+
+struct CommandOptimizerStatistics {
+	std::uint64_t input_commands;
+	std::uint64_t output_commands;
+	std::uint64_t redundant_transitions;
+	std::uint64_t merged_barriers;
+	std::uint64_t redundant_pipeline_binds;
+	std::uint64_t redundant_input_binds;
+	std::uint64_t redundant_vertex_streams;
+	std::uint64_t redundant_index_buffers;
+	std::uint64_t redundant_scissors;
+	std::uint64_t reordered_copies;
+	std::uint64_t merged_copies;
+};
+
+// Rewrites a recorded command buffer into an equivalent, shorter one. Runs of barriers are folded into
+// a single batch, binds matching the current state are dropped and runs of independent copies are
+// sorted by destination so contiguous buffer copies can be merged.
+class CommandOptimizer {
+public:
+	CommandOptimizer();
+
+	CommandOptimizer(const CommandOptimizer&) = delete;
+	CommandOptimizer& operator=(const CommandOptimizer&) = delete;
+
+	void optimize(const CommandBuffer& input, CommandBuffer& output);
+
+	const CommandOptimizerStatistics& get_statistics() const;
+	void reset_statistics();
+private:
+	struct BindState {
+		PipelineHandle graphics_pipeline;
+		PipelineInputGroupType input_types[max_pipeline_layout_entries];
+		PipelineInputElement inputs[max_pipeline_layout_entries];
+		std::uint32_t valid_inputs;
+		SetVertexStreamsDesc vertex_streams;
+		SetIndexBufferDesc index_buffer;
+		Scissor scissor;
+		bool valid_pipeline;
+		bool valid_vertex_streams;
+		bool valid_index_buffer;
+		bool valid_scissor;
+	};
+
+	struct CopyRange {
+		std::uint64_t resource;
+		std::uint64_t begin;
+		std::uint64_t end;
+	};
+
+	BindState state;
+
+	std::vector<LayoutBarrierDesc> transitions;
+	std::vector<BufferHandle> uav_buffers;
+	std::vector<TextureHandle> uav_textures;
+	std::uint32_t num_barrier_commands;
+	std::uint32_t num_uav_commands;
+
+	std::vector<const std::uint8_t*> copies;
+	std::vector<CopyRange> copy_writes;
+	std::vector<std::uint64_t> copy_reads;
+
+	CommandOptimizerStatistics statistics;
+
+	void add_transition(const LayoutBarrierDesc&);
+	void add_uav_barrier(const ResourceBarrierDesc&);
+	void flush_barriers(CommandBuffer&);
+	void flush_copies(CommandBuffer&);
+	bool independent_copies();
+
+	static CopyRange copy_destination(const std::uint8_t* command);
+
+	bool bind_graphics_pipeline(const SetGraphicsPipelineDesc&);
+	bool bind_input_group(const SetInputGroupDesc&);
+	void release_indirect_constants(std::uint32_t slot, std::uint32_t num_constants);
+	bool bind_vertex_streams(const SetVertexStreamsDesc&);
+	bool bind_index_buffer(const SetIndexBufferDesc&);
+	bool bind_scissor(const SetScissorDesc&);
+};
+
+inline const CommandOptimizerStatistics& CommandOptimizer::get_statistics() const {
+	return statistics;
+}
+
+}
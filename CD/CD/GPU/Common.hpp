@@ -8,20 +8,23 @@ constexpr std::size_t swapchain_backbuffer_count = 3;
 constexpr std::size_t max_render_targets = 8;
 constexpr std::size_t max_input_elements = 8;
 constexpr std::size_t max_vertex_buffers = 8;
-constexpr std::size_t max_timestamp_queries = 100;
+constexpr std::size_t default_timestamp_queries = 100;
+constexpr std::size_t default_pipeline_statistics_queries = 48;
 constexpr std::size_t max_resource_list_ranges = 3;
 constexpr std::size_t max_pipeline_layout_entries = 8;
 constexpr std::size_t max_pipeline_layout_samplers = 8;
 constexpr std::size_t max_resource_barriers = 8;
+constexpr std::size_t max_submit_command_buffers = 64;
+constexpr std::size_t max_root_constants = 4;
 
-enum class BufferHandle : std::uint16_t {
+enum class BufferHandle : std::uint32_t {
 	Null,
-	Invalid = 65535
+	Invalid = 0xFFFFFFFF
 };
 
-enum class TextureHandle : std::uint16_t {
+enum class TextureHandle : std::uint32_t {
 	Null,
-	Invalid = 65535
+	Invalid = 0xFFFFFFFF
 };
 
 enum class PipelineResourceType : std::uint8_t {
@@ -43,6 +46,12 @@ enum CommandQueueType : std::uint8_t {
 	CommandQueueType_Count
 };
 
+enum QueryType : std::uint8_t {
+	QueryType_Timestamp,
+	QueryType_PipelineStatistics,
+	QueryType_Count
+};
+
 struct Signal {
 	CommandQueueType queue;
 	std::uint64_t value;
@@ -265,7 +274,8 @@ enum class DescriptorType {
 
 enum class PipelineInputGroupType {
 	ResourceList,
-	Buffer
+	Buffer,
+	Constants
 };
 
 struct ResourceListDesc {
@@ -287,11 +297,18 @@ struct PipelineInputBufferDesc {
 	std::uint32_t binding_space;
 };
 
+struct PipelineInputConstantsDesc {
+	std::uint32_t binding_slot;
+	std::uint32_t binding_space;
+	std::uint32_t num_constants;
+};
+
 struct PipelineInputGroup {
 	PipelineInputGroupType type;
 	union {
 		PipelineInputListDesc resource_lists;
 		PipelineInputBufferDesc buffer;
+		PipelineInputConstantsDesc constants;
 	};
 };
 
@@ -533,12 +550,20 @@ struct PipelineInputBuffer {
 	DescriptorType type;
 };
 
+struct PipelineInputConstants {
+	std::uint32_t values[max_root_constants];
+	std::uint32_t num_values;
+};
+
+union PipelineInputElement {
+	PipelineHandle resource_list;
+	PipelineInputBuffer buffer;
+	PipelineInputConstants constants;
+};
+
 struct PipelineInputState {
 	PipelineInputGroupType types[max_pipeline_layout_entries];
-	union {
-		PipelineHandle resource_list;
-		PipelineInputBuffer buffer;
-	} input_elements[max_pipeline_layout_entries];
+	PipelineInputElement input_elements[max_pipeline_layout_entries];
 	std::uint32_t num_elements;
 };
 
@@ -577,4 +602,19 @@ struct DeviceFeatureInfo {
 	std::uint64_t timestamp_frequency[CommandQueueType_Count];
 };
 
+// Resolved pipeline statistics queries, laid out as D3D12_QUERY_DATA_PIPELINE_STATISTICS.
+struct PipelineStatistics {
+	std::uint64_t ia_vertices;
+	std::uint64_t ia_primitives;
+	std::uint64_t vs_invocations;
+	std::uint64_t gs_invocations;
+	std::uint64_t gs_primitives;
+	std::uint64_t c_invocations;
+	std::uint64_t c_primitives;
+	std::uint64_t ps_invocations;
+	std::uint64_t hs_invocations;
+	std::uint64_t ds_invocations;
+	std::uint64_t cs_invocations;
+};
+
 }
\ No newline at end of file
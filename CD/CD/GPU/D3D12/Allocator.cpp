@@ -186,7 +186,11 @@ HeapMemory* Allocator::create_resource(ID3D12Resource*& resource, const D3D12_RE
 	}
 
 	D3D12_RESOURCE_ALLOCATION_INFO info = adapter.device->GetResourceAllocationInfo(1 << adapter.node_index, 1, &desc);
-	HeapMemory* memory = heap_pools[pool].allocate(info);
+	HeapMemory* memory = nullptr;
+	{
+		std::lock_guard lock(mutex);
+		memory = heap_pools[pool].allocate(info);
+	}
 
 	HR_ASSERT(adapter.device->CreatePlacedResource(memory->parent->heap, memory->offset, &desc, state, nullptr, IID_PPV_ARGS(&resource)));
 
@@ -194,6 +198,7 @@ HeapMemory* Allocator::create_resource(ID3D12Resource*& resource, const D3D12_RE
 }
 
 void Allocator::destroy_resource(HeapMemory* memory) {
+	std::lock_guard lock(mutex);
 	memory->allocator->deallocate(memory);
 }
 
@@ -3,6 +3,7 @@
 #include <CD/GPU/D3D12/Common.hpp>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 namespace CD::GPU::D3D12 {
 
@@ -50,6 +51,7 @@ private:
 	const Adapter& adapter;
 
 	HeapPool heap_pools[HeapPoolType_Count];
+	std::mutex mutex;
 
 	HeapMemory* create_resource(ID3D12Resource*&, const D3D12_RESOURCE_DESC&, D3D12_HEAP_TYPE, D3D12_RESOURCE_STATES);
 	void destroy_resource(HeapMemory*);
@@ -22,6 +22,8 @@ ShaderDescriptorHeap::~ShaderDescriptorHeap() {
 }
 
 DescriptorTable ShaderDescriptorHeap::create_descriptor_table(std::uint32_t num_descriptors) {
+	std::lock_guard lock(mutex);
+
 	for(auto it = release_list.begin(); it != release_list.end(); ++it) {
 		if(it->num_descriptors >= num_descriptors) {
 			DescriptorTable table = *it;
@@ -39,6 +41,7 @@ DescriptorTable ShaderDescriptorHeap::create_descriptor_table(std::uint32_t num_
 }
 
 void ShaderDescriptorHeap::destroy_descriptor_table(DescriptorTable& table) {
+	std::lock_guard lock(mutex);
 	release_list.push_back(table);
 }
 
@@ -69,6 +72,7 @@ DescriptorPool::~DescriptorPool() {
 }
 
 CPUHandle DescriptorPool::add_descriptor() {
+	std::lock_guard lock(mutex);
 	if(release_list.size()) {
 		CPUHandle handle = release_list.back();
 		release_list.pop_back();
@@ -92,17 +96,19 @@ CPUHandle DescriptorPool::add_descriptor() {
 }
 
 void DescriptorPool::remove_descriptor(CPUHandle descriptor) {
+	std::lock_guard lock(mutex);
 	release_list.push_back(descriptor);
 }
 
-constexpr std::size_t default_pool_size = 1 << 16;
+constexpr std::uint32_t default_pool_page_size = 1 << 10;
+constexpr std::uint32_t pipeline_pool_page_size = 1 << 8;
 
 DeviceResources::DeviceResources() :
-	buffer_pool(default_pool_size),
-	texture_pool(default_pool_size),
-	pipeline_state_pool(default_pool_size),
-	descriptor_table_pool(default_pool_size),
-	render_pass_pool(default_pool_size) {
+	buffer_pool(default_pool_page_size),
+	texture_pool(default_pool_page_size),
+	pipeline_state_pool(pipeline_pool_page_size),
+	descriptor_table_pool(default_pool_page_size),
+	render_pass_pool(pipeline_pool_page_size) {
 }
 
 }
\ No newline at end of file
@@ -2,11 +2,13 @@
 
 #include <CD/Common/Common.hpp>
 #include <CD/Common/Debug.hpp>
-#include <CD/Common/ResourcePool.hpp>
+#include <CD/Common/ConcurrentResourcePool.hpp>
 #include <CD/GPU/Common.hpp>
+#include <CD/GPU/ResourceStateTracker.hpp>
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <vector>
+#include <mutex>
 
 namespace CD::GPU::D3D12 {
 
@@ -431,6 +433,18 @@ constexpr D3D12_RESOURCE_STATES d3d12_initial_state(BufferStorage storage) {
 	return D3D12_RESOURCE_STATE_COMMON;
 }
 
+constexpr D3D12_QUERY_HEAP_TYPE d3d12_query_heap_type(QueryType type) {
+	switch(type) {
+	case QueryType_Timestamp:
+		return D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	case QueryType_PipelineStatistics:
+		return D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+	default:
+		CD_FAIL("unhandled value");
+	}
+	return D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+}
+
 constexpr D3D12_HEAP_TYPE d3d12_heap_type(BufferStorage storage) {
 	switch(storage) {
 	case BufferStorage::Upload:
@@ -555,6 +569,8 @@ struct Texture {
 	CPUHandle rtv;
 	CPUHandle dsv_write;
 	CPUHandle dsv_read;
+	std::uint32_t num_subresources;
+	TextureStates states;
 };
 
 struct PipelineState {
@@ -607,6 +623,7 @@ private:
 	std::uint32_t descriptor_count;
 	std::uint32_t increment;
 	std::vector<DescriptorTable> release_list;
+	std::mutex mutex;
 };
 
 class DescriptorPool {
@@ -625,16 +642,17 @@ private:
 	std::uint32_t num_descriptors;
 	std::uint32_t increment;
 	std::vector<CPUHandle> release_list;
+	std::mutex mutex;
 };
 
 struct DeviceResources {
 	DeviceResources();
 
-	ResourcePool<Buffer> buffer_pool;
-	ResourcePool<Texture> texture_pool;
-	ResourcePool<PipelineState> pipeline_state_pool;
-	ResourcePool<DescriptorTable> descriptor_table_pool;
-	ResourcePool<RenderPass> render_pass_pool;
+	ConcurrentResourcePool<Buffer> buffer_pool;
+	ConcurrentResourcePool<Texture> texture_pool;
+	ConcurrentResourcePool<PipelineState> pipeline_state_pool;
+	ConcurrentResourcePool<DescriptorTable> descriptor_table_pool;
+	ConcurrentResourcePool<RenderPass> render_pass_pool;
 };
 
 }
\ No newline at end of file
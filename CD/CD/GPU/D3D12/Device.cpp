@@ -2,11 +2,11 @@
 
 namespace CD::GPU::D3D12 {
 
-Device::Device(Adapter& adapter, ShaderCompiler& compiler, const SwapChainDesc* swapchain_desc, IDXGIFactory7* factory) :
+Device::Device(Adapter& adapter, GPU::ShaderCompiler& compiler, const SwapChainDesc* swapchain_desc, IDXGIFactory7* factory, JobSystem* job_system) :
 	adapter(adapter),
 	allocator(adapter),
 	shader_descriptor_heap(adapter),
-	engine(adapter, resources, shader_descriptor_heap),
+	engine(adapter, resources, shader_descriptor_heap, job_system),
 	rtv_pool(adapter, swapchain_backbuffer_count, D3D12_DESCRIPTOR_HEAP_TYPE_RTV),
 	compiler(compiler) {
 
@@ -104,7 +104,15 @@ TextureHandle Device::create_texture(const TextureDesc& texture_desc) {
 	desc.SampleDesc = {texture_desc.sample_count, 0};
 	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 
+	D3D12_FEATURE_DATA_FORMAT_INFO format_info {desc.Format};
+	HR_ASSERT(adapter.device->CheckFeatureSupport(D3D12_FEATURE_FORMAT_INFO, &format_info, sizeof(format_info)));
+
 	Texture texture = allocator.create_texture(desc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+	texture.num_subresources = desc.MipLevels * format_info.PlaneCount;
+	if(desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE3D) {
+		texture.num_subresources *= desc.DepthOrArraySize;
+	}
+	texture.states.state = D3D12_RESOURCE_STATE_COMMON;
 	return static_cast<TextureHandle>(resources.texture_pool.add(texture));
 }
 
@@ -242,13 +250,14 @@ PipelineHandle Device::create_pipeline_input_list(std::uint32_t num_descriptors)
 void Device::destroy_buffer(BufferHandle handle) {
 	Buffer& buffer = resources.buffer_pool.get(handle);
 	buffer.resource->Release();
-	resources.buffer_pool.remove(static_cast<std::size_t>(handle));
+	resources.buffer_pool.remove(handle);
 }
 
 void Device::destroy_texture(TextureHandle handle) {
 	Texture& texture = resources.texture_pool.get(handle);
+	engine.release_texture_views(texture);
 	texture.resource->Release();
-	resources.texture_pool.remove(static_cast<std::size_t>(handle));
+	resources.texture_pool.remove(handle);
 }
 
 void Device::destroy_pipeline_resource(PipelineHandle resource) {
@@ -387,10 +396,24 @@ Signal Device::submit_commands(const CommandBuffer& commands, CommandQueueType t
 	return engine.submit_command_buffer(commands, type);
 }
 
+Signal Device::submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType type) {
+	CD_ASSERT(num_command_buffers);
+
+	return engine.submit_command_buffers(command_buffers, num_command_buffers, type);
+}
+
 Signal Device::reset() {
 	return engine.present();
 }
 
+const SubmitStatistics& Device::get_submit_statistics() const {
+	return engine.get_statistics();
+}
+
+void Device::reset_submit_statistics() {
+	engine.reset_statistics();
+}
+
 void Device::resize_buffers(std::uint32_t width, std::uint32_t height) {
 	engine.sync();
 
@@ -404,11 +427,15 @@ void Device::resize_buffers(std::uint32_t width, std::uint32_t height) {
 	}
 }
 
+void Device::reserve_queries(QueryType type, std::uint32_t count) {
+	engine.reserve_queries(type, count);
+}
+
 DeviceFeatureInfo Device::report_feature_info() {
 	return adapter.feature_info;
 }
 
-ShaderCompiler& Device::get_shader_compiler() {
+GPU::ShaderCompiler& Device::get_shader_compiler() {
 	return compiler;
 }
 
@@ -453,6 +480,16 @@ ID3D12RootSignature* Device::create_root_signature(const PipelineInputLayout& la
 			parameters[i].Descriptor.RegisterSpace = buffer.binding_space;
 			break;
 		}
+		case PipelineInputGroupType::Constants: {
+			const PipelineInputConstantsDesc& constants = layout.entries[i].constants;
+			CD_ASSERT(constants.num_constants <= max_root_constants);
+
+			parameters[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+			parameters[i].Constants.ShaderRegister = constants.binding_slot;
+			parameters[i].Constants.RegisterSpace = constants.binding_space;
+			parameters[i].Constants.Num32BitValues = constants.num_constants;
+			break;
+		}
 		default:
 			CD_FAIL("unhandled parameter type");
 			break;
@@ -3,7 +3,7 @@
 #include <CD/GPU/D3D12/Common.hpp>
 #include <CD/GPU/D3D12/Allocator.hpp>
 #include <CD/GPU/D3D12/Engine.hpp>
-#include <CD/GPU/Shader.hpp>
+#include <CD/GPU/D3D12/ShaderCompiler.hpp>
 #include <CD/GPU/Device.hpp>
 #include <memory>
 
@@ -11,7 +11,7 @@ namespace CD::GPU::D3D12 {
 
 class Device : public GPU::Device {
 public:
-	Device(Adapter&, ShaderCompiler&, const SwapChainDesc*, IDXGIFactory7*);
+	Device(Adapter&, GPU::ShaderCompiler&, const SwapChainDesc*, IDXGIFactory7*, JobSystem*);
 	~Device();
 
 	BufferHandle create_buffer(const BufferDesc&) final;
@@ -35,11 +35,16 @@ public:
 	void wait(const Signal& producer, CommandQueueType queue) final;
 	void wait_for_fence(const Signal&) final;
 	Signal submit_commands(const CommandBuffer&, CommandQueueType) final;
+	Signal submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType) final;
 	Signal reset() final;
 
+	const SubmitStatistics& get_submit_statistics() const final;
+	void reset_submit_statistics() final;
+
 	void resize_buffers(std::uint32_t width, std::uint32_t height) final;
+	void reserve_queries(QueryType, std::uint32_t count) final;
 	DeviceFeatureInfo report_feature_info() final;
-	ShaderCompiler& get_shader_compiler() final;
+	GPU::ShaderCompiler& get_shader_compiler() final;
 private:
 	Adapter& adapter;
 	Allocator allocator;
@@ -50,7 +55,7 @@ private:
 	DescriptorPool rtv_pool;
 	std::unique_ptr<SwapChain> swapchain;
 
-	ShaderCompiler& compiler;
+	GPU::ShaderCompiler& compiler;
 
 	ID3D12RootSignature* create_root_signature(const PipelineInputLayout&, bool ia = false);
 };
@@ -1,43 +1,183 @@
 #include <CD/GPU/D3D12/Engine.hpp>
+#include <CD/GPU/Utils.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <CD/Common/AllocationTracker.hpp>
+#include <CD/Common/Clock.hpp>
+#include <algorithm>
 
 namespace CD::GPU::D3D12 {
 
-constexpr bool operator==(const PipelineInputBuffer& l, const PipelineInputBuffer& r) {
-	return l.buffer == r.buffer &&
-		l.offset == r.offset &&
-		l.type == r.type;
+CommandSignatureCache::CommandSignatureCache(const Adapter& adapter) :
+	adapter(adapter) {
 }
 
-constexpr bool operator==(const PipelineHandle& l, const PipelineHandle& r) {
-	return l.handle == r.handle &&
-		l.type == r.type;
+CommandSignatureCache::~CommandSignatureCache() {
+	for(const DrawSignature& draw_signature : draw_signatures) {
+		draw_signature.signature->Release();
+	}
+}
+
+ID3D12CommandSignature* CommandSignatureCache::get_draw_signature(ID3D12RootSignature* root_signature, bool indexed, std::uint32_t constants_slot, std::uint32_t num_constants) {
+	CD_ASSERT(num_constants <= max_root_constants);
+
+	if(!num_constants) {
+		root_signature = nullptr;
+		constants_slot = 0;
+	}
+
+	std::lock_guard lock(mutex);
+
+	for(const DrawSignature& draw_signature : draw_signatures) {
+		if(draw_signature.root_signature == root_signature && draw_signature.indexed == indexed && draw_signature.constants_slot == constants_slot && draw_signature.num_constants == num_constants) {
+			return draw_signature.signature;
+		}
+	}
+
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[2] {};
+	std::uint32_t num_arguments = 0;
+	if(num_constants) {
+		arguments[num_arguments].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+		arguments[num_arguments].Constant.RootParameterIndex = constants_slot;
+		arguments[num_arguments].Constant.DestOffsetIn32BitValues = 0;
+		arguments[num_arguments].Constant.Num32BitValuesToSet = num_constants;
+		++num_arguments;
+	}
+	arguments[num_arguments].Type = indexed ? D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED : D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+	++num_arguments;
+
+	D3D12_COMMAND_SIGNATURE_DESC desc {};
+	desc.ByteStride = indexed ? draw_indexed_indirect_stride(num_constants) : draw_indirect_stride(num_constants);
+	desc.NumArgumentDescs = num_arguments;
+	desc.pArgumentDescs = arguments;
+	desc.NodeMask = 1 << adapter.node_index;
+
+	ID3D12CommandSignature* signature = nullptr;
+	HR_ASSERT(adapter.device->CreateCommandSignature(&desc, root_signature, IID_PPV_ARGS(&signature)));
+	draw_signatures.push_back({root_signature, indexed, constants_slot, num_constants, signature});
+
+	return signature;
+}
+
+CommandAllocatorRing::CommandAllocatorRing(const Adapter& adapter, ID3D12CommandQueue* queue, Fence& fence, D3D12_COMMAND_LIST_TYPE type) :
+	adapter(adapter),
+	queue(queue),
+	fence(fence),
+	type(type),
+	completed_value(),
+	in_use(),
+	frame_peak(),
+	idle_target(),
+	idle_target_age(),
+	statistics() {
+}
+
+CommandAllocatorRing::~CommandAllocatorRing() {
+	CD_ASSERT(!in_use);
+	for(const ReleasedAllocator& released : ring) {
+		released.allocator->Release();
+	}
+}
+
+ID3D12CommandAllocator* CommandAllocatorRing::acquire() {
+	ID3D12CommandAllocator* allocator = nullptr;
+
+	if(!ring.empty() && (is_complete(ring.front().fence_value) || (statistics.allocators >= max_command_allocators && ring.front().fence_value <= fence.executed))) {
+		const ReleasedAllocator& released = ring.front();
+		if(!is_complete(released.fence_value)) {
+			if(fence.last_signal < released.fence_value) {
+				HR_ASSERT(queue->Signal(fence.fence, fence.executed));
+				fence.last_signal = fence.executed;
+			}
+			HR_ASSERT(fence.fence->SetEventOnCompletion(released.fence_value, nullptr));
+			completed_value = released.fence_value;
+			++statistics.waits;
+		}
+
+		allocator = released.allocator;
+		ring.pop_front();
+		HR_ASSERT(allocator->Reset());
+		++statistics.reuses;
+	}
+	else {
+		HR_ASSERT(adapter.device->CreateCommandAllocator(type, IID_PPV_ARGS(&allocator)));
+		++statistics.allocators;
+	}
+
+	++statistics.acquires;
+	++in_use;
+	frame_peak = std::max(frame_peak, in_use);
+
+	return allocator;
+}
+
+void CommandAllocatorRing::release(ID3D12CommandAllocator* allocator, std::uint64_t fence_value) {
+	CD_ASSERT(in_use);
+	ring.push_back({allocator, fence_value});
+	--in_use;
+}
+
+void CommandAllocatorRing::trim() {
+	if(frame_peak >= idle_target || ++idle_target_age > command_allocator_trim_frames) {
+		idle_target = frame_peak;
+		idle_target_age = 0;
+	}
+	frame_peak = in_use;
+
+	std::size_t idle = 0;
+	while(idle < ring.size() && is_complete(ring[idle].fence_value)) {
+		++idle;
+	}
+
+	for(; idle > idle_target; --idle) {
+		ring.front().allocator->Release();
+		ring.pop_front();
+		--statistics.allocators;
+		++statistics.trimmed;
+	}
+}
+
+void CommandAllocatorRing::reset_statistics() {
+	statistics = {statistics.allocators};
+}
+
+bool CommandAllocatorRing::is_complete(std::uint64_t fence_value) {
+	if(fence_value > completed_value) {
+		completed_value = std::max(fence.tail, fence.fence->GetCompletedValue());
+	}
+	return fence_value <= completed_value;
+}
+
+TextureViewPools::TextureViewPools(const Adapter& adapter) :
+	rtv_pool(adapter, cpu_descriptor_count, D3D12_DESCRIPTOR_HEAP_TYPE_RTV),
+	dsv_pool(adapter, cpu_descriptor_count, D3D12_DESCRIPTOR_HEAP_TYPE_DSV) {
 }
 
-CommandList::CommandList(const Adapter& adapter, const Fence& fence, DeviceResources& resources, D3D12_COMMAND_LIST_TYPE type, const ShaderDescriptorHeap* descriptor_heap) :
+CommandList::CommandList(const Adapter& adapter, const Fence& fence, CommandAllocatorRing& allocator_ring, DeviceResources& resources, TextureViewPools& view_pools, D3D12_COMMAND_LIST_TYPE type, const ShaderDescriptorHeap* descriptor_heap) :
 	adapter(adapter),
 	fence(fence),
 	type(type),
 	state(CommandListState::Recording),
+	reusable(true),
+	statistics(),
 	resources(resources),
+	view_pools(view_pools),
 	descriptor_heap(descriptor_heap),
-	rtv_pool(adapter, cpu_descriptor_count, D3D12_DESCRIPTOR_HEAP_TYPE_RTV),
-	dsv_pool(adapter, cpu_descriptor_count, D3D12_DESCRIPTOR_HEAP_TYPE_DSV),
 	command_list(nullptr),
-	current_allocator(nullptr),
+	allocator_ring(allocator_ring),
+	current_allocator(allocator_ring.acquire()),
+	allocator_fence(fence.tail),
 	barrier_buffer(),
 	graphics_pso(),
 	compute_pso(),
 	graphics_arguments(),
 	compute_arguments(),
-	current_render_pass(nullptr) {
-
-	ID3D12CommandAllocator* allocator = nullptr;
-	HR_ASSERT(adapter.device->CreateCommandAllocator(type, IID_PPV_ARGS(&allocator)));
-	CommandAllocator command_allocator {allocator, fence.tail};
-	current_allocator = &allocators.emplace_back(command_allocator);
+	current_render_pass(nullptr),
+	state_tracker(d3d12_read_only_states(type)),
+	transitions(),
+	next_split(0) {
 
 	ID3D12GraphicsCommandList* cl = nullptr;
-	adapter.device->CreateCommandList(1 << adapter.node_index, type, allocator, nullptr, IID_PPV_ARGS(&cl));
+	adapter.device->CreateCommandList(1 << adapter.node_index, type, current_allocator, nullptr, IID_PPV_ARGS(&cl));
 	HR_ASSERT(cl->QueryInterface<ID3D12GraphicsCommandList5>(&command_list));
 	cl->Release();
 
@@ -47,8 +187,8 @@ CommandList::CommandList(const Adapter& adapter, const Fence& fence, DeviceResou
 }
 
 CommandList::~CommandList() {
-	for(const auto& [allocator, _] : allocators) {
-		allocator->Release();
+	if(current_allocator) {
+		allocator_ring.release(current_allocator, allocator_fence);
 	}
 	command_list->Release();
 }
@@ -59,6 +199,14 @@ CommandListState CommandList::get_state() {
 
 void CommandList::lock() {
 	CD_ASSERT(state == CommandListState::Reset);
+
+	current_allocator = allocator_ring.acquire();
+	HR_ASSERT(command_list->Reset(current_allocator, nullptr));
+
+	if(descriptor_heap) {
+		set_descriptor_heap(*descriptor_heap);
+	}
+
 	state = CommandListState::Recording;
 }
 
@@ -68,53 +216,42 @@ void CommandList::close() {
 	issue_barriers();
 
 	HR_ASSERT(command_list->Close());
-	current_allocator->second = fence.head;
+	allocator_fence = fence.head;
 
 	state = CommandListState::Pending;
 }
 
+// The allocator goes back to the ring, a new one is acquired when the list is locked for recording again.
 void CommandList::reset() {
 	CD_ASSERT(state == CommandListState::Pending);
 
-	ID3D12CommandAllocator* found_allocator = nullptr;
-
-	for(CommandAllocator& allocator : allocators) {
-		const auto& [allocator_ptr, allocator_fence] = allocator;
-
-		if(allocator_fence <= fence.tail) {
-			HR_ASSERT(allocator_ptr->Reset());
-			found_allocator = allocator_ptr;
-
-			current_allocator = &allocator;
-			break;
-		}
-	}
-
-	if(!found_allocator) {
-		HR_ASSERT(adapter.device->CreateCommandAllocator(type, IID_PPV_ARGS(&found_allocator)));
-		current_allocator = &allocators.emplace_back();
-		current_allocator->first = found_allocator;
-		current_allocator->second = ~0ui64;
-	}
-
-	HR_ASSERT(command_list->Reset(found_allocator, nullptr));
-
-
-	if(descriptor_heap) {
-		set_descriptor_heap(*descriptor_heap);
-	}
+	allocator_ring.release(current_allocator, allocator_fence);
+	current_allocator = nullptr;
 
 	graphics_pso = {nullptr, nullptr};
-	graphics_arguments.cleared = true;
+	graphics_arguments.valid_slots = 0;
+	graphics_arguments.dirty_slots = 0;
 
 	compute_pso = {nullptr, nullptr};
-	compute_arguments.cleared = true;
+	compute_arguments.valid_slots = 0;
 
 	CD_ASSERT(!current_render_pass);
 
+	state_tracker.reset();
+
+	reusable = true;
 	state = CommandListState::Reset;
 }
 
+void CommandList::resubmit() {
+	CD_ASSERT(state == CommandListState::Pending);
+	allocator_fence = fence.head;
+}
+
+bool CommandList::is_reusable() const {
+	return reusable;
+}
+
 ID3D12CommandList* CommandList::d3d12_command_list() {
 	return command_list;
 }
@@ -129,37 +266,38 @@ void CommandList::set_descriptor_heap(const ShaderDescriptorHeap& shader_heap) {
 void CommandList::transition_barrier(const void* command_data) {
 	const LayoutBarrierDesc& desc = *static_cast<const LayoutBarrierDesc*>(command_data);
 	const TextureView& view = desc.texture;
-	const Texture& texture = resources.texture_pool.get(view.texture);
 
 	std::uint32_t subresource = desc.all_subresources ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : texture_subresource(view.mip_level, view.index, view.plane, view.mip_count, view.depth);
 
-	add_transition(texture.resource, subresource, d3d12_resource_state(desc.before), d3d12_resource_state(desc.after));
+	track_texture(view.texture, subresource, d3d12_resource_state(desc.before), false);
+	track_texture(view.texture, subresource, d3d12_resource_state(desc.after), false);
 }
 
 void CommandList::uav_barrier(const void* command_data) {
 	const ResourceBarrierDesc& desc = *static_cast<const ResourceBarrierDesc*>(command_data);
 
-	D3D12_RESOURCE_BARRIER barriers[max_resource_barriers];
+	D3D12_RESOURCE_BARRIER barrier {D3D12_RESOURCE_BARRIER_TYPE_UAV, D3D12_RESOURCE_BARRIER_FLAG_NONE};
 
 	for(std::size_t i = 0; i < desc.num_buffer_barriers; ++i) {
-		const Buffer& buffer = resources.buffer_pool.get(desc.buffers[i]);
-		barriers[i].Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-		barriers[i].UAV.pResource = buffer.resource;
+		barrier.UAV.pResource = resources.buffer_pool.get(desc.buffers[i]).resource;
+		add_barrier(barrier);
 	}
-	command_list->ResourceBarrier(desc.num_buffer_barriers, barriers);
 
 	for(std::size_t i = 0; i < desc.num_texture_barriers; ++i) {
-		const Texture& texture = resources.texture_pool.get(desc.textures[i]);
-		barriers[i].Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-		barriers[i].UAV.pResource = texture.resource;
+		barrier.UAV.pResource = resources.texture_pool.get(desc.textures[i]).resource;
+		add_barrier(barrier);
 	}
-	command_list->ResourceBarrier(desc.num_texture_barriers, barriers);
 }
 
 void CommandList::begin_render_pass(const void* command_data) {
 	const BeginRenderPassDesc& begin_render_pass = *static_cast<const BeginRenderPassDesc*>(command_data);
 
-	RenderPass& render_pass = resources.render_pass_pool.get(begin_render_pass.render_pass.handle);
+	const RenderPass& render_pass = resources.render_pass_pool.get(begin_render_pass.render_pass.handle);
+
+	D3D12_RENDER_PASS_RENDER_TARGET_DESC render_targets[max_render_targets];
+	D3D12_RENDER_PASS_DEPTH_STENCIL_DESC depth_stencil_desc = render_pass.depth_stencil_target;
+
+	std::lock_guard lock(view_pools.mutex);
 
 	for(std::size_t i = 0; i < render_pass.num_render_targets; ++i) {
 		CD_ASSERT(begin_render_pass.color[i].dimension == TextureViewDimension::Texture2D);
@@ -173,16 +311,17 @@ void CommandList::begin_render_pass(const void* command_data) {
 			view_desc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
 			view_desc.Texture2D.MipSlice = begin_render_pass.color[i].mip_level;
 			
-			CPUHandle handle = rtv_pool.add_descriptor();
+			CPUHandle handle = view_pools.rtv_pool.add_descriptor();
 			adapter.device->CreateRenderTargetView(render_target.resource, &view_desc, handle);
 			render_target.rtv = handle;
 		}
 
 
-		render_pass.render_targets[i].cpuDescriptor = render_target.rtv;
+		render_targets[i] = render_pass.render_targets[i];
+		render_targets[i].cpuDescriptor = render_target.rtv;
 	}
 
-	D3D12_RENDER_PASS_DEPTH_STENCIL_DESC* depth_stencil = render_pass.depth_stencil_enable ? &render_pass.depth_stencil_target : nullptr;
+	D3D12_RENDER_PASS_DEPTH_STENCIL_DESC* depth_stencil = render_pass.depth_stencil_enable ? &depth_stencil_desc : nullptr;
 	if(depth_stencil) {
 		CD_ASSERT(begin_render_pass.depth_stencil_target.dimension == TextureViewDimension::Texture2D);
 
@@ -200,7 +339,7 @@ void CommandList::begin_render_pass(const void* command_data) {
 		CPUHandle* dsv_handle = begin_render_pass.depth_write ? &depth_stencil_target.dsv_write : &depth_stencil_target.dsv_read;
 
 		if(invalid_cpu_handle(*dsv_handle)) {
-			*dsv_handle = dsv_pool.add_descriptor();
+			*dsv_handle = view_pools.dsv_pool.add_descriptor();
 
 			D3D12_DEPTH_STENCIL_VIEW_DESC dsv_desc {
 				dxgi_format(begin_render_pass.depth_stencil_target.format),
@@ -215,7 +354,7 @@ void CommandList::begin_render_pass(const void* command_data) {
 	}
 
 	issue_barriers();
-	command_list->BeginRenderPass(render_pass.num_render_targets, render_pass.render_targets, depth_stencil, D3D12_RENDER_PASS_FLAG_NONE);
+	command_list->BeginRenderPass(render_pass.num_render_targets, render_targets, depth_stencil, D3D12_RENDER_PASS_FLAG_NONE);
 
 	current_render_pass = &render_pass;
 
@@ -334,21 +473,114 @@ void CommandList::dispatch_indirect(const void* command_data, ID3D12CommandSigna
 void CommandList::draw(const void* command_data) {
 	const DrawDesc& desc = *static_cast<const DrawDesc*>(command_data);
 
+	issue_barriers();
+	flush_graphics_inputs();
+	command_list->DrawInstanced(desc.num_vertices, desc.num_instances, desc.first_vertex, 0);
+}
+
+void CommandList::draw_indexed(const void* command_data) {
+	const DrawIndexedDesc& desc = *static_cast<const DrawIndexedDesc*>(command_data);
+
+	issue_barriers();
+	flush_graphics_inputs();
+	command_list->DrawIndexedInstanced(desc.num_indices, desc.num_instances, desc.first_index, desc.base_vertex, 0);
+}
+
+void CommandList::draw_indirect(const void* command_data, CommandSignatureCache& signatures) {
+	const DrawIndirectDesc& desc = *static_cast<const DrawIndirectDesc*>(command_data);
+
+	ID3D12CommandSignature* signature = signatures.get_draw_signature(graphics_pso.root_signature, false, desc.constants_slot, desc.num_constants);
+	execute_draws(signature, desc.args, desc.offset, desc.max_draws, desc.count, desc.count_offset, desc.constants_slot, desc.num_constants);
+}
+
+void CommandList::draw_indexed_indirect(const void* command_data, CommandSignatureCache& signatures) {
+	const DrawIndexedIndirectDesc& desc = *static_cast<const DrawIndexedIndirectDesc*>(command_data);
+
+	ID3D12CommandSignature* signature = signatures.get_draw_signature(graphics_pso.root_signature, true, desc.constants_slot, desc.num_constants);
+	execute_draws(signature, desc.args, desc.offset, desc.max_draws, desc.count, desc.count_offset, desc.constants_slot, desc.num_constants);
+}
+
+void CommandList::set_graphics_pipeline(const void* command_data) {
+	const SetGraphicsPipelineDesc& desc = *static_cast<const SetGraphicsPipelineDesc*>(command_data);
+
 	const PipelineState& state = resources.pipeline_state_pool.get(desc.graphics_pipeline.handle);
-	set_graphics_state(state, desc.pipeline_input_state);
+
+	if(ID3D12RootSignature* rs = state.root_signature; rs != graphics_pso.root_signature) {
+		command_list->SetGraphicsRootSignature(rs);
+		graphics_pso.root_signature = rs;
+		graphics_arguments.valid_slots = 0;
+		graphics_arguments.dirty_slots = 0;
+		++statistics.root_signature_switches;
+	}
+
+	if(ID3D12PipelineState* pso = state.pso; pso != graphics_pso.pso) {
+		command_list->SetPipelineState(pso);
+		graphics_pso.pso = pso;
+		++statistics.pipeline_switches;
+	}
+}
+
+void CommandList::set_input_group(const void* command_data) {
+	const SetInputGroupDesc& desc = *static_cast<const SetInputGroupDesc*>(command_data);
+
+	CD_ASSERT(desc.slot < max_pipeline_layout_entries);
+	CD_ASSERT(graphics_pso.root_signature);
+
+	PipelineInputState& arguments = graphics_arguments.arguments;
+	std::uint32_t slot_bit = 1 << desc.slot;
+
+	if(graphics_arguments.valid_slots & slot_bit && arguments.types[desc.slot] == desc.type && same_input_element(desc.type, desc.input, arguments.input_elements[desc.slot])) {
+		++statistics.root_argument_hits;
+		return;
+	}
+
+	arguments.types[desc.slot] = desc.type;
+	arguments.input_elements[desc.slot] = desc.input;
+	graphics_arguments.valid_slots |= slot_bit;
+	graphics_arguments.dirty_slots |= slot_bit;
+}
+
+void CommandList::set_vertex_streams(const void* command_data) {
+	const SetVertexStreamsDesc& desc = *static_cast<const SetVertexStreamsDesc*>(command_data);
+
+	CD_ASSERT(desc.num_streams <= max_vertex_buffers);
 
 	D3D12_VERTEX_BUFFER_VIEW vbv[max_vertex_buffers] {};
 	if(desc.input_buffer != BufferHandle::Null) {
 		const Buffer& input_buffer = resources.buffer_pool.get(desc.input_buffer);
 		GPUVA vertex_va = input_buffer.va;
 
-		for(std::size_t i = 0; i < desc.num_vertex_buffers; ++i) {
-			vbv[i].BufferLocation = vertex_va + desc.vertex_buffer_offsets[i];
-			vbv[i].SizeInBytes = desc.vertex_buffer_sizes[i];
-			vbv[i].StrideInBytes = desc.vertex_buffer_strides[i];
+		for(std::size_t i = 0; i < desc.num_streams; ++i) {
+			vbv[i].BufferLocation = vertex_va + desc.streams[i].offset;
+			vbv[i].SizeInBytes = desc.streams[i].size;
+			vbv[i].StrideInBytes = desc.streams[i].stride;
 		}
 	}
 
+	command_list->IASetVertexBuffers(0, desc.num_streams, vbv);
+}
+
+void CommandList::set_index_buffer(const void* command_data) {
+	const SetIndexBufferDesc& desc = *static_cast<const SetIndexBufferDesc*>(command_data);
+
+	if(desc.index_buffer == BufferHandle::Null) {
+		command_list->IASetIndexBuffer(nullptr);
+		return;
+	}
+
+	const Buffer& index_buffer = resources.buffer_pool.get(desc.index_buffer);
+
+	D3D12_INDEX_BUFFER_VIEW ibv {
+		index_buffer.va + desc.offset,
+		desc.size,
+		DXGI_FORMAT_R32_UINT
+	};
+	command_list->IASetIndexBuffer(&ibv);
+}
+
+void CommandList::set_scissor(const void* command_data) {
+	const SetScissorDesc& desc = *static_cast<const SetScissorDesc*>(command_data);
+
 	D3D12_RECT scissor {
 		static_cast<LONG>(desc.rect.left),
 		static_cast<LONG>(desc.rect.top),
@@ -357,30 +589,13 @@ void CommandList::draw(const void* command_data) {
 	};
 
 	command_list->RSSetScissorRects(1, &scissor);
-
-	command_list->IASetVertexBuffers(0, desc.num_vertex_buffers, vbv);
-
-	if(desc.index_buffer != BufferHandle::Null) {
-		const Buffer& index_buffer = resources.buffer_pool.get(desc.index_buffer);
-		GPUVA index_va = index_buffer.va + desc.index_buffer_offset;
-
-		D3D12_INDEX_BUFFER_VIEW ibv {
-			index_va,
-			desc.index_buffer_size,
-			DXGI_FORMAT_R32_UINT
-		};
-		command_list->IASetIndexBuffer(&ibv);
-		command_list->DrawIndexedInstanced(desc.num_elements, desc.num_instances, 0, 0, 0);
-	}
-	else {
-		command_list->DrawInstanced(desc.num_elements, desc.num_instances, 0, 0);
-	}
 }
 
 void CommandList::copy_to_swapchain(const void* command_data, const SwapChain& swapchain) {
 	const CopyToSwapChainDesc& copy = *static_cast<const CopyToSwapChainDesc*>(command_data);
 
 	ID3D12Resource* swapchain_surface = swapchain.resources[swapchain.dxgi_swapchain->GetCurrentBackBufferIndex()];
+	reusable = false;
 
 	D3D12_TEXTURE_COPY_LOCATION dst {swapchain_surface, D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX};
 
@@ -388,37 +603,148 @@ void CommandList::copy_to_swapchain(const void* command_data, const SwapChain& s
 	D3D12_TEXTURE_COPY_LOCATION src {texture_src.resource, D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX};
 	src.SubresourceIndex = texture_subresource(copy.texture.mip_level, copy.texture.index, copy.texture.plane, copy.texture.mip_count, copy.texture.depth);
 
-	add_transition(texture_src.resource, src.SubresourceIndex, d3d12_resource_state(copy.texture_state), D3D12_RESOURCE_STATE_COPY_SOURCE);
+	track_texture(copy.texture.texture, src.SubresourceIndex, D3D12_RESOURCE_STATE_COPY_SOURCE, true);
 	add_transition(swapchain_surface, 0, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
 	issue_barriers();
 
 	command_list->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
 
 	add_transition(swapchain_surface, 0, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
-	add_transition(texture_src.resource, src.SubresourceIndex, D3D12_RESOURCE_STATE_COPY_SOURCE, d3d12_resource_state(copy.texture_state));
 	issue_barriers();
 }
 
-void CommandList::insert_timestamp(const void* command_data, ID3D12QueryHeap* query_heap) {
+void CommandList::insert_timestamp(const void* command_data, const QueryHeap& query_heap) {
 	const InsertTimestampDesc& timestamp = *static_cast<const InsertTimestampDesc*>(command_data);
 
-	CD_ASSERT(timestamp.index < max_timestamp_queries);
-	command_list->EndQuery(query_heap, D3D12_QUERY_TYPE_TIMESTAMP, timestamp.index);
+	CD_ASSERT(timestamp.index < query_heap.count);
+	command_list->EndQuery(query_heap.heap, D3D12_QUERY_TYPE_TIMESTAMP, timestamp.index);
 }
 
-void CommandList::resolve_timestamps(const void* command_data, ID3D12QueryHeap* query_heap) {
+void CommandList::resolve_timestamps(const void* command_data, const QueryHeap& query_heap) {
 	const ResolveTimestampsDesc& resolve = *static_cast<const ResolveTimestampsDesc*>(command_data);
 
-	CD_ASSERT(resolve.index + resolve.timestamp_count < max_timestamp_queries);
+	CD_ASSERT(resolve.index + resolve.timestamp_count <= query_heap.count);
 	CD_ASSERT(resolve.dest != BufferHandle::Null);
 	const Buffer& buffer = resources.buffer_pool.get(resolve.dest);
 
-	command_list->ResolveQueryData(query_heap, D3D12_QUERY_TYPE_TIMESTAMP, resolve.index, resolve.timestamp_count, buffer.resource, resolve.aligned_offset);
+	issue_barriers();
+	command_list->ResolveQueryData(query_heap.heap, D3D12_QUERY_TYPE_TIMESTAMP, resolve.index, resolve.timestamp_count, buffer.resource, resolve.aligned_offset);
+}
+
+void CommandList::begin_scope(const void* command_data, const QueryHeap& query_heap) {
+	const BeginScopeDesc& scope = *static_cast<const BeginScopeDesc*>(command_data);
+
+	// Batched barriers are issued at scope boundaries so they are attributed to the scope that recorded them.
+	issue_barriers();
+
+	// Metadata 1 marks the event data as an ANSI string, as with PIX_EVENT_ANSI_VERSION.
+	const UINT label_size = static_cast<UINT>(strnlen(scope.label, max_scope_label_length - 1) + 1);
+	command_list->BeginEvent(1, scope.label, label_size);
+
+	if(scope.timestamp_index != no_scope_timestamp) {
+		CD_ASSERT(scope.timestamp_index < query_heap.count);
+		command_list->EndQuery(query_heap.heap, D3D12_QUERY_TYPE_TIMESTAMP, scope.timestamp_index);
+	}
+}
+
+void CommandList::end_scope(const void* command_data, const QueryHeap& query_heap) {
+	const EndScopeDesc& scope = *static_cast<const EndScopeDesc*>(command_data);
+
+	issue_barriers();
+
+	if(scope.timestamp_index != no_scope_timestamp) {
+		CD_ASSERT(scope.timestamp_index < query_heap.count);
+		command_list->EndQuery(query_heap.heap, D3D12_QUERY_TYPE_TIMESTAMP, scope.timestamp_index);
+	}
+
+	command_list->EndEvent();
+}
+
+void CommandList::begin_pipeline_statistics(const void* command_data, const QueryHeap& query_heap) {
+	const BeginPipelineStatisticsDesc& query = *static_cast<const BeginPipelineStatisticsDesc*>(command_data);
+
+	CD_ASSERT(query.index < query_heap.count);
+	issue_barriers();
+	command_list->BeginQuery(query_heap.heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query.index);
+}
+
+void CommandList::end_pipeline_statistics(const void* command_data, const QueryHeap& query_heap) {
+	const EndPipelineStatisticsDesc& query = *static_cast<const EndPipelineStatisticsDesc*>(command_data);
+
+	CD_ASSERT(query.index < query_heap.count);
+	issue_barriers();
+	command_list->EndQuery(query_heap.heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, query.index);
+}
+
+void CommandList::resolve_pipeline_statistics(const void* command_data, const QueryHeap& query_heap) {
+	const ResolvePipelineStatisticsDesc& resolve = *static_cast<const ResolvePipelineStatisticsDesc*>(command_data);
+
+	CD_ASSERT(resolve.index + resolve.query_count <= query_heap.count);
+	CD_ASSERT(resolve.dest != BufferHandle::Null);
+	const Buffer& buffer = resources.buffer_pool.get(resolve.dest);
+
+	issue_barriers();
+	command_list->ResolveQueryData(query_heap.heap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, resolve.index, resolve.query_count, buffer.resource, resolve.aligned_offset);
+}
+
+void CommandList::use_texture(const void* command_data) {
+	const UseTextureDesc& desc = *static_cast<const UseTextureDesc*>(command_data);
+	const TextureView& view = desc.texture;
+
+	std::uint32_t subresource = desc.all_subresources ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : texture_subresource(view.mip_level, view.index, view.plane, view.mip_count, view.depth);
+
+	track_texture(view.texture, subresource, d3d12_resource_state(desc.state, type), true);
+}
+
+void CommandList::plan_state_transitions(const CommandBuffer& cb) {
+	state_tracker.plan(cb);
+	next_split = 0;
+}
+
+void CommandList::begin_split_transitions(std::uint32_t command_index) {
+	const std::vector<SplitTransition>& splits = state_tracker.get_split_transitions();
+	while(next_split < splits.size() && splits[next_split].begin_command == command_index) {
+		const SplitTransition& split = splits[next_split];
+		++next_split;
+
+		transitions.clear();
+		state_tracker.begin_split(split, d3d12_resource_state(split.state, type), transitions);
+		add_transitions(transitions);
+	}
+}
+
+void CommandList::add_transitions(const std::vector<StateTransition>& texture_transitions) {
+	for(const StateTransition& transition : texture_transitions) {
+		const Texture& texture = resources.texture_pool.get(transition.texture);
+
+		D3D12_RESOURCE_BARRIER barrier = get_resource_transition(texture.resource, transition.subresource, static_cast<D3D12_RESOURCE_STATES>(transition.before), static_cast<D3D12_RESOURCE_STATES>(transition.after));
+		if(transition.split == TransitionSplit::Begin) {
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+			++statistics.split_barriers;
+		}
+		else if(transition.split == TransitionSplit::End) {
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+		}
+
+		add_barrier(barrier);
+	}
+}
+
+// Textures destroyed since a retained list was recorded are skipped, the list is not submitted again with them.
+void CommandList::resolve_texture_states(std::vector<StateTransition>& fixups) {
+	for(std::size_t i = 0; i < state_tracker.get_texture_count(); ++i) {
+		TextureHandle handle = state_tracker.get_texture(i);
+		if(resources.texture_pool.is_valid(handle)) {
+			state_tracker.resolve(handle, resources.texture_pool.get(handle).states, fixups);
+		}
+	}
 }
 
 void CommandList::issue_barriers() {
 	if(barrier_buffer.barrier_count) {
 		command_list->ResourceBarrier(barrier_buffer.barrier_count, barrier_buffer.barriers);
+		statistics.barriers += barrier_buffer.barrier_count;
+		++statistics.barrier_calls;
 		barrier_buffer.barrier_count = 0;
 	}
 }
@@ -427,25 +753,26 @@ void CommandList::set_compute_state(const PipelineState& state, const PipelineIn
 	if(ID3D12RootSignature* rs = state.root_signature; rs != compute_pso.root_signature) {
 		command_list->SetComputeRootSignature(state.root_signature);
 		compute_pso.root_signature = rs;
-		compute_arguments.cleared = true;
+		compute_arguments.valid_slots = 0;
+		++statistics.root_signature_switches;
 	}
 
+	PipelineInputState& arguments = compute_arguments.arguments;
+
 	for(std::uint32_t i = 0; i < rs_state.num_elements; ++i) {
+		std::uint32_t slot_bit = 1 << i;
+		if(compute_arguments.valid_slots & slot_bit && arguments.types[i] == rs_state.types[i] && same_input_element(rs_state.types[i], rs_state.input_elements[i], arguments.input_elements[i])) {
+			++statistics.root_argument_hits;
+			continue;
+		}
+
 		switch(rs_state.types[i]) {
 		case PipelineInputGroupType::ResourceList: {
-			if(!compute_arguments.cleared && rs_state.input_elements[i].resource_list == compute_arguments.arguments.input_elements[i].resource_list) {
-				continue;
-			}
-
 			DescriptorTable& table = resources.descriptor_table_pool.get(rs_state.input_elements[i].resource_list.handle);
 			command_list->SetComputeRootDescriptorTable(i, table.gpu_start);
 			break;
 		}
 		case PipelineInputGroupType::Buffer: {
-			if(!compute_arguments.cleared && rs_state.input_elements[i].buffer == compute_arguments.arguments.input_elements[i].buffer) {
-				continue;
-			}
-
 			Buffer& buffer = resources.buffer_pool.get(rs_state.input_elements[i].buffer.buffer);
 			switch(rs_state.input_elements[i].buffer.type) {
 			case DescriptorType::CBV:
@@ -460,88 +787,126 @@ void CommandList::set_compute_state(const PipelineState& state, const PipelineIn
 			}
 			break;
 		}
+		case PipelineInputGroupType::Constants: {
+			const PipelineInputConstants& constants = rs_state.input_elements[i].constants;
+			command_list->SetComputeRoot32BitConstants(i, constants.num_values, constants.values, 0);
+			break;
+		}
 		default:
 			CD_FAIL("unhandled type");
 		}
-	}
 
-	compute_arguments.cleared = false;
+		arguments.types[i] = rs_state.types[i];
+		arguments.input_elements[i] = rs_state.input_elements[i];
+		compute_arguments.valid_slots |= slot_bit;
+		++statistics.root_argument_binds;
+	}
 
 	if(ID3D12PipelineState* pso = state.pso; pso != compute_pso.pso) {
 		command_list->SetPipelineState(pso);
 		compute_pso.pso = pso;
+		++statistics.pipeline_switches;
 	}
 }
 
-void CommandList::set_graphics_state(const PipelineState& state, const PipelineInputState& rs_state) {
-	if(ID3D12RootSignature* rs = state.root_signature; rs != graphics_pso.root_signature) {
-		command_list->SetGraphicsRootSignature(state.root_signature);
-		graphics_pso.root_signature = rs;
-		graphics_arguments.cleared = true;
-	}
+void CommandList::flush_graphics_inputs() {
+	CD_ASSERT(graphics_pso.pso);
 
-	for(std::uint32_t i = 0; i < rs_state.num_elements; ++i) {
-		switch(rs_state.types[i]) {
-		case PipelineInputGroupType::ResourceList: {
-			if(!graphics_arguments.cleared && rs_state.input_elements[i].resource_list == graphics_arguments.arguments.input_elements[i].resource_list) {
-				continue;
-			}
+	const PipelineInputState& arguments = graphics_arguments.arguments;
 
-			DescriptorTable& table = resources.descriptor_table_pool.get(rs_state.input_elements[i].resource_list.handle);
+	for(std::uint32_t i = 0; graphics_arguments.dirty_slots; ++i) {
+		std::uint32_t slot_bit = 1 << i;
+		if(!(graphics_arguments.dirty_slots & slot_bit)) {
+			continue;
+		}
+		graphics_arguments.dirty_slots &= ~slot_bit;
+		++statistics.root_argument_binds;
+
+		switch(arguments.types[i]) {
+		case PipelineInputGroupType::ResourceList: {
+			DescriptorTable& table = resources.descriptor_table_pool.get(arguments.input_elements[i].resource_list.handle);
 			command_list->SetGraphicsRootDescriptorTable(i, table.gpu_start);
 			break;
 		}
 		case PipelineInputGroupType::Buffer: {
-			if(!graphics_arguments.cleared && rs_state.input_elements[i].buffer == graphics_arguments.arguments.input_elements[i].buffer) {
-				continue;
-			}
-
-			Buffer& buffer = resources.buffer_pool.get(rs_state.input_elements[i].buffer.buffer);
-			switch(rs_state.input_elements[i].buffer.type) {
+			Buffer& buffer = resources.buffer_pool.get(arguments.input_elements[i].buffer.buffer);
+			switch(arguments.input_elements[i].buffer.type) {
 			case DescriptorType::CBV:
-				command_list->SetGraphicsRootConstantBufferView(i, buffer.va + rs_state.input_elements[i].buffer.offset);
+				command_list->SetGraphicsRootConstantBufferView(i, buffer.va + arguments.input_elements[i].buffer.offset);
 				break;
 			case DescriptorType::SRV:
-				command_list->SetGraphicsRootShaderResourceView(i, buffer.va + rs_state.input_elements[i].buffer.offset);
+				command_list->SetGraphicsRootShaderResourceView(i, buffer.va + arguments.input_elements[i].buffer.offset);
 				break;
 			case DescriptorType::UAV:
-				command_list->SetGraphicsRootUnorderedAccessView(i, buffer.va + rs_state.input_elements[i].buffer.offset);
+				command_list->SetGraphicsRootUnorderedAccessView(i, buffer.va + arguments.input_elements[i].buffer.offset);
 				break;
 			}
 			break;
 		}
+		case PipelineInputGroupType::Constants: {
+			const PipelineInputConstants& constants = arguments.input_elements[i].constants;
+			command_list->SetGraphicsRoot32BitConstants(i, constants.num_values, constants.values, 0);
+			break;
+		}
 		default:
 			CD_FAIL("unhandled type");
 		}
 	}
+}
 
-	graphics_arguments.cleared = false;
+void CommandList::execute_draws(ID3D12CommandSignature* signature, BufferHandle args, std::uint32_t offset, std::uint32_t max_draws, BufferHandle count, std::uint32_t count_offset, std::uint32_t constants_slot, std::uint32_t num_constants) {
+	CD_ASSERT(args != BufferHandle::Null);
+	CD_ASSERT(!num_constants || constants_slot < max_pipeline_layout_entries);
 
-	if(ID3D12PipelineState* pso = state.pso; pso != graphics_pso.pso) {
-		command_list->SetPipelineState(pso);
-		graphics_pso.pso = pso;
+	issue_barriers();
+	flush_graphics_inputs();
+
+	const Buffer& args_buffer = resources.buffer_pool.get(args);
+	ID3D12Resource* count_buffer = count != BufferHandle::Null ? resources.buffer_pool.get(count).resource : nullptr;
+	command_list->ExecuteIndirect(signature, max_draws, args_buffer.resource, offset, count_buffer, count_offset);
+
+	if(num_constants) {
+		graphics_arguments.valid_slots &= ~(1 << constants_slot);
 	}
 }
 
 void CommandList::add_transition(ID3D12Resource* resource, std::uint32_t index, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
-	if(barrier_buffer.barrier_count == std::size(barrier_buffer.barriers) - 1) {
+	add_barrier(get_resource_transition(resource, index, before, after));
+}
+
+void CommandList::track_texture(TextureHandle handle, std::uint32_t subresource, D3D12_RESOURCE_STATES state, bool merge_read_states) {
+	const Texture& texture = resources.texture_pool.get(handle);
+
+	transitions.clear();
+	state_tracker.use(handle, texture.num_subresources, subresource, state, merge_read_states, transitions);
+	add_transitions(transitions);
+}
+
+void CommandList::add_barrier(const D3D12_RESOURCE_BARRIER& barrier) {
+	if(barrier_buffer.barrier_count == std::size(barrier_buffer.barriers)) {
 		issue_barriers();
 	}
-	barrier_buffer.barriers[barrier_buffer.barrier_count] = get_resource_transition(resource, index, before, after);
+	barrier_buffer.barriers[barrier_buffer.barrier_count] = barrier;
 	++barrier_buffer.barrier_count;
 }
 
-Engine::Engine(const Adapter& adapter, DeviceResources& resources, const ShaderDescriptorHeap& descriptor_heap) :
+Engine::Engine(const Adapter& adapter, DeviceResources& resources, const ShaderDescriptorHeap& descriptor_heap, JobSystem* job_system) :
 	adapter(adapter),
 	resources(resources),
 	swapchain(nullptr),
 	descriptor_heap(descriptor_heap),
-	timing_heap(nullptr),
-	dispatch_indirect_signature(nullptr) {
+	job_system(job_system),
+	view_pools(adapter),
+	query_heaps(),
+	dispatch_indirect_signature(nullptr),
+	command_signatures(adapter),
+	frame_index(0),
+	statistics(),
+	state_fixups() {
 	for(std::size_t type = 0; type < CommandQueueType_Count; ++type) {
 		ID3D12Fence* fence = nullptr;
 		HR_ASSERT(adapter.device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
-		queues[type].fence = {fence, 0, 0};
+		queues[type].fence = {fence, 0, 0, 0, 0, 0};
 
 		D3D12_COMMAND_QUEUE_DESC queue_desc {};
 		queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
@@ -549,16 +914,13 @@ Engine::Engine(const Adapter& adapter, DeviceResources& resources, const ShaderD
 		queue_desc.Type = d3d12_command_list_type(static_cast<CommandQueueType>(type));
 
 		HR_ASSERT(adapter.device->CreateCommandQueue(&queue_desc, IID_PPV_ARGS(&queues[type].queue)));
-	}
 
-	{
-		D3D12_QUERY_HEAP_DESC timing_heap_desc {};
-		timing_heap_desc.Count = max_timestamp_queries;
-		timing_heap_desc.NodeMask = 1 << adapter.node_index;
-		timing_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-		HR_ASSERT(adapter.device->CreateQueryHeap(&timing_heap_desc, IID_PPV_ARGS(&timing_heap)));
+		queues[type].allocators = std::make_unique<CommandAllocatorRing>(adapter, queues[type].queue, queues[type].fence, queue_desc.Type);
 	}
 
+	reserve_queries(QueryType_Timestamp, static_cast<std::uint32_t>(default_timestamp_queries));
+	reserve_queries(QueryType_PipelineStatistics, static_cast<std::uint32_t>(default_pipeline_statistics_queries));
+
 	{
 		D3D12_COMMAND_SIGNATURE_DESC dispatch_indirect_desc {};
 		dispatch_indirect_desc.ByteStride = 12;
@@ -579,19 +941,156 @@ Engine::~Engine() {
 	}
 
 	dispatch_indirect_signature->Release();
-	timing_heap->Release();
+	for(QueryHeap& query_heap : query_heaps) {
+		query_heap.heap->Release();
+	}
 }
 
 Signal Engine::submit_command_buffer(const CommandBuffer& cb, CommandQueueType queue_type) {
-	CommandList& command_list = get_command_list(queue_type);
+	const CommandBuffer* command_buffers[] {&cb};
+	return submit_command_buffers(command_buffers, 1, queue_type);
+}
 
-	for(const std::uint8_t* ptr = cb.get_commands(); ptr < cb.end(); ptr += cb.get_command_size(ptr)) {
+Signal Engine::submit_command_buffers(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType queue_type) {
+	CD_PROFILE_SCOPE("Engine::submit_command_buffers");
+	CD_MEMORY_TAG(MemoryTag_GPU);
+	CD_ASSERT(num_command_buffers <= max_submit_command_buffers);
+
+	CommandQueue& queue = queues[queue_type];
+	++queue.fence.head;
+
+	CommandList* command_lists[max_submit_command_buffers];
+	RetainedCommandList* retained[max_submit_command_buffers] {};
+	bool record_list[max_submit_command_buffers];
+	std::uint64_t translation_ns[max_submit_command_buffers] {};
+	for(std::size_t i = 0; i < num_command_buffers; ++i) {
+		if(command_buffers[i]->is_retained()) {
+			retained[i] = &get_retained_command_list(*command_buffers[i], queue_type);
+			command_lists[i] = retained[i]->command_list.get();
+		}
+		else {
+			command_lists[i] = &get_command_list(queue_type);
+		}
+
+		record_list[i] = command_lists[i]->get_state() == CommandListState::Recording;
+		if(!record_list[i]) {
+			command_lists[i]->resubmit();
+		}
+	}
+
+	auto record = [&](std::uint32_t begin, std::uint32_t end) {
+		CD_MEMORY_TAG(MemoryTag_GPU);
+		for(std::uint32_t i = begin; i < end; ++i) {
+			if(record_list[i]) {
+				std::uint64_t translation_begin = Clock::timestamp_ns();
+				command_lists[i]->reset_statistics();
+				record_commands(*command_lists[i], *command_buffers[i]);
+				command_lists[i]->close();
+				translation_ns[i] = Clock::timestamp_ns() - translation_begin;
+			}
+		}
+	};
+
+	if(job_system && num_command_buffers > 1) {
+		job_system->parallel_for(0, static_cast<std::uint32_t>(num_command_buffers), 1, record);
+	}
+	else {
+		record(0, static_cast<std::uint32_t>(num_command_buffers));
+	}
+
+	++statistics.submits;
+	statistics.command_buffers += num_command_buffers;
+	for(std::size_t i = 0; i < num_command_buffers; ++i) {
+		// Transitions from the states left by the lists submitted before to the ones this list was recorded for.
+		state_fixups.clear();
+		command_lists[i]->resolve_texture_states(state_fixups);
+		if(!state_fixups.empty()) {
+			// Compute and copy lists cannot transition from graphics states, their fix-ups run on the direct queue.
+			CommandQueueType fixup_type = queue_type == CommandQueueType_Direct ? queue_type : CommandQueueType_Direct;
+			CommandQueue& fixup_queue = queues[fixup_type];
+
+			if(fixup_type != queue_type) {
+				++fixup_queue.fence.head;
+			}
+
+			CommandList& fixup_list = get_command_list(fixup_type);
+			fixup_list.reset_statistics();
+			fixup_list.add_transitions(state_fixups);
+			fixup_list.close();
+
+			fixup_queue.pending_command_lists.push_back(&fixup_list);
+			fixup_queue.command_list_buffer.emplace_back(fixup_list.d3d12_command_list());
+			add_submit_statistics(statistics, fixup_list.get_statistics());
+			statistics.state_fixups += state_fixups.size();
+
+			if(fixup_type != queue_type) {
+				fixup_queue.fence.recorded = fixup_queue.fence.head;
+				wait({fixup_type, fixup_queue.fence.head}, queue_type);
+			}
+		}
+
+		if(retained[i]) {
+			retained[i]->valid = command_lists[i]->is_reusable();
+		}
+		else {
+			queue.pending_command_lists.push_back(command_lists[i]);
+		}
+		if(record_list[i]) {
+			add_submit_statistics(statistics, command_lists[i]->get_statistics());
+			statistics.translation_ns += translation_ns[i];
+		}
+		else {
+			++statistics.reused_command_buffers;
+		}
+		add_command_buffer_statistics(statistics, command_buffers[i]->get_statistics());
+		queue.command_list_buffer.emplace_back(command_lists[i]->d3d12_command_list());
+	}
+	queue.fence.recorded = queue.fence.head;
+
+	if(queue_type == CommandQueueType_Compute || queue_type == CommandQueueType_Copy) {
+		flush_queue(queue_type);
+	}
+
+	return {queue_type, queue.fence.head};
+}
+
+void Engine::record_commands(CommandList& command_list, const CommandBuffer& cb) {
+	CD_PROFILE_SCOPE("Engine::record_commands");
+
+	command_list.plan_state_transitions(cb);
+
+	std::uint32_t command_index = 0;
+	for(const std::uint8_t* ptr : cb) {
 		CommandType type = cb.get_command_type(ptr);
 
 		switch(type) {
 		case CommandType::Draw:
 			command_list.draw(ptr);
 			break;
+		case CommandType::DrawIndexed:
+			command_list.draw_indexed(ptr);
+			break;
+		case CommandType::DrawIndirect:
+			command_list.draw_indirect(ptr, command_signatures);
+			break;
+		case CommandType::DrawIndexedIndirect:
+			command_list.draw_indexed_indirect(ptr, command_signatures);
+			break;
+		case CommandType::SetGraphicsPipeline:
+			command_list.set_graphics_pipeline(ptr);
+			break;
+		case CommandType::SetInputGroup:
+			command_list.set_input_group(ptr);
+			break;
+		case CommandType::SetVertexStreams:
+			command_list.set_vertex_streams(ptr);
+			break;
+		case CommandType::SetIndexBuffer:
+			command_list.set_index_buffer(ptr);
+			break;
+		case CommandType::SetScissor:
+			command_list.set_scissor(ptr);
+			break;
 		case CommandType::LayoutBarrier:
 			command_list.transition_barrier(ptr);
 			break;
@@ -623,30 +1122,128 @@ Signal Engine::submit_command_buffer(const CommandBuffer& cb, CommandQueueType q
 			command_list.copy_texture_to_buffer(ptr);
 			break;
 		case CommandType::InsertTimestamp:
-			command_list.insert_timestamp(ptr, timing_heap);
+			command_list.insert_timestamp(ptr, query_heaps[QueryType_Timestamp]);
 			break;
 		case CommandType::ResolveTimestamps:
-			command_list.resolve_timestamps(ptr, timing_heap);
+			command_list.resolve_timestamps(ptr, query_heaps[QueryType_Timestamp]);
 			break;
 		case CommandType::CopyToSwapChain:
 			command_list.copy_to_swapchain(ptr, *swapchain);
 			break;
+		case CommandType::BeginScope:
+			command_list.begin_scope(ptr, query_heaps[QueryType_Timestamp]);
+			break;
+		case CommandType::EndScope:
+			command_list.end_scope(ptr, query_heaps[QueryType_Timestamp]);
+			break;
+		case CommandType::UseTexture:
+			command_list.use_texture(ptr);
+			break;
+		case CommandType::BeginPipelineStatistics:
+			command_list.begin_pipeline_statistics(ptr, query_heaps[QueryType_PipelineStatistics]);
+			break;
+		case CommandType::EndPipelineStatistics:
+			command_list.end_pipeline_statistics(ptr, query_heaps[QueryType_PipelineStatistics]);
+			break;
+		case CommandType::ResolvePipelineStatistics:
+			command_list.resolve_pipeline_statistics(ptr, query_heaps[QueryType_PipelineStatistics]);
+			break;
 		default:
 			CD_FAIL("unhandled type");
 		}
+
+		command_list.begin_split_transitions(command_index++);
 	}
+}
 
-	++queues[queue_type].fence.head;
+Engine::RetainedCommandList& Engine::get_retained_command_list(const CommandBuffer& cb, CommandQueueType queue_type) {
+	CommandQueue& queue = queues[queue_type];
+	auto& retained_lists = retained_command_lists[queue_type];
 
-	command_list.close();
+	auto it = std::find_if(retained_lists.begin(), retained_lists.end(), [&cb](const auto& retained) { return retained->id == cb.get_id(); });
+	if(it == retained_lists.end()) {
+		const ShaderDescriptorHeap* dh = queue_type != CommandQueueType_Copy ? &descriptor_heap : nullptr;
 
-	queues[queue_type].command_list_buffer.emplace_back(command_list.d3d12_command_list());
+		auto& retained = retained_lists.emplace_back(std::make_unique<RetainedCommandList>());
+		retained->id = cb.get_id();
+		retained->generation = cb.get_generation();
+		retained->valid = false;
+		retained->command_list = std::make_unique<CommandList>(adapter, queue.fence, *queue.allocators, resources, view_pools, d3d12_command_list_type(queue_type), dh);
+		it = retained_lists.end() - 1;
+	}
+	else if(!(*it)->valid || (*it)->generation != cb.get_generation()) {
+		// A list submitted earlier on a queue that was not flushed yet must be executed before it is recorded again.
+		auto& buffer = queue.command_list_buffer;
+		if(std::find(buffer.begin(), buffer.end(), (*it)->command_list->d3d12_command_list()) != buffer.end()) {
+			flush_queue(queue_type);
+		}
 
-	if(queue_type == CommandQueueType_Compute || queue_type == CommandQueueType_Copy) {
-		flush_queue(queue_type);
+		(*it)->command_list->reset();
+		(*it)->command_list->lock();
+		(*it)->generation = cb.get_generation();
+	}
+
+	RetainedCommandList& retained = **it;
+	retained.last_fence = queue.fence.head;
+	retained.last_frame = frame_index;
+	return retained;
+}
+
+// Retained lists whose command buffer was not submitted for a while are released once the GPU is done with them.
+void Engine::release_retained_command_lists() {
+	for(std::size_t type = 0; type < CommandQueueType_Count; ++type) {
+		const Fence& fence = queues[type].fence;
+		auto& retained_lists = retained_command_lists[type];
+
+		retained_lists.erase(std::remove_if(retained_lists.begin(), retained_lists.end(), [&](const auto& retained) {
+			return retained->last_frame + retained_command_list_lifetime < frame_index && retained->last_fence <= fence.tail;
+		}), retained_lists.end());
+	}
+}
+
+// Lists recorded against the previous heap may still be in flight, growing a heap waits for the queues to idle.
+// Heaps at least double so a profiler adding ranges over a few frames does not wait every frame.
+void Engine::reserve_queries(QueryType type, std::uint32_t count) {
+	QueryHeap& query_heap = query_heaps[type];
+	if(count <= query_heap.count) {
+		return;
+	}
+
+	if(query_heap.heap) {
+		sync();
+		query_heap.heap->Release();
+
+		for(std::size_t queue_type = 0; queue_type < CommandQueueType_Count; ++queue_type) {
+			for(auto& retained : retained_command_lists[queue_type]) {
+				retained->valid = false;
+			}
+		}
 	}
 
-	return {queue_type, queues[queue_type].fence.head};
+	D3D12_QUERY_HEAP_DESC query_heap_desc {};
+	query_heap_desc.Count = std::max(count, query_heap.count * 2);
+	query_heap_desc.NodeMask = 1 << adapter.node_index;
+	query_heap_desc.Type = d3d12_query_heap_type(type);
+	HR_ASSERT(adapter.device->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&query_heap.heap)));
+	query_heap.count = query_heap_desc.Count;
+}
+
+void Engine::release_texture_views(Texture& texture) {
+	std::lock_guard lock(view_pools.mutex);
+
+	if(!invalid_cpu_handle(texture.rtv)) {
+		view_pools.rtv_pool.remove_descriptor(texture.rtv);
+	}
+	if(!invalid_cpu_handle(texture.dsv_write)) {
+		view_pools.dsv_pool.remove_descriptor(texture.dsv_write);
+	}
+	if(!invalid_cpu_handle(texture.dsv_read)) {
+		view_pools.dsv_pool.remove_descriptor(texture.dsv_read);
+	}
+
+	texture.rtv = {~0ui64};
+	texture.dsv_write = {~0ui64};
+	texture.dsv_read = {~0ui64};
 }
 
 void Engine::block(const Signal& fence) {
@@ -656,8 +1253,8 @@ void Engine::block(const Signal& fence) {
 	CommandQueue& queue = queues[fence.queue];
 	CD_ASSERT(fence.value <= queue.fence.last_signal);
 
-	HR_ASSERT(queue.fence.fence->SetEventOnCompletion(queue.fence.head, nullptr));
-	queue.fence.tail = queue.fence.head;
+	HR_ASSERT(queue.fence.fence->SetEventOnCompletion(fence.value, nullptr));
+	queue.fence.tail = std::max(queue.fence.tail, fence.value);
 }
 
 Signal Engine::present() {
@@ -677,6 +1274,20 @@ Signal Engine::present() {
 		queue.fence.tail = queue.fence.fence->GetCompletedValue();
 	}
 
+	++frame_index;
+	release_retained_command_lists();
+
+	statistics.command_allocators = 0;
+	for(CommandQueue& queue : queues) {
+		queue.allocators->trim();
+
+		const CommandAllocatorStatistics& allocator_statistics = queue.allocators->get_statistics();
+		statistics.command_allocators += allocator_statistics.allocators;
+		statistics.command_allocator_acquires += allocator_statistics.acquires;
+		statistics.command_allocator_reuses += allocator_statistics.reuses;
+		queue.allocators->reset_statistics();
+	}
+
 	return {CommandQueueType_Direct, fence.head};
 }
 
@@ -703,6 +1314,7 @@ void Engine::wait(const Signal& signal, CommandQueueType type) {
 
 	CD_ASSERT(producer.fence.head >= signal.value);
 
+	flush_queue(signal.queue);
 	signal_queue(signal.queue);
 	flush_queue(type);
 
@@ -720,14 +1332,15 @@ void Engine::flush_queue(CommandQueueType type) {
 	if(std::size_t size = queue.command_list_buffer.size()) {
 		queue.queue->ExecuteCommandLists(static_cast<std::uint32_t>(size), queue.command_list_buffer.data());
 
-		for(auto& command_list : command_list_pool[type]) {
-			if(command_list->get_state() == CommandListState::Pending) {
-				command_list->reset();
-			}
+		for(CommandList* command_list : queue.pending_command_lists) {
+			command_list->reset();
+			queue.free_command_lists.push_back(command_list);
 		}
 
+		queue.pending_command_lists.clear();
 		queue.command_list_buffer.clear();
 	}
+	queue.fence.executed = queue.fence.recorded;
 }
 
 void Engine::sync() {
@@ -2,10 +2,18 @@
 
 #include <CD/GPU/D3D12/Common.hpp>
 #include <CD/GPU/CommandBuffer.hpp>
+#include <CD/Common/JobSystem.hpp>
+#include <deque>
+#include <mutex>
 #include <vector>
 
 namespace CD::GPU::D3D12 {
 
+constexpr std::size_t max_batched_barriers = 64;
+constexpr std::uint64_t retained_command_list_lifetime = 8;
+constexpr std::size_t max_command_allocators = 256;
+constexpr std::uint32_t command_allocator_trim_frames = 32;
+
 constexpr D3D12_RESOURCE_BARRIER get_resource_transition(ID3D12Resource* resource, std::uint32_t subresource, D3D12_RESOURCE_STATES state_before, D3D12_RESOURCE_STATES state_after) {
 	return {
 		D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
@@ -33,11 +41,114 @@ constexpr D3D12_COMMAND_LIST_TYPE d3d12_command_list_type(CommandQueueType type)
 	return D3D12_COMMAND_LIST_TYPE_BUNDLE;
 }
 
+constexpr std::uint32_t d3d12_read_only_states(D3D12_COMMAND_LIST_TYPE type) {
+	std::uint32_t states = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+		| D3D12_RESOURCE_STATE_INDEX_BUFFER
+		| D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+		| D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT
+		| D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+	if(type == D3D12_COMMAND_LIST_TYPE_DIRECT) {
+		states |= D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+	}
+
+	return states;
+}
+
+// head is the value of the last submission, recorded the last one whose lists were all added to the queue's
+// buffer and executed the last one whose lists were passed to the queue. Only executed values can be signaled.
 struct Fence {
 	ID3D12Fence* fence;
 	std::uint64_t head;
 	std::uint64_t tail;
 	std::uint64_t last_signal;
+	std::uint64_t recorded;
+	std::uint64_t executed;
+};
+
+struct QueryHeap {
+	ID3D12QueryHeap* heap;
+	std::uint32_t count;
+};
+
+struct CommandAllocatorStatistics {
+	std::uint32_t allocators;
+	std::uint64_t acquires;
+	std::uint64_t reuses;
+	std::uint64_t waits;
+	std::uint64_t trimmed;
+};
+
+// Command allocators of one queue, recycled in the order they were released. An allocator is reused once the
+// fence value it was released with has completed. Past max_command_allocators, acquire waits for the oldest one
+// if its lists were executed and creates a new one otherwise, trim releases completed allocators above the peak
+// number recorded into during the last frames.
+class CommandAllocatorRing {
+public:
+	CommandAllocatorRing(const Adapter&, ID3D12CommandQueue*, Fence&, D3D12_COMMAND_LIST_TYPE);
+	~CommandAllocatorRing();
+
+	CommandAllocatorRing(const CommandAllocatorRing&) = delete;
+	CommandAllocatorRing& operator=(const CommandAllocatorRing&) = delete;
+
+	ID3D12CommandAllocator* acquire();
+	void release(ID3D12CommandAllocator*, std::uint64_t fence_value);
+	void trim();
+
+	const CommandAllocatorStatistics& get_statistics() const;
+	void reset_statistics();
+private:
+	struct ReleasedAllocator {
+		ID3D12CommandAllocator* allocator;
+		std::uint64_t fence_value;
+	};
+
+	const Adapter& adapter;
+	ID3D12CommandQueue* queue;
+	Fence& fence;
+	D3D12_COMMAND_LIST_TYPE type;
+
+	std::deque<ReleasedAllocator> ring;
+	std::uint64_t completed_value;
+	std::uint32_t in_use;
+	std::uint32_t frame_peak;
+	std::uint32_t idle_target;
+	std::uint32_t idle_target_age;
+	CommandAllocatorStatistics statistics;
+
+	bool is_complete(std::uint64_t fence_value);
+};
+
+// Command signatures for indirect draws, created the first time a layout is used. Signatures writing root
+// constants are bound to the root signature they were created for.
+class CommandSignatureCache {
+public:
+	CommandSignatureCache(const Adapter&);
+	~CommandSignatureCache();
+
+	ID3D12CommandSignature* get_draw_signature(ID3D12RootSignature*, bool indexed, std::uint32_t constants_slot, std::uint32_t num_constants);
+private:
+	struct DrawSignature {
+		ID3D12RootSignature* root_signature;
+		bool indexed;
+		std::uint32_t constants_slot;
+		std::uint32_t num_constants;
+		ID3D12CommandSignature* signature;
+	};
+
+	const Adapter& adapter;
+	std::mutex mutex;
+	std::vector<DrawSignature> draw_signatures;
+};
+
+// Render target and depth stencil views are created the first time a texture is bound to a render pass and cached
+// in the texture. The pools are owned by the engine so the views outlive the command lists that created them.
+struct TextureViewPools {
+	TextureViewPools(const Adapter&);
+
+	std::mutex mutex;
+	DescriptorPool rtv_pool;
+	DescriptorPool dsv_pool;
 };
 
 enum class CommandListState {
@@ -47,15 +158,19 @@ enum class CommandListState {
 };
 
 class CommandList {
-	using CommandAllocator = std::pair<ID3D12CommandAllocator*, std::uint64_t>;
 public:
-	CommandList(const Adapter&, const Fence&, DeviceResources&, D3D12_COMMAND_LIST_TYPE, const ShaderDescriptorHeap*);
+	CommandList(const Adapter&, const Fence&, CommandAllocatorRing&, DeviceResources&, TextureViewPools&, D3D12_COMMAND_LIST_TYPE, const ShaderDescriptorHeap*);
 	~CommandList();
 
 	CommandListState get_state();
 	void lock();
 	void close();
 	void reset();
+	void resubmit();
+	bool is_reusable() const;
+
+	const SubmitStatistics& get_statistics() const;
+	void reset_statistics();
 
 	ID3D12CommandList* d3d12_command_list();
 
@@ -70,32 +185,54 @@ public:
 	void dispatch(const void*);
 	void dispatch_indirect(const void*, ID3D12CommandSignature*);
 	void draw(const void*);
+	void draw_indexed(const void*);
+	void draw_indirect(const void*, CommandSignatureCache&);
+	void draw_indexed_indirect(const void*, CommandSignatureCache&);
+	void set_graphics_pipeline(const void*);
+	void set_input_group(const void*);
+	void set_vertex_streams(const void*);
+	void set_index_buffer(const void*);
+	void set_scissor(const void*);
 	void copy_to_swapchain(const void*, const SwapChain&);
-	void insert_timestamp(const void*, ID3D12QueryHeap*);
-	void resolve_timestamps(const void*, ID3D12QueryHeap*);
+	void insert_timestamp(const void*, const QueryHeap&);
+	void resolve_timestamps(const void*, const QueryHeap&);
+	void begin_scope(const void*, const QueryHeap&);
+	void end_scope(const void*, const QueryHeap&);
+	void use_texture(const void*);
+	void begin_pipeline_statistics(const void*, const QueryHeap&);
+	void end_pipeline_statistics(const void*, const QueryHeap&);
+	void resolve_pipeline_statistics(const void*, const QueryHeap&);
+
+	void plan_state_transitions(const CommandBuffer&);
+	void begin_split_transitions(std::uint32_t command_index);
+	void add_transitions(const std::vector<StateTransition>&);
+	void resolve_texture_states(std::vector<StateTransition>&);
 private:
 	const Adapter& adapter;
 	const Fence& fence;
 	D3D12_COMMAND_LIST_TYPE type;
 	CommandListState state;
+	bool reusable;
+	SubmitStatistics statistics;
 
 	DeviceResources& resources;
+	TextureViewPools& view_pools;
 	const ShaderDescriptorHeap* descriptor_heap;
-	DescriptorPool rtv_pool;
-	DescriptorPool dsv_pool;
 
 	ID3D12GraphicsCommandList5* command_list;
-	std::vector<CommandAllocator> allocators;
-	CommandAllocator* current_allocator;
+	CommandAllocatorRing& allocator_ring;
+	ID3D12CommandAllocator* current_allocator;
+	std::uint64_t allocator_fence;
 
 	struct BarrierBuffer {
-		D3D12_RESOURCE_BARRIER barriers[10];
+		D3D12_RESOURCE_BARRIER barriers[max_batched_barriers];
 		std::uint32_t barrier_count;
 	};
 
 	struct RootSignatureState {
 		PipelineInputState arguments;
-		bool cleared;
+		std::uint32_t valid_slots;
+		std::uint32_t dirty_slots;
 	};
 
 	BarrierBuffer barrier_buffer;
@@ -103,18 +240,25 @@ private:
 	PipelineState compute_pso;
 	RootSignatureState graphics_arguments;
 	RootSignatureState compute_arguments;
-	RenderPass* current_render_pass;
+	const RenderPass* current_render_pass;
+
+	ResourceStateTracker state_tracker;
+	std::vector<StateTransition> transitions;
+	std::size_t next_split;
 
 	void set_descriptor_heap(const ShaderDescriptorHeap&);
 	void issue_barriers();
 	void set_compute_state(const PipelineState&, const PipelineInputState&);
-	void set_graphics_state(const PipelineState&, const PipelineInputState&);
+	void flush_graphics_inputs();
 	void add_transition(ID3D12Resource*, std::uint32_t index, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+	void track_texture(TextureHandle, std::uint32_t subresource, D3D12_RESOURCE_STATES, bool merge_read_states);
+	void add_barrier(const D3D12_RESOURCE_BARRIER&);
+	void execute_draws(ID3D12CommandSignature*, BufferHandle args, std::uint32_t offset, std::uint32_t max_draws, BufferHandle count, std::uint32_t count_offset, std::uint32_t constants_slot, std::uint32_t num_constants);
 };
 
 class Engine {
 public:
-	Engine(const Adapter&, DeviceResources&, const ShaderDescriptorHeap&);
+	Engine(const Adapter&, DeviceResources&, const ShaderDescriptorHeap&, JobSystem*);
 	~Engine();
 
 	void set_swapchain(const SwapChain*);
@@ -131,37 +275,87 @@ public:
 	void sync();
 
 	Signal submit_command_buffer(const CommandBuffer&, CommandQueueType);
+	Signal submit_command_buffers(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType);
 	Signal present();
+
+	void reserve_queries(QueryType, std::uint32_t count);
+	void release_texture_views(Texture&);
+
+	const SubmitStatistics& get_statistics() const;
+	void reset_statistics();
 private:
 	struct CommandQueue {
 		ID3D12CommandQueue* queue;
 		Fence fence;
 		std::vector<ID3D12CommandList*> command_list_buffer;
+		std::unique_ptr<CommandAllocatorRing> allocators;
+		std::vector<CommandList*> pending_command_lists;
+		std::vector<CommandList*> free_command_lists;
+	};
+
+	struct RetainedCommandList {
+		std::uint64_t id;
+		std::uint32_t generation;
+		bool valid;
+		std::uint64_t last_fence;
+		std::uint64_t last_frame;
+		std::unique_ptr<CommandList> command_list;
 	};
 
 	const Adapter& adapter;
 	DeviceResources& resources;
 	const ShaderDescriptorHeap& descriptor_heap;
 	const SwapChain* swapchain;
+	JobSystem* job_system;
+	TextureViewPools view_pools;
 
 	CommandQueue queues[CommandQueueType_Count];
 	std::vector<std::unique_ptr<CommandList>> command_list_pool[CommandQueueType_Count];
+	std::vector<std::unique_ptr<RetainedCommandList>> retained_command_lists[CommandQueueType_Count];
+	std::uint64_t frame_index;
+	SubmitStatistics statistics;
+	std::vector<StateTransition> state_fixups;
 
-	ID3D12QueryHeap* timing_heap;
+	QueryHeap query_heaps[QueryType_Count];
 	ID3D12CommandSignature* dispatch_indirect_signature;
+	CommandSignatureCache command_signatures;
+
+	void record_commands(CommandList&, const CommandBuffer&);
+	RetainedCommandList& get_retained_command_list(const CommandBuffer&, CommandQueueType);
+	void release_retained_command_lists();
 };
 
 inline CommandList& Engine::get_command_list(CommandQueueType type) {
 	CommandQueue& queue = queues[type];
-	for(auto& command_list : command_list_pool[type]) {
-		if(command_list->get_state() == CommandListState::Reset) {
-			command_list->lock();
-			return *command_list;
-		}
+	if(!queue.free_command_lists.empty()) {
+		CommandList* command_list = queue.free_command_lists.back();
+		queue.free_command_lists.pop_back();
+		command_list->lock();
+		return *command_list;
 	}
 
 	const ShaderDescriptorHeap* dh = type != CommandQueueType_Copy ? &descriptor_heap : nullptr;
-	return *command_list_pool[type].emplace_back(std::make_unique<CommandList>(adapter, queues[type].fence, resources, d3d12_command_list_type(type), dh));
+	return *command_list_pool[type].emplace_back(std::make_unique<CommandList>(adapter, queue.fence, *queue.allocators, resources, view_pools, d3d12_command_list_type(type), dh));
+}
+
+inline const CommandAllocatorStatistics& CommandAllocatorRing::get_statistics() const {
+	return statistics;
+}
+
+inline const SubmitStatistics& CommandList::get_statistics() const {
+	return statistics;
+}
+
+inline void CommandList::reset_statistics() {
+	statistics = {};
+}
+
+inline const SubmitStatistics& Engine::get_statistics() const {
+	return statistics;
+}
+
+inline void Engine::reset_statistics() {
+	statistics = {};
 }
 
 }
\ No newline at end of file
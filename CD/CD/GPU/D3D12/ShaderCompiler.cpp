@@ -1,8 +1,8 @@
-#include <CD/GPU/Shader.hpp>
+#include <CD/GPU/D3D12/ShaderCompiler.hpp>
 #include <CD/Common/Debug.hpp>
-#include <vector>
+#include <cstring>
 
-namespace CD::GPU {
+namespace CD::GPU::D3D12 {
 
 using Microsoft::WRL::ComPtr;
 
@@ -28,17 +28,21 @@ ShaderCompiler::~ShaderCompiler() {
 }
 
 ShaderPtr ShaderCompiler::compile_shader(const CompileShaderDesc& desc) {
-	std::vector<const wchar_t*> args;
-	args.push_back(L"-E");
-	args.push_back(desc.entry_point);
-	args.push_back(L"-T");
-	args.push_back(shader_profiles[static_cast<std::size_t>(desc.profile)]);
-	args.push_back(DXC_ARG_DEBUG);
-	args.push_back(DXC_ARG_PACK_MATRIX_ROW_MAJOR);
+	CD_ASSERT(desc.num_defines <= max_shader_defines);
+
+	const wchar_t* args[6 + 2 * max_shader_defines] {
+		L"-E",
+		desc.entry_point,
+		L"-T",
+		shader_profiles[static_cast<std::size_t>(desc.profile)],
+		DXC_ARG_DEBUG,
+		DXC_ARG_PACK_MATRIX_ROW_MAJOR
+	};
+	std::uint32_t num_args = 6;
 
 	for(std::size_t i = 0; i < desc.num_defines; ++i) {
-		args.push_back(L"-D");
-		args.push_back(desc.defines[i]);
+		args[num_args++] = L"-D";
+		args[num_args++] = desc.defines[i];
 	}
 
 	std::uint32_t code_page = CP_UTF8;
@@ -49,8 +53,8 @@ ShaderPtr ShaderCompiler::compile_shader(const CompileShaderDesc& desc) {
 	ComPtr<IDxcResult> result;
 	ASSERT_SUCCEEDED(compiler->Compile(
 		&source_buffer,
-		args.data(),
-		static_cast<UINT>(args.size()),
+		args,
+		num_args,
 		include_handler,
 		IID_PPV_ARGS(&result)
 	));
@@ -61,10 +65,14 @@ ShaderPtr ShaderCompiler::compile_shader(const CompileShaderDesc& desc) {
 		CD_FAIL(errors->GetStringPointer());
 	}
 
-	IDxcBlob* shader = nullptr;
+	ComPtr<IDxcBlob> shader;
 	ASSERT_SUCCEEDED(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shader), nullptr));
 
-	return ShaderPtr(shader);
+	ShaderPtr blob = std::make_unique<ShaderBlob>();
+	blob->size = shader->GetBufferSize();
+	blob->bytecode = std::make_unique<std::uint8_t[]>(blob->size);
+	std::memcpy(blob->bytecode.get(), shader->GetBufferPointer(), blob->size);
+	return blob;
 }
 
 }
\ No newline at end of file
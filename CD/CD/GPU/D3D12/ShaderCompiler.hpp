@@ -0,0 +1,22 @@
+#pragma once
+
+#include <CD/GPU/Shader.hpp>
+#include <wrl/client.h>
+#include <dxc/Support/dxcapi.use.h>
+
+namespace CD::GPU::D3D12 {
+
+class ShaderCompiler : public GPU::ShaderCompiler {
+public:
+	ShaderCompiler();
+	~ShaderCompiler();
+
+	ShaderPtr compile_shader(const CompileShaderDesc&) final;
+private:
+	dxc::DxcDllSupport dll_helper;
+	IDxcUtils* utils;
+	IDxcCompiler3* compiler;
+	IDxcIncludeHandler* include_handler;
+};
+
+}
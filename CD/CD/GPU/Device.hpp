@@ -6,6 +6,7 @@ namespace CD::GPU {
 
 class CommandBuffer;
 class ShaderCompiler;
+struct SubmitStatistics;
 
 class Device {
 public:
@@ -37,9 +38,14 @@ public:
 	virtual void wait(const Signal& producer, CommandQueueType queue) = 0;
 	virtual void wait_for_fence(const Signal& producer) = 0;
 	virtual Signal submit_commands(const CommandBuffer&, CommandQueueType) = 0;
+	virtual Signal submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType) = 0;
 	virtual Signal reset() = 0;
 
+	virtual const SubmitStatistics& get_submit_statistics() const = 0;
+	virtual void reset_submit_statistics() = 0;
+
 	virtual void resize_buffers(std::uint32_t width, std::uint32_t height) = 0;
+	virtual void reserve_queries(QueryType, std::uint32_t count) = 0;
 	virtual DeviceFeatureInfo report_feature_info() = 0;
 	virtual ShaderCompiler& get_shader_compiler() = 0;
 };
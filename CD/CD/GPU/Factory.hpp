@@ -3,11 +3,18 @@
 #include <CD/Common/Common.hpp>
 #include <CD/GPU/Device.hpp>
 
+namespace CD {
+
+class JobSystem;
+
+}
+
 namespace CD::GPU {
 
 struct CreateDeviceDesc {
 	const SwapChainDesc* swapchain;
 	bool allow_uma;
+	JobSystem* job_system;
 };
 
 class Factory {
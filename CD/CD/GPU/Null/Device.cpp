@@ -0,0 +1,259 @@
+#include <CD/GPU/Null/Device.hpp>
+#include <CD/Common/Clock.hpp>
+#include <CD/Common/Profiler.hpp>
+
+namespace CD::GPU::Null {
+
+ShaderPtr ShaderCompiler::compile_shader(const CompileShaderDesc& desc) {
+	CD_ASSERT(desc.path && desc.entry_point);
+	CD_ASSERT(desc.num_defines <= max_shader_defines);
+
+	ShaderPtr blob = std::make_unique<ShaderBlob>();
+	blob->size = sizeof(std::uint32_t);
+	blob->bytecode = std::make_unique<std::uint8_t[]>(blob->size);
+	return blob;
+}
+
+Device::Device(bool record_submissions) :
+	buffer_pool(),
+	texture_pool(),
+	pipeline_state_pool(1 << 8),
+	descriptor_table_pool(),
+	render_pass_pool(1 << 8),
+	fence_values(),
+	command_counts(),
+	submit_statistics(),
+	recording(record_submissions),
+	width(),
+	height() {
+
+	buffer_pool.add({});
+	texture_pool.add({});
+	descriptor_table_pool.add({});
+	pipeline_state_pool.add({});
+	render_pass_pool.add({});
+}
+
+Device::~Device() = default;
+
+BufferHandle Device::create_buffer(const BufferDesc& desc) {
+	CD_ASSERT(desc.size);
+
+	Buffer buffer {desc, nullptr};
+	if(desc.storage != BufferStorage::Device) {
+		buffer.memory = new std::uint8_t[desc.size];
+	}
+
+	return static_cast<BufferHandle>(buffer_pool.add(buffer));
+}
+
+TextureHandle Device::create_texture(const TextureDesc& desc) {
+	CD_ASSERT(desc.width && desc.height);
+	return static_cast<TextureHandle>(texture_pool.add({desc}));
+}
+
+PipelineHandle Device::create_render_pass(const RenderPassDesc& desc) {
+	CD_ASSERT(desc.num_render_targets <= max_render_targets);
+
+	RenderPass render_pass {desc.num_render_targets, desc.depth_stencil_target != nullptr};
+	return {render_pass_pool.add(render_pass), PipelineResourceType::RenderPass};
+}
+
+PipelineHandle Device::create_pipeline_input_list(std::uint32_t num_descriptors) {
+	return {descriptor_table_pool.add({num_descriptors}), PipelineResourceType::PipelineInputList};
+}
+
+PipelineHandle Device::create_pipeline_state(const GraphicsPipelineDesc& desc, const PipelineInputLayout& layout) {
+	CD_ASSERT(desc.vs.bytecode && desc.vs.size);
+	CD_ASSERT(layout.num_entries <= max_pipeline_layout_entries);
+
+	PipelineState pso {PipelineResourceType::GraphicsPipeline, layout};
+	return {pipeline_state_pool.add(pso), PipelineResourceType::GraphicsPipeline};
+}
+
+PipelineHandle Device::create_pipeline_state(const ComputePipelineDesc& desc, const PipelineInputLayout& layout) {
+	CD_ASSERT(desc.compute_shader.bytecode && desc.compute_shader.size);
+	CD_ASSERT(layout.num_entries <= max_pipeline_layout_entries);
+
+	PipelineState pso {PipelineResourceType::ComputePipeline, layout};
+	return {pipeline_state_pool.add(pso), PipelineResourceType::ComputePipeline};
+}
+
+void Device::destroy_buffer(BufferHandle handle) {
+	Buffer& buffer = buffer_pool.get(handle);
+	delete[] buffer.memory;
+	buffer = {};
+	buffer_pool.remove(handle);
+}
+
+void Device::destroy_texture(TextureHandle handle) {
+	texture_pool.remove(handle);
+}
+
+void Device::destroy_pipeline_resource(PipelineHandle resource) {
+	switch(resource.type) {
+	case PipelineResourceType::ComputePipeline:
+	case PipelineResourceType::GraphicsPipeline:
+		CD_ASSERT(pipeline_state_pool.get(resource.handle).type == resource.type);
+		pipeline_state_pool.remove(resource.handle);
+		break;
+	case PipelineResourceType::PipelineInputList:
+		descriptor_table_pool.remove(resource.handle);
+		break;
+	case PipelineResourceType::RenderPass:
+		render_pass_pool.remove(resource.handle);
+		break;
+	}
+}
+
+void Device::map_buffer(BufferHandle handle, void** data, std::uint64_t offset, std::uint64_t size) {
+	Buffer& buffer = buffer_pool.get(handle);
+	CD_ASSERT(buffer.memory);
+	CD_ASSERT(offset + size <= buffer.desc.size);
+
+	*data = buffer.memory + offset;
+}
+
+void Device::unmap_buffer(BufferHandle handle, std::uint64_t offset, std::uint64_t size) {
+	const Buffer& buffer = buffer_pool.get(handle);
+	CD_ASSERT(buffer.memory);
+	CD_ASSERT(offset + size <= buffer.desc.size);
+}
+
+void Device::update_pipeline_input_list(PipelineHandle handle, DescriptorType, const TextureView* views, std::uint64_t num_textures, std::uint64_t offset) {
+	CD_ASSERT(handle.type == PipelineResourceType::PipelineInputList);
+
+	const DescriptorTable& list = descriptor_table_pool.get(handle.handle);
+	CD_ASSERT(offset + num_textures <= list.num_descriptors);
+
+	for(std::size_t i = 0; i < num_textures; ++i) {
+		CD_ASSERT(texture_pool.is_valid(views[i].texture));
+	}
+}
+
+void Device::update_pipeline_input_list(PipelineHandle handle, DescriptorType type, const BufferView* views, std::uint64_t num_buffers, std::uint64_t offset) {
+	CD_ASSERT(handle.type == PipelineResourceType::PipelineInputList);
+	CD_ASSERT(type <= DescriptorType::CBV);
+
+	const DescriptorTable& list = descriptor_table_pool.get(handle.handle);
+	CD_ASSERT(offset + num_buffers <= list.num_descriptors);
+
+	for(std::size_t i = 0; i < num_buffers; ++i) {
+		CD_ASSERT(buffer_pool.is_valid(views[i].buffer));
+	}
+}
+
+void Device::signal(CommandQueueType queue) {
+	signal_queue(queue);
+}
+
+void Device::wait(const Signal& producer, CommandQueueType) {
+	CD_ASSERT(producer.value <= fence_values[producer.queue].load(std::memory_order_acquire));
+}
+
+void Device::wait_for_fence(const Signal& producer) {
+	CD_ASSERT(producer.value <= fence_values[producer.queue].load(std::memory_order_acquire));
+}
+
+Signal Device::submit_commands(const CommandBuffer& command_buffer, CommandQueueType queue) {
+	const CommandBuffer* command_buffers[] {&command_buffer};
+	return submit_commands(command_buffers, 1, queue);
+}
+
+Signal Device::submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType queue) {
+	CD_PROFILE_SCOPE("Null::Device::submit_commands");
+	CD_ASSERT(num_command_buffers <= max_submit_command_buffers);
+
+	const std::uint64_t translation_begin = Clock::timestamp_ns();
+	for(std::size_t i = 0; i < num_command_buffers; ++i) {
+		for(const std::uint8_t* command : *command_buffers[i]) {
+			CommandType type = command_buffers[i]->get_command_type(command);
+			CD_ASSERT(type < CommandType::Invalid);
+			command_counts[static_cast<std::size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	{
+		std::lock_guard lock(statistics_mutex);
+		++submit_statistics.submits;
+		submit_statistics.command_buffers += num_command_buffers;
+		for(std::size_t i = 0; i < num_command_buffers; ++i) {
+			add_command_buffer_statistics(submit_statistics, command_buffers[i]->get_statistics());
+		}
+		submit_statistics.translation_ns += Clock::timestamp_ns() - translation_begin;
+	}
+
+	Signal signal = signal_queue(queue);
+
+	if(recording.load(std::memory_order_relaxed)) {
+		std::lock_guard lock(recording_mutex);
+
+		for(std::size_t i = 0; i < num_command_buffers; ++i) {
+			const CommandBuffer& command_buffer = *command_buffers[i];
+
+			RecordedSubmission& submission = recorded_submissions.emplace_back();
+			submission.queue = queue;
+			submission.signal = signal;
+			submission.num_commands = command_buffer.get_command_count();
+			for(const std::uint8_t* command : command_buffer) {
+				submission.commands.insert(submission.commands.end(), command, command + command_buffer.get_command_size(command));
+			}
+		}
+	}
+
+	return signal;
+}
+
+Signal Device::reset() {
+	return signal_queue(CommandQueueType_Direct);
+}
+
+const SubmitStatistics& Device::get_submit_statistics() const {
+	return submit_statistics;
+}
+
+void Device::reset_submit_statistics() {
+	std::lock_guard lock(statistics_mutex);
+	submit_statistics = {};
+}
+
+void Device::resize_buffers(std::uint32_t new_width, std::uint32_t new_height) {
+	width = new_width;
+	height = new_height;
+}
+
+void Device::reserve_queries(QueryType, std::uint32_t) {
+}
+
+DeviceFeatureInfo Device::report_feature_info() {
+	DeviceFeatureInfo info {};
+	info.uma = true;
+	for(std::size_t type = CommandQueueType_Direct; type < CommandQueueType_Count; ++type) {
+		info.timestamp_frequency[type] = 1000000000;
+	}
+	return info;
+}
+
+GPU::ShaderCompiler& Device::get_shader_compiler() {
+	return compiler;
+}
+
+void Device::set_recording(bool enable) {
+	recording.store(enable, std::memory_order_relaxed);
+}
+
+std::vector<RecordedSubmission> Device::take_recorded_submissions() {
+	std::lock_guard lock(recording_mutex);
+	return std::move(recorded_submissions);
+}
+
+std::uint64_t Device::get_submitted_command_count(CommandType type) const {
+	CD_ASSERT(type < CommandType::Invalid);
+	return command_counts[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+}
+
+Signal Device::signal_queue(CommandQueueType queue) {
+	return {queue, fence_values[queue].fetch_add(1, std::memory_order_acq_rel) + 1};
+}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <CD/GPU/Device.hpp>
+#include <CD/GPU/CommandBuffer.hpp>
+#include <CD/GPU/Shader.hpp>
+#include <CD/Common/ConcurrentResourcePool.hpp>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace CD::GPU::Null {
+
+class ShaderCompiler : public GPU::ShaderCompiler {
+public:
+	ShaderPtr compile_shader(const CompileShaderDesc&) final;
+};
+
+struct Buffer {
+	BufferDesc desc;
+	std::uint8_t* memory;
+};
+
+struct Texture {
+	TextureDesc desc;
+};
+
+struct PipelineState {
+	PipelineResourceType type;
+	PipelineInputLayout layout;
+};
+
+struct DescriptorTable {
+	std::uint32_t num_descriptors;
+};
+
+struct RenderPass {
+	std::uint32_t num_render_targets;
+	bool depth_stencil;
+};
+
+struct RecordedSubmission {
+	CommandQueueType queue;
+	Signal signal;
+	std::uint32_t num_commands;
+	std::vector<std::uint8_t> commands;
+};
+
+class Device : public GPU::Device {
+public:
+	Device(bool record_submissions = false);
+	~Device();
+
+	BufferHandle create_buffer(const BufferDesc&) final;
+	TextureHandle create_texture(const TextureDesc&) final;
+	PipelineHandle create_render_pass(const RenderPassDesc&) final;
+	PipelineHandle create_pipeline_input_list(std::uint32_t num_descriptors) final;
+	PipelineHandle create_pipeline_state(const GraphicsPipelineDesc&, const PipelineInputLayout&) final;
+	PipelineHandle create_pipeline_state(const ComputePipelineDesc&, const PipelineInputLayout&) final;
+
+	void destroy_buffer(BufferHandle) final;
+	void destroy_texture(TextureHandle) final;
+	void destroy_pipeline_resource(PipelineHandle) final;
+
+	void map_buffer(BufferHandle, void** data, std::uint64_t offset, std::uint64_t size) final;
+	void unmap_buffer(BufferHandle, std::uint64_t offset, std::uint64_t size) final;
+
+	void update_pipeline_input_list(PipelineHandle, DescriptorType, const TextureView* views, std::uint64_t num_textures, std::uint64_t offset) final;
+	void update_pipeline_input_list(PipelineHandle, DescriptorType, const BufferView* views, std::uint64_t num_buffers, std::uint64_t offset) final;
+
+	void signal(CommandQueueType) final;
+	void wait(const Signal& producer, CommandQueueType queue) final;
+	void wait_for_fence(const Signal&) final;
+	Signal submit_commands(const CommandBuffer&, CommandQueueType) final;
+	Signal submit_commands(const CommandBuffer* const* command_buffers, std::size_t num_command_buffers, CommandQueueType) final;
+	Signal reset() final;
+
+	const SubmitStatistics& get_submit_statistics() const final;
+	void reset_submit_statistics() final;
+
+	void resize_buffers(std::uint32_t width, std::uint32_t height) final;
+	void reserve_queries(QueryType, std::uint32_t count) final;
+	DeviceFeatureInfo report_feature_info() final;
+	GPU::ShaderCompiler& get_shader_compiler() final;
+
+	void set_recording(bool);
+	std::vector<RecordedSubmission> take_recorded_submissions();
+	std::uint64_t get_submitted_command_count(CommandType) const;
+private:
+	ConcurrentResourcePool<Buffer> buffer_pool;
+	ConcurrentResourcePool<Texture> texture_pool;
+	ConcurrentResourcePool<PipelineState> pipeline_state_pool;
+	ConcurrentResourcePool<DescriptorTable> descriptor_table_pool;
+	ConcurrentResourcePool<RenderPass> render_pass_pool;
+
+	std::atomic<std::uint64_t> fence_values[CommandQueueType_Count];
+	std::atomic<std::uint64_t> command_counts[static_cast<std::size_t>(CommandType::Invalid)];
+
+	mutable std::mutex statistics_mutex;
+	SubmitStatistics submit_statistics;
+
+	std::atomic<bool> recording;
+	std::mutex recording_mutex;
+	std::vector<RecordedSubmission> recorded_submissions;
+
+	std::uint32_t width;
+	std::uint32_t height;
+
+	ShaderCompiler compiler;
+
+	Signal signal_queue(CommandQueueType);
+};
+
+}
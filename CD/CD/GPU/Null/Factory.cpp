@@ -0,0 +1,25 @@
+#include <CD/GPU/Null/Factory.hpp>
+
+namespace CD::GPU::Null {
+
+Factory::Factory(bool record_submissions) :
+	record_submissions(record_submissions) {
+}
+
+std::size_t Factory::get_device_count() const {
+	return 1;
+}
+
+Device* Factory::create_device(const CreateDeviceDesc& desc, std::size_t index) {
+	if(index >= get_device_count()) {
+		return nullptr;
+	}
+
+	Device* device = devices.emplace_back(std::make_unique<Device>(record_submissions)).get();
+	if(desc.swapchain) {
+		device->resize_buffers(desc.swapchain->width, desc.swapchain->height);
+	}
+	return device;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <CD/GPU/Factory.hpp>
+#include <CD/GPU/Null/Device.hpp>
+#include <memory>
+#include <vector>
+
+namespace CD::GPU::Null {
+
+class Factory : public GPU::Factory {
+public:
+	Factory(bool record_submissions = false);
+
+	Device* create_device(const CreateDeviceDesc&, std::size_t index) final;
+	std::size_t get_device_count() const final;
+private:
+	bool record_submissions;
+
+	std::vector<std::unique_ptr<Device>> devices;
+};
+
+}
@@ -0,0 +1,238 @@
+#include <CD/GPU/QueueScheduler.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <algorithm>
+
+namespace CD::GPU {
+
+constexpr std::size_t max_open_batches = 64;
+
+template<typename CommandDesc>
+static const CommandDesc& command_cast(const std::uint8_t* command) {
+	return *static_cast<const CommandDesc*>(static_cast<const void*>(command));
+}
+
+static bool is_write_state(ResourceState state) {
+	return state == ResourceState::RTV || state == ResourceState::UAV || state == ResourceState::DepthWrite;
+}
+
+QueueScheduler::QueueScheduler() :
+	textures(),
+	batch_accesses(),
+	open_batches(),
+	queue_clocks(),
+	last_signals(),
+	statistics() {
+	for(std::size_t queue = 0; queue < CommandQueueType_Count; ++queue) {
+		last_signals[queue] = {static_cast<CommandQueueType>(queue), 0};
+	}
+}
+
+Signal QueueScheduler::submit(Device& device, const QueueSubmission* submissions, std::size_t num_submissions) {
+	CD_PROFILE_SCOPE("QueueScheduler::submit");
+
+	// Direct batches of previous submits are ordered before the direct work submitted now.
+	open_batches.erase(std::remove_if(open_batches.begin(), open_batches.end(), [](const OpenBatch& batch) {
+		return batch.queue == CommandQueueType_Direct;
+	}), open_batches.end());
+
+	std::size_t begin = 0;
+	while(begin < num_submissions) {
+		const CommandQueueType queue = submissions[begin].queue;
+
+		std::size_t end = begin + 1;
+		while(end < num_submissions && submissions[end].queue == queue) {
+			++end;
+		}
+
+		CD_ASSERT(end - begin <= max_submit_command_buffers);
+		const CommandBuffer* command_buffers[max_submit_command_buffers];
+		for(std::size_t i = begin; i < end; ++i) {
+			command_buffers[i - begin] = submissions[i].command_buffer;
+		}
+
+		std::uint64_t work = gather_accesses(submissions + begin, end - begin);
+		wait_dependencies(device, queue);
+
+		Signal signal = device.submit_commands(command_buffers, end - begin, queue);
+		last_signals[queue] = signal;
+		queue_clocks[queue][queue] = signal.value;
+
+		record_accesses(signal);
+		update_overlap(queue, signal, work);
+
+		++statistics.batches;
+		if(queue != CommandQueueType_Direct) {
+			++statistics.async_batches;
+			statistics.async_work += work;
+		}
+
+		begin = end;
+	}
+
+	return last_signals[CommandQueueType_Direct];
+}
+
+void QueueScheduler::reset() {
+	for(const OpenBatch& batch : open_batches) {
+		close_batch(batch);
+	}
+
+	open_batches.clear();
+	textures.clear();
+}
+
+std::uint64_t QueueScheduler::gather_accesses(const QueueSubmission* submissions, std::size_t num_submissions) {
+	batch_accesses.clear();
+
+	std::uint64_t work = 0;
+	for(std::size_t i = 0; i < num_submissions; ++i) {
+		const CommandBuffer& command_buffer = *submissions[i].command_buffer;
+
+		for(const std::uint8_t* command : command_buffer) {
+			switch(command_buffer.get_command_type(command)) {
+			case CommandType::Draw:
+			case CommandType::DrawIndexed:
+			case CommandType::DrawIndirect:
+			case CommandType::DrawIndexedIndirect:
+			case CommandType::Dispatch:
+			case CommandType::DispatchIndirect:
+			case CommandType::CopyBuffer:
+				++work;
+				break;
+			case CommandType::CopyBufferToTexture:
+				add_access(command_cast<CopyBufferToTextureDesc>(command).texture.texture, true);
+				++work;
+				break;
+			case CommandType::CopyTexture:
+				add_access(command_cast<CopyTextureDesc>(command).dst.texture, true);
+				add_access(command_cast<CopyTextureDesc>(command).src.texture, false);
+				++work;
+				break;
+			case CommandType::CopyTextureToBuffer:
+				add_access(command_cast<CopyTextureToBufferDesc>(command).texture.texture, false);
+				++work;
+				break;
+			case CommandType::UseTexture: {
+				const UseTextureDesc& use = command_cast<UseTextureDesc>(command);
+				add_access(use.texture.texture, is_write_state(use.state));
+				break;
+			}
+			case CommandType::LayoutBarrier:
+				add_access(command_cast<LayoutBarrierDesc>(command).texture.texture, true);
+				break;
+			case CommandType::ResourceBarrier: {
+				const ResourceBarrierDesc& barrier = command_cast<ResourceBarrierDesc>(command);
+				for(std::uint32_t j = 0; j < barrier.num_texture_barriers; ++j) {
+					add_access(barrier.textures[j], true);
+				}
+				break;
+			}
+			case CommandType::BeginRenderPass: {
+				const BeginRenderPassDesc& begin_render_pass = command_cast<BeginRenderPassDesc>(command);
+				for(std::uint32_t j = 0; j < begin_render_pass.render_target_count; ++j) {
+					add_access(begin_render_pass.color[j].texture, true);
+				}
+				add_access(begin_render_pass.depth_stencil_target.texture, begin_render_pass.depth_write);
+				break;
+			}
+			case CommandType::CopyToSwapChain:
+				add_access(command_cast<CopyToSwapChainDesc>(command).texture.texture, false);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	return work;
+}
+
+void QueueScheduler::add_access(TextureHandle texture, bool write) {
+	if(texture == TextureHandle::Invalid) {
+		return;
+	}
+
+	auto it = std::find_if(batch_accesses.begin(), batch_accesses.end(), [texture](const BatchAccess& access) { return access.texture == texture; });
+	if(it != batch_accesses.end()) {
+		it->write = it->write || write;
+	}
+	else {
+		batch_accesses.push_back({texture, write});
+	}
+}
+
+QueueScheduler::TextureAccess& QueueScheduler::get_texture_access(TextureHandle texture) {
+	auto it = std::find_if(textures.begin(), textures.end(), [texture](const TextureAccess& access) { return access.texture == texture; });
+	if(it != textures.end()) {
+		return *it;
+	}
+	return textures.emplace_back(TextureAccess {texture, {}, {}});
+}
+
+void QueueScheduler::wait_dependencies(Device& device, CommandQueueType queue) {
+	std::uint64_t dependencies[CommandQueueType_Count] {};
+	for(const BatchAccess& access : batch_accesses) {
+		const TextureAccess& texture = get_texture_access(access.texture);
+
+		for(std::size_t producer = 0; producer < CommandQueueType_Count; ++producer) {
+			if(producer != queue) {
+				std::uint64_t value = access.write ? texture.last_access[producer] : texture.last_write[producer];
+				dependencies[producer] = std::max(dependencies[producer], value);
+			}
+		}
+	}
+
+	for(std::size_t producer = 0; producer < CommandQueueType_Count; ++producer) {
+		if(dependencies[producer] > queue_clocks[queue][producer]) {
+			device.wait({static_cast<CommandQueueType>(producer), dependencies[producer]}, queue);
+			queue_clocks[queue][producer] = dependencies[producer];
+			++statistics.queue_waits;
+		}
+	}
+}
+
+void QueueScheduler::record_accesses(const Signal& signal) {
+	for(const BatchAccess& access : batch_accesses) {
+		TextureAccess& texture = get_texture_access(access.texture);
+
+		texture.last_access[signal.queue] = signal.value;
+		if(access.write) {
+			texture.last_write[signal.queue] = signal.value;
+		}
+	}
+}
+
+// A batch is concurrent with the open batches of other queues it is not ordered after. Compute and copy batches
+// stay open until a direct batch waits for them.
+void QueueScheduler::update_overlap(CommandQueueType queue, const Signal& signal, std::uint64_t work) {
+	OpenBatch batch {queue, signal.value, work, 0};
+
+	for(auto it = open_batches.begin(); it != open_batches.end();) {
+		if(it->queue != queue) {
+			if(queue_clocks[queue][it->queue] < it->value) {
+				it->concurrent_work += work;
+				batch.concurrent_work += it->work;
+			}
+			else if(queue == CommandQueueType_Direct) {
+				close_batch(*it);
+				it = open_batches.erase(it);
+				continue;
+			}
+		}
+		++it;
+	}
+
+	if(open_batches.size() == max_open_batches) {
+		close_batch(open_batches.front());
+		open_batches.erase(open_batches.begin());
+	}
+	open_batches.push_back(batch);
+}
+
+void QueueScheduler::close_batch(const OpenBatch& batch) {
+	if(batch.queue != CommandQueueType_Direct) {
+		statistics.overlapped_work += std::min(batch.work, batch.concurrent_work);
+	}
+}
+
+}
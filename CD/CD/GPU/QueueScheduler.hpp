@@ -0,0 +1,92 @@
+#pragma once
+
+#include <CD/GPU/CommandBuffer.hpp>
+#include <CD/GPU/Device.hpp>
+#include <vector>
+
+namespace CD::GPU {
+
+struct QueueSubmission {
+	const CommandBuffer* command_buffer;
+	CommandQueueType queue;
+};
+
+// Work counts draws, dispatches and copies. Overlapped work is the part of the work submitted to the compute and
+// copy queues that had work of another queue submitted without an ordering between them.
+struct QueueSchedulerStatistics {
+	std::uint64_t batches;
+	std::uint64_t async_batches;
+	std::uint64_t queue_waits;
+	std::uint64_t async_work;
+	std::uint64_t overlapped_work;
+};
+
+// Submits command buffers recorded for several queues in order. Consecutive buffers of a queue are submitted
+// together, a batch waits for the last batch of another queue writing a texture it accesses, or accessing a texture
+// it writes. Textures shared between queues must be declared with UseTexture or named by the commands accessing
+// them. Accesses are kept across submits, work the direct queue does not depend on can overlap the next frame.
+class QueueScheduler {
+public:
+	QueueScheduler();
+
+	QueueScheduler(const QueueScheduler&) = delete;
+	QueueScheduler& operator=(const QueueScheduler&) = delete;
+
+	Signal submit(Device&, const QueueSubmission* submissions, std::size_t num_submissions);
+	void reset();
+
+	const Signal& get_last_signal(CommandQueueType) const;
+
+	const QueueSchedulerStatistics& get_statistics() const;
+	void reset_statistics();
+private:
+	struct TextureAccess {
+		TextureHandle texture;
+		std::uint64_t last_access[CommandQueueType_Count];
+		std::uint64_t last_write[CommandQueueType_Count];
+	};
+
+	struct BatchAccess {
+		TextureHandle texture;
+		bool write;
+	};
+
+	struct OpenBatch {
+		CommandQueueType queue;
+		std::uint64_t value;
+		std::uint64_t work;
+		std::uint64_t concurrent_work;
+	};
+
+	std::vector<TextureAccess> textures;
+	std::vector<BatchAccess> batch_accesses;
+	std::vector<OpenBatch> open_batches;
+
+	// Last value of each queue the other queues waited for.
+	std::uint64_t queue_clocks[CommandQueueType_Count][CommandQueueType_Count];
+	Signal last_signals[CommandQueueType_Count];
+
+	QueueSchedulerStatistics statistics;
+
+	std::uint64_t gather_accesses(const QueueSubmission* submissions, std::size_t num_submissions);
+	void add_access(TextureHandle, bool write);
+	TextureAccess& get_texture_access(TextureHandle);
+	void wait_dependencies(Device&, CommandQueueType);
+	void record_accesses(const Signal&);
+	void update_overlap(CommandQueueType, const Signal&, std::uint64_t work);
+	void close_batch(const OpenBatch&);
+};
+
+inline const Signal& QueueScheduler::get_last_signal(CommandQueueType queue) const {
+	return last_signals[queue];
+}
+
+inline const QueueSchedulerStatistics& QueueScheduler::get_statistics() const {
+	return statistics;
+}
+
+inline void QueueScheduler::reset_statistics() {
+	statistics = {};
+}
+
+}
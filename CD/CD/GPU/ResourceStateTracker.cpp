@@ -0,0 +1,293 @@
+#include <CD/GPU/ResourceStateTracker.hpp>
+#include <algorithm>
+
+namespace CD::GPU {
+
+constexpr std::uint32_t no_command = ~0u;
+
+template<typename CommandDesc>
+static const CommandDesc& command_cast(const std::uint8_t* command) {
+	return *static_cast<const CommandDesc*>(static_cast<const void*>(command));
+}
+
+void TextureStates::set(std::uint32_t subresource, std::uint32_t new_state, std::uint32_t num_subresources) {
+	if(subresource == all_subresources) {
+		state = new_state;
+		subresources.clear();
+		return;
+	}
+
+	if(subresources.empty()) {
+		subresources.assign(num_subresources, state);
+	}
+	subresources[subresource] = new_state;
+
+	if(std::all_of(subresources.begin(), subresources.end(), [new_state](std::uint32_t s) { return s == new_state; })) {
+		state = new_state;
+		subresources.clear();
+	}
+}
+
+ResourceStateTracker::ResourceStateTracker(std::uint32_t read_only_states) :
+	read_only_states(read_only_states) {
+}
+
+void ResourceStateTracker::reset() {
+	textures.clear();
+	subresources.clear();
+	split_transitions.clear();
+}
+
+// Splits are planned for textures declared for all their subresources. The transition begins once the scope
+// holding the previous declaration has ended, if GPU work is recorded before the next declaration and nothing
+// else references the texture in between.
+void ResourceStateTracker::plan(const CommandBuffer& command_buffer) {
+	split_transitions.clear();
+	declarations.clear();
+	open_scopes.clear();
+
+	std::uint32_t command_index = 0;
+	std::uint32_t next_scope = 1;
+	std::uint64_t work = 0;
+
+	auto block = [this](TextureHandle texture) {
+		Declaration& declaration = get_declaration(texture);
+		declaration.scope = 0;
+		declaration.end_command = no_command;
+	};
+
+	for(const std::uint8_t* command : command_buffer) {
+		switch(command_buffer.get_command_type(command)) {
+		case CommandType::Draw:
+		case CommandType::DrawIndexed:
+		case CommandType::DrawIndirect:
+		case CommandType::DrawIndexedIndirect:
+		case CommandType::Dispatch:
+		case CommandType::DispatchIndirect:
+		case CommandType::CopyBuffer:
+			++work;
+			break;
+		case CommandType::CopyBufferToTexture:
+			block(command_cast<CopyBufferToTextureDesc>(command).texture.texture);
+			++work;
+			break;
+		case CommandType::CopyTexture:
+			block(command_cast<CopyTextureDesc>(command).dst.texture);
+			block(command_cast<CopyTextureDesc>(command).src.texture);
+			++work;
+			break;
+		case CommandType::CopyTextureToBuffer:
+			block(command_cast<CopyTextureToBufferDesc>(command).texture.texture);
+			++work;
+			break;
+		case CommandType::BeginScope:
+		case CommandType::BeginRenderPass:
+			open_scopes.push_back(next_scope++);
+			break;
+		case CommandType::EndScope:
+		case CommandType::EndRenderPass:
+			if(!open_scopes.empty()) {
+				const std::uint32_t scope = open_scopes.back();
+				open_scopes.pop_back();
+
+				for(Declaration& declaration : declarations) {
+					if(declaration.scope == scope) {
+						declaration.scope = 0;
+						declaration.end_command = command_index;
+						declaration.end_work = work;
+					}
+				}
+			}
+			break;
+		case CommandType::UseTexture: {
+			const UseTextureDesc& use = command_cast<UseTextureDesc>(command);
+			Declaration& declaration = get_declaration(use.texture.texture);
+
+			if(use.all_subresources && declaration.end_command != no_command && work - declaration.end_work >= split_transition_min_work) {
+				split_transitions.push_back({use.texture.texture, declaration.end_command, command_index, use.state});
+			}
+
+			declaration.scope = use.all_subresources && !open_scopes.empty() ? open_scopes.back() : 0;
+			declaration.end_command = no_command;
+			break;
+		}
+		case CommandType::LayoutBarrier:
+			block(command_cast<LayoutBarrierDesc>(command).texture.texture);
+			break;
+		case CommandType::ResourceBarrier: {
+			const ResourceBarrierDesc& barrier = command_cast<ResourceBarrierDesc>(command);
+			for(std::uint32_t i = 0; i < barrier.num_texture_barriers; ++i) {
+				block(barrier.textures[i]);
+			}
+			break;
+		}
+		case CommandType::CopyToSwapChain:
+			block(command_cast<CopyToSwapChainDesc>(command).texture.texture);
+			break;
+		default:
+			break;
+		}
+
+		++command_index;
+	}
+
+	std::sort(split_transitions.begin(), split_transitions.end(), [](const SplitTransition& l, const SplitTransition& r) {
+		return l.begin_command < r.begin_command;
+	});
+}
+
+void ResourceStateTracker::use(TextureHandle texture, std::uint32_t num_subresources, std::uint32_t subresource, std::uint32_t state, bool merge_read_states, std::vector<StateTransition>& transitions) {
+	TrackedTexture& tracked = get_tracked_texture(texture, num_subresources);
+
+	if(tracked.split_pending) {
+		transitions.push_back({texture, all_subresources, tracked.split_before, tracked.split_after, TransitionSplit::End});
+		tracked.split_pending = false;
+	}
+
+	if(subresource != all_subresources) {
+		use_subresource(tracked, subresource, state, merge_read_states, transitions);
+		return;
+	}
+
+	SubresourceState* states = &subresources[tracked.first_subresource];
+
+	bool uniform = true;
+	for(std::uint32_t i = 1; i < tracked.num_subresources && uniform; ++i) {
+		uniform = states[i].used == states[0].used && states[i].current == states[0].current;
+	}
+
+	if(!uniform) {
+		for(std::uint32_t i = 0; i < tracked.num_subresources; ++i) {
+			use_subresource(tracked, i, state, merge_read_states, transitions);
+		}
+		return;
+	}
+
+	if(!states[0].used) {
+		for(std::uint32_t i = 0; i < tracked.num_subresources; ++i) {
+			states[i] = {state, state, true, false};
+		}
+		return;
+	}
+
+	const std::uint32_t target = merge_read_states ? merge_state(states[0].current, state) : state;
+	if(target != states[0].current) {
+		transitions.push_back({texture, all_subresources, states[0].current, target, TransitionSplit::None});
+		for(std::uint32_t i = 0; i < tracked.num_subresources; ++i) {
+			states[i].current = target;
+			states[i].transitioned = true;
+		}
+	}
+}
+
+void ResourceStateTracker::begin_split(const SplitTransition& split, std::uint32_t state, std::vector<StateTransition>& transitions) {
+	auto it = std::find_if(textures.begin(), textures.end(), [&split](const TrackedTexture& tracked) { return tracked.texture == split.texture; });
+	if(it == textures.end() || it->split_pending) {
+		return;
+	}
+
+	TrackedTexture& tracked = *it;
+	SubresourceState* states = &subresources[tracked.first_subresource];
+	for(std::uint32_t i = 0; i < tracked.num_subresources; ++i) {
+		if(!states[i].used || states[i].current != states[0].current) {
+			return;
+		}
+	}
+
+	const std::uint32_t target = merge_state(states[0].current, state);
+	if(target == states[0].current) {
+		return;
+	}
+
+	transitions.push_back({tracked.texture, all_subresources, states[0].current, target, TransitionSplit::Begin});
+	tracked.split_pending = true;
+	tracked.split_before = states[0].current;
+	tracked.split_after = target;
+
+	for(std::uint32_t i = 0; i < tracked.num_subresources; ++i) {
+		states[i].current = target;
+		states[i].transitioned = true;
+	}
+}
+
+void ResourceStateTracker::resolve(TextureHandle texture, TextureStates& global, std::vector<StateTransition>& transitions) const {
+	const TrackedTexture* tracked = find_tracked_texture(texture);
+	CD_ASSERT(tracked && !tracked->split_pending);
+
+	const SubresourceState* states = &subresources[tracked->first_subresource];
+	const std::uint32_t num_subresources = tracked->num_subresources;
+
+	auto resolve_state = [&](std::uint32_t subresource, const SubresourceState& state) {
+		const std::uint32_t before = global.get(subresource == all_subresources ? 0 : subresource);
+
+		// A list only reading the texture accepts a combined read state containing the one it expects.
+		if(!state.transitioned && is_read_only(before) && is_read_only(state.initial) && (before & state.initial) == state.initial) {
+			return;
+		}
+
+		if(before != state.initial) {
+			transitions.push_back({texture, subresource, before, state.initial, TransitionSplit::None});
+		}
+		global.set(subresource, state.current, num_subresources);
+	};
+
+	bool uniform = global.subresources.empty();
+	for(std::uint32_t i = 0; i < num_subresources && uniform; ++i) {
+		uniform = states[i].used && states[i].initial == states[0].initial && states[i].current == states[0].current && states[i].transitioned == states[0].transitioned;
+	}
+
+	if(uniform) {
+		resolve_state(all_subresources, states[0]);
+		return;
+	}
+
+	for(std::uint32_t i = 0; i < num_subresources; ++i) {
+		if(states[i].used) {
+			resolve_state(i, states[i]);
+		}
+	}
+}
+
+ResourceStateTracker::TrackedTexture& ResourceStateTracker::get_tracked_texture(TextureHandle texture, std::uint32_t num_subresources) {
+	auto it = std::find_if(textures.begin(), textures.end(), [texture](const TrackedTexture& tracked) { return tracked.texture == texture; });
+	if(it != textures.end()) {
+		CD_ASSERT(it->num_subresources == num_subresources);
+		return *it;
+	}
+
+	const std::uint32_t first_subresource = static_cast<std::uint32_t>(subresources.size());
+	subresources.resize(subresources.size() + num_subresources, SubresourceState {});
+	return textures.emplace_back(TrackedTexture {texture, num_subresources, first_subresource, false, 0, 0});
+}
+
+const ResourceStateTracker::TrackedTexture* ResourceStateTracker::find_tracked_texture(TextureHandle texture) const {
+	auto it = std::find_if(textures.begin(), textures.end(), [texture](const TrackedTexture& tracked) { return tracked.texture == texture; });
+	return it != textures.end() ? &*it : nullptr;
+}
+
+ResourceStateTracker::Declaration& ResourceStateTracker::get_declaration(TextureHandle texture) {
+	auto it = std::find_if(declarations.begin(), declarations.end(), [texture](const Declaration& declaration) { return declaration.texture == texture; });
+	if(it != declarations.end()) {
+		return *it;
+	}
+	return declarations.emplace_back(Declaration {texture, 0, no_command, 0});
+}
+
+void ResourceStateTracker::use_subresource(const TrackedTexture& tracked, std::uint32_t subresource, std::uint32_t state, bool merge_read_states, std::vector<StateTransition>& transitions) {
+	CD_ASSERT(subresource < tracked.num_subresources);
+	SubresourceState& current = subresources[tracked.first_subresource + subresource];
+
+	if(!current.used) {
+		current = {state, state, true, false};
+		return;
+	}
+
+	const std::uint32_t target = merge_read_states ? merge_state(current.current, state) : state;
+	if(target != current.current) {
+		transitions.push_back({tracked.texture, subresource, current.current, target, TransitionSplit::None});
+		current.current = target;
+		current.transitioned = true;
+	}
+}
+
+}
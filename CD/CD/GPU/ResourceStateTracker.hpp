@@ -0,0 +1,124 @@
+#pragma once
+
+#include <CD/GPU/CommandBuffer.hpp>
+#include <vector>
+
+namespace CD::GPU {
+
+constexpr std::uint32_t all_subresources = ~0u;
+constexpr std::uint32_t split_transition_min_work = 1;
+
+// States are backend specific bit masks, read only states can be combined into a single state.
+struct TextureStates {
+	std::uint32_t state;
+	std::vector<std::uint32_t> subresources;
+
+	std::uint32_t get(std::uint32_t subresource) const;
+	void set(std::uint32_t subresource, std::uint32_t state, std::uint32_t num_subresources);
+};
+
+enum class TransitionSplit : std::uint8_t {
+	None,
+	Begin,
+	End
+};
+
+struct StateTransition {
+	TextureHandle texture;
+	std::uint32_t subresource;
+	std::uint32_t before;
+	std::uint32_t after;
+	TransitionSplit split;
+};
+
+// Transition to the state declared by the UseTexture command at end_command, begun after begin_command.
+struct SplitTransition {
+	TextureHandle texture;
+	std::uint32_t begin_command;
+	std::uint32_t end_command;
+	ResourceState state;
+};
+
+// Tracks the textures used by one command list. The first use of a subresource records the state the list
+// expects it in instead of a transition, resolve then transitions from the state left by the lists submitted
+// before and stores the state this list leaves the texture in.
+class ResourceStateTracker {
+public:
+	ResourceStateTracker(std::uint32_t read_only_states);
+
+	void reset();
+	void plan(const CommandBuffer&);
+
+	void use(TextureHandle, std::uint32_t num_subresources, std::uint32_t subresource, std::uint32_t state, bool merge_read_states, std::vector<StateTransition>&);
+	void begin_split(const SplitTransition&, std::uint32_t state, std::vector<StateTransition>&);
+	void resolve(TextureHandle, TextureStates&, std::vector<StateTransition>&) const;
+
+	const std::vector<SplitTransition>& get_split_transitions() const;
+	std::size_t get_texture_count() const;
+	TextureHandle get_texture(std::size_t index) const;
+private:
+	struct TrackedTexture {
+		TextureHandle texture;
+		std::uint32_t num_subresources;
+		std::uint32_t first_subresource;
+		bool split_pending;
+		std::uint32_t split_before;
+		std::uint32_t split_after;
+	};
+
+	struct SubresourceState {
+		std::uint32_t initial;
+		std::uint32_t current;
+		bool used;
+		bool transitioned;
+	};
+
+	struct Declaration {
+		TextureHandle texture;
+		std::uint32_t scope;
+		std::uint32_t end_command;
+		std::uint64_t end_work;
+	};
+
+	std::uint32_t read_only_states;
+
+	std::vector<TrackedTexture> textures;
+	std::vector<SubresourceState> subresources;
+
+	std::vector<SplitTransition> split_transitions;
+	std::vector<Declaration> declarations;
+	std::vector<std::uint32_t> open_scopes;
+
+	TrackedTexture& get_tracked_texture(TextureHandle, std::uint32_t num_subresources);
+	const TrackedTexture* find_tracked_texture(TextureHandle) const;
+	Declaration& get_declaration(TextureHandle);
+	void use_subresource(const TrackedTexture&, std::uint32_t subresource, std::uint32_t state, bool merge_read_states, std::vector<StateTransition>&);
+	bool is_read_only(std::uint32_t state) const;
+	std::uint32_t merge_state(std::uint32_t current, std::uint32_t requested) const;
+};
+
+inline std::uint32_t TextureStates::get(std::uint32_t subresource) const {
+	return subresources.empty() ? state : subresources[subresource];
+}
+
+inline const std::vector<SplitTransition>& ResourceStateTracker::get_split_transitions() const {
+	return split_transitions;
+}
+
+inline std::size_t ResourceStateTracker::get_texture_count() const {
+	return textures.size();
+}
+
+inline TextureHandle ResourceStateTracker::get_texture(std::size_t index) const {
+	return textures[index].texture;
+}
+
+inline bool ResourceStateTracker::is_read_only(std::uint32_t state) const {
+	return state && !(state & ~read_only_states);
+}
+
+inline std::uint32_t ResourceStateTracker::merge_state(std::uint32_t current, std::uint32_t requested) const {
+	return is_read_only(current) && is_read_only(requested) ? current | requested : requested;
+}
+
+}
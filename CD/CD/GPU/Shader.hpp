@@ -2,11 +2,11 @@
 
 #include <CD/GPU/Common.hpp>
 #include <memory>
-#include <wrl/client.h>
-#include <dxc/Support/dxcapi.use.h>
 
 namespace CD::GPU {
 
+constexpr std::size_t max_shader_defines = 16;
+
 enum class ShaderStage {
 	Compute,
 	Vertex,
@@ -21,27 +21,21 @@ struct CompileShaderDesc {
 	std::size_t num_defines;
 };
 
-struct ShaderDeleter {
-	void operator()(IDxcBlob* shader) {
-		if(shader) {
-			shader->Release();
-		}
-	}
+struct ShaderBlob {
+	std::unique_ptr<std::uint8_t[]> bytecode;
+	std::size_t size;
 };
 
-using ShaderPtr = std::unique_ptr<IDxcBlob, ShaderDeleter>;
+using ShaderPtr = std::unique_ptr<ShaderBlob>;
 
 class ShaderCompiler {
 public:
-	ShaderCompiler();
-	~ShaderCompiler();
-
-	ShaderPtr compile_shader(const CompileShaderDesc&);
-private:
-	dxc::DxcDllSupport dll_helper;
-	IDxcUtils* utils;
-	IDxcCompiler3* compiler;
-	IDxcIncludeHandler* include_handler;
+	ShaderCompiler() = default;
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+	virtual ~ShaderCompiler() = default;
+
+	virtual ShaderPtr compile_shader(const CompileShaderDesc&) = 0;
 };
 
-}
\ No newline at end of file
+}
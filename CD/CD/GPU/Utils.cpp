@@ -1,6 +1,4 @@
 #include <CD/GPU/Utils.hpp>
-#include <CD/GPU/D3D12/Common.hpp>
-#include <DirectXTex/DirectXTex.h>
 
 namespace CD::GPU {
 
@@ -22,8 +20,121 @@ bool is_depth_stencil_format(BufferFormat format) {
 		format == BufferFormat::D32_FLOAT_S8X24_UINT;
 }
 
+std::uint32_t bits_per_pixel(BufferFormat format) {
+	switch(format) {
+	case BufferFormat::R32G32B32A32_Typeless:
+	case BufferFormat::R32G32B32A32_FLOAT:
+	case BufferFormat::R32G32B32A32_UINT:
+	case BufferFormat::R32G32B32A32_SINT:
+		return 128;
+	case BufferFormat::R32G32B32_Typeless:
+	case BufferFormat::R32G32B32_FLOAT:
+	case BufferFormat::R32G32B32_UINT:
+	case BufferFormat::R32G32B32_SINT:
+		return 96;
+	case BufferFormat::R16G16B16A16_Typeless:
+	case BufferFormat::R16G16B16A16_FLOAT:
+	case BufferFormat::R16G16B16A16_UNORM:
+	case BufferFormat::R16G16B16A16_UINT:
+	case BufferFormat::R16G16B16A16_SNORM:
+	case BufferFormat::R16G16B16A16_SINT:
+	case BufferFormat::R32G32_Typeless:
+	case BufferFormat::R32G32_FLOAT:
+	case BufferFormat::R32G32_UINT:
+	case BufferFormat::R32G32_SINT:
+	case BufferFormat::R32G8X24_Typeless:
+	case BufferFormat::D32_FLOAT_S8X24_UINT:
+	case BufferFormat::R32_FLOAT_X8X24_Typeless:
+	case BufferFormat::X32_Typeless_G8X24_UINT:
+		return 64;
+	case BufferFormat::R10G10B10A2_Typeless:
+	case BufferFormat::R10G10B10A2_UNORM:
+	case BufferFormat::R10G10B10A2_UINT:
+	case BufferFormat::R11G11B10_FLOAT:
+	case BufferFormat::R8G8B8A8_Typeless:
+	case BufferFormat::R8G8B8A8_UNORM:
+	case BufferFormat::R8G8B8A8_UNORM_SRGB:
+	case BufferFormat::R8G8B8A8_UINT:
+	case BufferFormat::R8G8B8A8_SNORM:
+	case BufferFormat::R8G8B8A8_SINT:
+	case BufferFormat::R16G16_Typeless:
+	case BufferFormat::R16G16_FLOAT:
+	case BufferFormat::R16G16_UNORM:
+	case BufferFormat::R16G16_UINT:
+	case BufferFormat::R16G16_SNORM:
+	case BufferFormat::R16G16_SINT:
+	case BufferFormat::R32_Typeless:
+	case BufferFormat::D32_FLOAT:
+	case BufferFormat::R32_FLOAT:
+	case BufferFormat::R32_UINT:
+	case BufferFormat::R32_SINT:
+	case BufferFormat::R24G8_Typeless:
+	case BufferFormat::D24_UNORM_S8_UINT:
+	case BufferFormat::R24_UNORM_X8_Typeless:
+	case BufferFormat::X24_Typeless_G8_UINT:
+	case BufferFormat::R8G8_B8G8_UNORM:
+	case BufferFormat::G8R8_G8B8_UNORM:
+	case BufferFormat::B8G8R8A8_UNORM:
+	case BufferFormat::B8G8R8X8_UNORM:
+	case BufferFormat::B8G8R8A8_Typeless:
+	case BufferFormat::B8G8R8A8_UNORM_SRGB:
+	case BufferFormat::B8G8R8X8_Typeless:
+	case BufferFormat::B8G8R8X8_UNORM_SRGB:
+		return 32;
+	case BufferFormat::R8G8_Typeless:
+	case BufferFormat::R8G8_UNORM:
+	case BufferFormat::R8G8_UINT:
+	case BufferFormat::R8G8_SNORM:
+	case BufferFormat::R8G8_SINT:
+	case BufferFormat::R16_Typeless:
+	case BufferFormat::R16_FLOAT:
+	case BufferFormat::D16_UNORM:
+	case BufferFormat::R16_UNORM:
+	case BufferFormat::R16_UINT:
+	case BufferFormat::R16_SNORM:
+	case BufferFormat::R16_SINT:
+	case BufferFormat::B5G6R5_UNORM:
+	case BufferFormat::B5G5R5A1_UNORM:
+	case BufferFormat::B4G4R4A4_UNORM:
+		return 16;
+	case BufferFormat::R8_Typeless:
+	case BufferFormat::R8_UNORM:
+	case BufferFormat::R8_UINT:
+	case BufferFormat::R8_SNORM:
+	case BufferFormat::R8_SINT:
+	case BufferFormat::A8_UNORM:
+	case BufferFormat::BC2_Typeless:
+	case BufferFormat::BC2_UNORM:
+	case BufferFormat::BC2_UNORM_SRGB:
+	case BufferFormat::BC3_Typeless:
+	case BufferFormat::BC3_UNORM:
+	case BufferFormat::BC3_UNORM_SRGB:
+	case BufferFormat::BC5_Typeless:
+	case BufferFormat::BC5_UNORM:
+	case BufferFormat::BC5_SNORM:
+	case BufferFormat::BC6H_Typeless:
+	case BufferFormat::BC6H_UF16:
+	case BufferFormat::BC6H_SF16:
+	case BufferFormat::BC7_Typeless:
+	case BufferFormat::BC7_UNORM:
+	case BufferFormat::BC7_UNORM_SRGB:
+		return 8;
+	case BufferFormat::BC1_Typeless:
+	case BufferFormat::BC1_UNORM:
+	case BufferFormat::BC1_UNORM_SRGB:
+	case BufferFormat::BC4_Typeless:
+	case BufferFormat::BC4_UNORM:
+	case BufferFormat::BC4_SNORM:
+		return 4;
+	case BufferFormat::R1_UNORM:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 std::uint32_t row_size(std::uint32_t size, BufferFormat format) {
-	return static_cast<std::uint32_t>((size * DirectX::BitsPerPixel(D3D12::dxgi_format(format)) + 7) / 8);
+	return (size * bits_per_pixel(format) + 7) / 8;
 }
 
 }
\ No newline at end of file
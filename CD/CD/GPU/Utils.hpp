@@ -64,6 +64,13 @@ constexpr PipelineInputGroup pipeline_input_list_defaults(const ResourceListDesc
 	return list;
 }
 
+constexpr PipelineInputGroup pipeline_input_constants_defaults(std::uint32_t num_constants, std::uint32_t slot, std::uint32_t space) {
+	PipelineInputGroup constants {};
+	constants.type = PipelineInputGroupType::Constants;
+	constants.constants = {slot, space, num_constants};
+	return constants;
+}
+
 constexpr DepthStencilTargetDesc depth_stencil_defaults(bool depth_enable = false, bool stencil_enable = false) {
 	return {
 		depth_enable,
@@ -123,10 +130,47 @@ constexpr TextureView texture_view_defaults(TextureHandle texture, const Texture
 	};
 }
 
+constexpr bool operator==(const PipelineInputBuffer& l, const PipelineInputBuffer& r) {
+	return l.buffer == r.buffer &&
+		l.offset == r.offset &&
+		l.type == r.type;
+}
+
+constexpr bool operator==(const PipelineHandle& l, const PipelineHandle& r) {
+	return l.handle == r.handle &&
+		l.type == r.type;
+}
+
+constexpr bool operator==(const PipelineInputConstants& l, const PipelineInputConstants& r) {
+	if(l.num_values != r.num_values) {
+		return false;
+	}
+	for(std::uint32_t i = 0; i < l.num_values; ++i) {
+		if(l.values[i] != r.values[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+constexpr bool same_input_element(PipelineInputGroupType type, const PipelineInputElement& l, const PipelineInputElement& r) {
+	switch(type) {
+	case PipelineInputGroupType::ResourceList:
+		return l.resource_list == r.resource_list;
+	case PipelineInputGroupType::Buffer:
+		return l.buffer == r.buffer;
+	case PipelineInputGroupType::Constants:
+		return l.constants == r.constants;
+	}
+
+	return false;
+}
+
 BufferFormat typed_depth_format(BufferFormat);
 
 bool is_depth_stencil_format(BufferFormat);
 
+std::uint32_t bits_per_pixel(BufferFormat);
 std::uint32_t row_size(std::uint32_t size, BufferFormat);
 
 }
\ No newline at end of file
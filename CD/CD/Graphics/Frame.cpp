@@ -1,9 +1,11 @@
 #include <CD/Graphics/Frame.hpp>
+#include <CD/Common/AllocationTracker.hpp>
 
 namespace CD {
 
-GPUBufferAllocator::GPUBufferAllocator(GPU::Device& device) :
+GPUBufferAllocator::GPUBufferAllocator(GPU::Device& device, GPU::CommandPagePool& command_pages) :
 	device(device),
+	command_buffer(command_pages),
 	frame(),
 	frame_fence(),
 	copy_fence() {
@@ -112,8 +114,53 @@ const GPU::Signal& GPUBufferAllocator::get_copy_fence() const {
 	return copy_fence;
 }
 
-CopyContext::CopyContext(GPU::Device& device) :
+FrameDataBuffer::FrameDataBuffer(GPU::Device& device, std::uint32_t num_frames) :
 	device(device),
+	slots(num_frames, {GPU::BufferHandle::Invalid, nullptr, 0}),
+	generation() {
+}
+
+FrameDataBuffer::~FrameDataBuffer() {
+	for(const FrameSlot& slot : slots) {
+		if(slot.handle != GPU::BufferHandle::Invalid) {
+			device.unmap_buffer(slot.handle, 0, slot.size);
+			device.destroy_buffer(slot.handle);
+		}
+	}
+}
+
+BufferAllocation FrameDataBuffer::write(std::uint32_t frame_index, const void* data, std::uint32_t num_bytes) {
+	CD_ASSERT(frame_index < slots.size());
+	FrameSlot& slot = slots[frame_index];
+
+	if(num_bytes > slot.size) {
+		if(slot.handle != GPU::BufferHandle::Invalid) {
+			device.unmap_buffer(slot.handle, 0, slot.size);
+			device.destroy_buffer(slot.handle);
+		}
+
+		slot.size = static_cast<std::uint32_t>(align(std::max(num_bytes, 2 * slot.size), buffer_alignment));
+
+		GPU::BufferDesc desc {
+			slot.size,
+			GPU::BufferStorage::Upload,
+			GPU::BindFlags_ShaderResource
+		};
+		slot.handle = device.create_buffer(desc);
+		device.map_buffer(slot.handle, &slot.mapped_memory, 0, slot.size);
+		++generation;
+	}
+
+	if(data) {
+		std::memcpy(slot.mapped_memory, data, num_bytes);
+	}
+
+	return {slot.handle, 0};
+}
+
+CopyContext::CopyContext(GPU::Device& device, GPU::CommandPagePool& command_pages) :
+	device(device),
+	command_buffer(command_pages),
 	curr_offset(),
 	copy_fence(),
 	completed() {
@@ -169,6 +216,8 @@ void CopyContext::upload_buffer(const GPU::BufferView& buffer, const void* data)
 }
 
 void CopyContext::flush() {
+	CD_MEMORY_TAG(MemoryTag_Upload);
+
 	copy_fence = device.submit_commands(command_buffer, GPU::CommandQueueType_Copy);
 	device.wait_for_fence(copy_fence);
 	command_buffer.reset();
@@ -179,6 +228,8 @@ void CopyContext::flush() {
 }
 
 CopyContext::CopyBufferAllocation CopyContext::reserve(std::uint64_t num_bytes, std::uint64_t alignment) {
+	CD_MEMORY_TAG(MemoryTag_Upload);
+
 	for(auto it = free_list.begin(); it != free_list.end(); ++it) {
 		if(num_bytes <= it->size && it->offset % alignment == 0) {
 			CopyBufferAllocation& ret = cache.emplace_back(*it);
@@ -201,17 +252,35 @@ CopyContext::CopyBufferAllocation CopyContext::reserve(std::uint64_t num_bytes,
 
 Frame::Frame(GPU::Device& device, float width, float height) :
 	device(device),
+	command_pages(),
+	command_segments(),
+	current_segment(0),
+	command_optimizer(),
+	optimize_commands(false),
+	queue_scheduler(),
+	async_compute(true),
 	viewport(),
 	present_fences(),
+	async_fences(),
 	completed_fence(),
 	present_index(),
-	buffer_allocator(device),
-	copy_context(device) {
+	fence_wait_ns(),
+	copy_wait_ns(),
+	pacing_wait_ns(),
+	frame_limiter(),
+	submit_statistics(),
+	buffer_allocator(device, command_pages),
+	copy_context(device, command_pages),
+	frame_allocator(max_latency),
+	gpu_profiler(device, max_latency),
+	texture_generation() {
 
 	viewport.width = width;
 	viewport.height = height;
 	viewport.min_z = 0;
 	viewport.max_z = 1.f;
+
+	add_command_segment();
 }
 
 Frame::~Frame() {
@@ -234,7 +303,6 @@ FrameResourceIndex Frame::add_texture(GPU::TextureDesc& desc, bool create_views_
 	auto& texture = texture_pool.emplace_back(std::make_unique<FrameTexture>());
 	texture->texture.handle = GPU::TextureHandle::Invalid;
 	texture->texture.desc = desc;
-	texture->state = GPU::ResourceState::Common;
 
 	if(create_views_flag) {
 		texture->views = views.emplace_back(std::make_unique<FrameTextureViews>()).get();
@@ -287,59 +355,147 @@ const ComputePipeline* Frame::create_pipeline(const GPU::ComputePipelineDesc& de
 	return pipeline.get();
 }
 
+// Declares the state the following commands use the textures in, the backend places the transitions.
 void Frame::bind_resources(const FrameResourceIndex* textures, std::size_t num_textures, GPU::ResourceState target_state) {
 	for(std::uint32_t i = 0; i < num_textures; ++i) {
 		auto& texture = get_texture(textures[i]);
 
-		if(texture.state != target_state) {
-			GPU::LayoutBarrierDesc barrier {};
-			barrier.texture = GPU::texture_view_defaults(texture.texture.handle, texture.texture.desc);
-			barrier.all_subresources = true;
-			barrier.before = texture.state;
-			barrier.after = target_state;
+		GPU::UseTextureDesc use {};
+		use.texture = GPU::texture_view_defaults(texture.texture.handle, texture.texture.desc);
+		use.state = target_state;
+		use.all_subresources = true;
 
-			command_buffer.add_command(barrier);
+		get_command_buffer().add_command(use);
+	}
+}
 
-			texture.state = target_state;
-		}
+void Frame::execute_retained(const GPU::CommandBuffer& retained) {
+	CD_ASSERT(retained.is_retained());
+
+	command_segments[current_segment].retained = &retained;
+	next_command_segment(command_segments[current_segment].queue);
+}
+
+// Passes between begin_async_compute and end_async_compute only record compute work, their segments are submitted
+// to the compute queue and the queue scheduler places the waits on the direct queue.
+void Frame::begin_async_compute() {
+	if(async_compute) {
+		set_command_queue(GPU::CommandQueueType_Compute);
 	}
 }
 
+void Frame::end_async_compute() {
+	set_command_queue(GPU::CommandQueueType_Direct);
+}
+
+GPURange Frame::begin_gpu_range(const char* name, bool pipeline_statistics) {
+	return gpu_profiler.begin_range(get_command_buffer(), command_segments[current_segment].queue, name, pipeline_statistics);
+}
+
+GPURange Frame::begin_retained_gpu_range(const char* name) {
+	return gpu_profiler.begin_retained_range(get_command_buffer(), command_segments[current_segment].queue, name);
+}
+
+void Frame::end_gpu_range(const GPURange& range) {
+	CD_ASSERT(range.queue == command_segments[current_segment].queue);
+	gpu_profiler.end_range(get_command_buffer(), range);
+}
+
 void Frame::begin() {
+	fence_wait_ns = 0;
 	if(const GPU::Signal& present = present_fences[(present_index + 1) % max_latency]; completed_fence.value + max_latency < present.value) {
+		std::uint64_t wait_begin = Clock::timestamp_ns();
 		device.wait_for_fence(present);
+		fence_wait_ns = Clock::timestamp_ns() - wait_begin;
 		completed_fence = present;
 	}
 
+	if(GPU::Signal& async = async_fences[(present_index + 1) % max_latency]; async.value) {
+		std::uint64_t wait_begin = Clock::timestamp_ns();
+		device.wait_for_fence(async);
+		fence_wait_ns += Clock::timestamp_ns() - wait_begin;
+		async.value = 0;
+	}
+
+	// Frame data buffers write the slot of this frame, the frame that used it last must have completed.
+	if(const GPU::Signal& previous = present_fences[present_index]; completed_fence.value < previous.value) {
+		std::uint64_t wait_begin = Clock::timestamp_ns();
+		device.wait_for_fence(previous);
+		fence_wait_ns += Clock::timestamp_ns() - wait_begin;
+		completed_fence = previous;
+	}
+
 	buffer_allocator.reset(completed_fence);
+	gpu_profiler.begin_frame(present_index);
 }
 
 void Frame::present() {
-	device.wait(buffer_allocator.flush(), GPU::CommandQueueType_Direct);
-	device.submit_commands(command_buffer, GPU::CommandQueueType_Direct);
+	std::uint64_t copy_begin = Clock::timestamp_ns();
+	const GPU::Signal& copy_fence = buffer_allocator.flush();
+	device.wait(copy_fence, GPU::CommandQueueType_Direct);
+	if(async_compute) {
+		device.wait(copy_fence, GPU::CommandQueueType_Compute);
+	}
+	copy_wait_ns = Clock::timestamp_ns() - copy_begin;
+
+	const std::uint64_t async_value = queue_scheduler.get_last_signal(GPU::CommandQueueType_Compute).value;
+	submit_frame_commands();
+	if(const GPU::Signal& async = queue_scheduler.get_last_signal(GPU::CommandQueueType_Compute); async.value != async_value) {
+		async_fences[present_index] = async;
+	}
 
 	present_fences[present_index] = device.reset();
+	gpu_profiler.end_frame(&present_fences[present_index], 1);
+	if(async_fences[present_index].value) {
+		gpu_profiler.end_frame(&async_fences[present_index], 1);
+	}
+	submit_statistics = device.get_submit_statistics();
+	device.reset_submit_statistics();
+
+	const GPU::QueueSchedulerStatistics& scheduling = queue_scheduler.get_statistics();
+	submit_statistics.async_batches = scheduling.async_batches;
+	submit_statistics.queue_waits = scheduling.queue_waits;
+	submit_statistics.async_work = scheduling.async_work;
+	submit_statistics.overlapped_work = scheduling.overlapped_work;
+	queue_scheduler.reset_statistics();
 
 	buffer_allocator.lock(present_fences[present_index]);
 
-	command_buffer.reset();
+	reset_command_segments();
+	frame_allocator.next_frame();
 
 	present_index = (present_index + 1) % max_latency;
+
+	std::uint64_t pacing_begin = Clock::timestamp_ns();
+	frame_limiter.wait();
+	pacing_wait_ns = Clock::timestamp_ns() - pacing_begin;
+}
+
+void Frame::set_frame_limit(double target_frame_ms) {
+	frame_limiter.set_target_frame_time(target_frame_ms);
 }
 
 void Frame::wait() {
 	device.signal(GPU::CommandQueueType_Direct);
 	device.wait_for_fence(present_fences[(present_index + 1) % max_latency]);
+	if(const GPU::Signal& async = async_fences[(present_index + 1) % max_latency]; async.value) {
+		device.wait_for_fence(async);
+	}
+	gpu_profiler.read_back();
 }
 
 bool Frame::resize_buffers(float width, float height) {
 	bool changed = width >= viewport.width || height >= viewport.height;
 	if(changed) {
-		completed_fence = device.submit_commands(command_buffer, GPU::CommandQueueType_Direct);
+		completed_fence = submit_frame_commands();
 		device.signal(GPU::CommandQueueType_Direct);
 		device.wait_for_fence(completed_fence);
+		if(const GPU::Signal& async = queue_scheduler.get_last_signal(GPU::CommandQueueType_Compute); async.value) {
+			device.wait_for_fence(async);
+		}
 
-		command_buffer.reset();
+		reset_command_segments();
+		queue_scheduler.reset();
 
 		destroy_textures();
 		device.resize_buffers(static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height));
@@ -362,17 +518,29 @@ GPU::Device& Frame::get_device() {
 }
 
 GPU::CommandBuffer& Frame::get_command_buffer() {
-	return command_buffer;
+	return *command_segments[current_segment].commands;
 };
 
+GPU::CommandPagePool& Frame::get_command_pages() {
+	return command_pages;
+}
+
 GPUBufferAllocator& Frame::get_buffer_allocator() {
 	return buffer_allocator;
 }
 
+GPUProfiler& Frame::get_gpu_profiler() {
+	return gpu_profiler;
+}
+
 CopyContext& Frame::get_copy_context() {
 	return copy_context;
 }
 
+LinearAllocator& Frame::get_frame_allocator() {
+	return frame_allocator.get();
+}
+
 void Frame::create_views(FrameTexture& texture) {
 	GPU::TextureView view = GPU::texture_view_defaults(texture.texture.handle, texture.texture.desc);
 
@@ -386,6 +554,7 @@ void Frame::create_views(FrameTexture& texture) {
 }
 
 void Frame::destroy_textures() {
+	++texture_generation;
 	for(auto& texture : texture_pool) {
 		if(GPU::TextureHandle& handle = texture->texture.handle; handle != GPU::TextureHandle::Invalid) {
 			device.destroy_texture(handle);
@@ -404,4 +573,72 @@ void Frame::destroy_textures() {
 	}
 }
 
+void Frame::add_command_segment() {
+	CommandSegment& segment = command_segments.emplace_back();
+	segment.commands = std::make_unique<GPU::CommandBuffer>(command_pages);
+	segment.optimized_commands = std::make_unique<GPU::CommandBuffer>(command_pages);
+	segment.retained = nullptr;
+	segment.queue = GPU::CommandQueueType_Direct;
+}
+
+void Frame::next_command_segment(GPU::CommandQueueType queue) {
+	if(++current_segment == command_segments.size()) {
+		add_command_segment();
+	}
+	command_segments[current_segment].queue = queue;
+}
+
+void Frame::set_command_queue(GPU::CommandQueueType queue) {
+	CommandSegment& segment = command_segments[current_segment];
+	if(segment.queue != queue) {
+		if(segment.commands->get_command_count()) {
+			next_command_segment(queue);
+		}
+		else {
+			segment.queue = queue;
+		}
+	}
+}
+
+void Frame::reset_command_segments() {
+	for(std::uint32_t i = 0; i <= current_segment; ++i) {
+		command_segments[i].commands->reset();
+		command_segments[i].retained = nullptr;
+		command_segments[i].queue = GPU::CommandQueueType_Direct;
+	}
+	current_segment = 0;
+}
+
+GPU::Signal Frame::submit_frame_commands() {
+	CD_ASSERT(2 * (current_segment + 1) <= GPU::max_submit_command_buffers);
+
+	GPU::QueueSubmission submissions[GPU::max_submit_command_buffers];
+	std::size_t num_submissions = 0;
+
+	for(std::uint32_t i = 0; i <= current_segment; ++i) {
+		CommandSegment& segment = command_segments[i];
+
+		const GPU::CommandBuffer* commands = segment.commands.get();
+		if(optimize_commands) {
+			command_optimizer.optimize(*commands, *segment.optimized_commands);
+			commands = segment.optimized_commands.get();
+		}
+
+		if(commands->get_command_count() || (!num_submissions && !segment.retained)) {
+			submissions[num_submissions++] = {commands, segment.queue};
+		}
+		if(segment.retained) {
+			submissions[num_submissions++] = {segment.retained, segment.queue};
+		}
+	}
+
+	GPU::Signal signal = queue_scheduler.submit(device, submissions, num_submissions);
+
+	for(std::uint32_t i = 0; i <= current_segment; ++i) {
+		command_segments[i].optimized_commands->reset();
+	}
+
+	return signal;
+}
+
 }
\ No newline at end of file
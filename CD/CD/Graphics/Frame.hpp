@@ -1,8 +1,14 @@
 #pragma once
 
 #include <CD/Graphics/Common.hpp>
+#include <CD/Graphics/GPUProfiler.hpp>
+#include <CD/Common/Clock.hpp>
+#include <CD/Common/LinearAllocator.hpp>
 #include <CD/GPU/CommandBuffer.hpp>
+#include <CD/GPU/CommandOptimizer.hpp>
+#include <CD/GPU/QueueScheduler.hpp>
 #include <CD/GPU/Shader.hpp>
+#include <memory>
 #include <vector>
 #include <queue>
 
@@ -15,7 +21,7 @@ struct BufferAllocation {
 
 class GPUBufferAllocator {
 public:
-	GPUBufferAllocator(GPU::Device&);
+	GPUBufferAllocator(GPU::Device&, GPU::CommandPagePool&);
 	~GPUBufferAllocator();
 
 	BufferAllocation create_buffer(std::uint32_t buffer_size, const void* data = nullptr, bool upload = true);
@@ -50,9 +56,33 @@ private:
 	std::queue<std::pair<GPU::Signal, BufferFrameData>> cache;
 };
 
+// Upload memory at a fixed location for each frame in flight, for data read by retained command buffers which cannot
+// follow the offsets of the buffer allocator. The slot of a frame is written once the GPU is done with the frame that
+// used it last. A slot is recreated when it is too small, the generation counts how many times that happened.
+class FrameDataBuffer {
+public:
+	FrameDataBuffer(GPU::Device&, std::uint32_t num_frames);
+	~FrameDataBuffer();
+
+	BufferAllocation write(std::uint32_t frame_index, const void* data, std::uint32_t num_bytes);
+	std::uint64_t get_generation() const;
+private:
+	constexpr static std::uint32_t buffer_alignment = 256;
+
+	struct FrameSlot {
+		GPU::BufferHandle handle;
+		void* mapped_memory;
+		std::uint32_t size;
+	};
+
+	GPU::Device& device;
+	std::vector<FrameSlot> slots;
+	std::uint64_t generation;
+};
+
 class CopyContext {
 public:
-	CopyContext(GPU::Device&);
+	CopyContext(GPU::Device&, GPU::CommandPagePool&);
 	~CopyContext();
 
 	void upload_texture_slice(const Texture*, const GPU::TextureView&, const void* data, std::uint16_t width, std::uint16_t height, std::uint32_t row_pitch);
@@ -95,7 +125,6 @@ struct FrameTextureViews {
 
 struct FrameTexture {
 	Texture texture;
-	GPU::ResourceState state = GPU::ResourceState::Common;
 	FrameTextureViews* views;
 };
 
@@ -112,6 +141,12 @@ public:
 	const ComputePipeline* create_pipeline(const GPU::ComputePipelineDesc&, const GPU::PipelineInputLayout&);
 
 	void bind_resources(const FrameResourceIndex* textures, std::size_t num_textures, GPU::ResourceState);
+	void execute_retained(const GPU::CommandBuffer&);
+	void begin_async_compute();
+	void end_async_compute();
+	GPURange begin_gpu_range(const char* name, bool pipeline_statistics = false);
+	GPURange begin_retained_gpu_range(const char* name);
+	void end_gpu_range(const GPURange&);
 
 	void begin();
 	void present();
@@ -122,24 +157,68 @@ public:
 	GPU::ShaderCompiler& get_shader_compiler();
 	GPU::Device& get_device();
 	GPU::CommandBuffer& get_command_buffer();
+	GPU::CommandPagePool& get_command_pages();
 	GPUBufferAllocator& get_buffer_allocator();
+	GPUProfiler& get_gpu_profiler();
 	CopyContext& get_copy_context();
-private:
+	LinearAllocator& get_frame_allocator();
+
+	std::uint64_t get_fence_wait_ns() const;
+	std::uint64_t get_copy_wait_ns() const;
+	std::uint64_t get_pacing_wait_ns() const;
+
+	void set_frame_limit(double target_frame_ms);
+	const FramePacingStats& get_pacing_stats() const;
+
+	void set_command_optimization(bool enable);
+	void set_async_compute(bool enable);
+	const GPU::CommandOptimizerStatistics& get_command_optimizer_statistics() const;
+	const GPU::SubmitStatistics& get_submit_statistics() const;
+
 	static constexpr std::uint32_t max_latency = 3;
 
+	std::uint32_t get_frame_index() const;
+	std::uint64_t get_texture_generation() const;
+private:
 	GPU::Device& device;
-	GPU::CommandBuffer command_buffer;
+	GPU::CommandPagePool command_pages;
+
+	// Frame commands are split around retained command buffers and queue changes, each segment is submitted before its
+	// retained buffer.
+	struct CommandSegment {
+		std::unique_ptr<GPU::CommandBuffer> commands;
+		std::unique_ptr<GPU::CommandBuffer> optimized_commands;
+		const GPU::CommandBuffer* retained;
+		GPU::CommandQueueType queue;
+	};
+
+	std::vector<CommandSegment> command_segments;
+	std::uint32_t current_segment;
+	GPU::CommandOptimizer command_optimizer;
+	bool optimize_commands;
+	GPU::QueueScheduler queue_scheduler;
+	bool async_compute;
 	GPU::Viewport viewport;
 
 	GPU::Signal present_fences[max_latency];
+	GPU::Signal async_fences[max_latency];
 	GPU::Signal completed_fence;
 	std::uint32_t present_index;
 
+	std::uint64_t fence_wait_ns;
+	std::uint64_t copy_wait_ns;
+	std::uint64_t pacing_wait_ns;
+	FrameLimiter frame_limiter;
+	GPU::SubmitStatistics submit_statistics;
+
 	GPUBufferAllocator buffer_allocator;
 	CopyContext copy_context;
+	FrameAllocator frame_allocator;
+	GPUProfiler gpu_profiler;
 
 	std::vector<std::unique_ptr<FrameTexture>> texture_pool;
 	std::vector<std::unique_ptr<FrameTextureViews>> views;
+	std::uint64_t texture_generation;
 
 	std::vector<std::unique_ptr<RenderPass>> render_passes;
 	std::vector<std::unique_ptr<ComputePipeline>> compute_pipelines;
@@ -147,6 +226,55 @@ private:
 
 	void create_views(FrameTexture&);
 	void destroy_textures();
+	void add_command_segment();
+	void next_command_segment(GPU::CommandQueueType);
+	void set_command_queue(GPU::CommandQueueType);
+	void reset_command_segments();
+	GPU::Signal submit_frame_commands();
 };
 
+inline std::uint64_t FrameDataBuffer::get_generation() const {
+	return generation;
+}
+
+inline std::uint64_t Frame::get_fence_wait_ns() const {
+	return fence_wait_ns;
+}
+
+inline std::uint64_t Frame::get_copy_wait_ns() const {
+	return copy_wait_ns;
+}
+
+inline std::uint64_t Frame::get_pacing_wait_ns() const {
+	return pacing_wait_ns;
+}
+
+inline const FramePacingStats& Frame::get_pacing_stats() const {
+	return frame_limiter.get_stats();
+}
+
+inline void Frame::set_command_optimization(bool enable) {
+	optimize_commands = enable;
+}
+
+inline void Frame::set_async_compute(bool enable) {
+	async_compute = enable;
+}
+
+inline const GPU::CommandOptimizerStatistics& Frame::get_command_optimizer_statistics() const {
+	return command_optimizer.get_statistics();
+}
+
+inline const GPU::SubmitStatistics& Frame::get_submit_statistics() const {
+	return submit_statistics;
+}
+
+inline std::uint32_t Frame::get_frame_index() const {
+	return present_index;
+}
+
+inline std::uint64_t Frame::get_texture_generation() const {
+	return texture_generation;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include <CD/Graphics/FrameStatistics.hpp>
+#include <CD/Common/Debug.hpp>
+#include <algorithm>
+
+namespace CD {
+
+FrameStatistics::FrameStatistics() :
+	hitch_min_ms(8.f),
+	hitch_median_factor(2.f),
+	gpu_bound_fraction(.1f) {
+	reset();
+}
+
+void FrameStatistics::add_frame(const FrameTimings& timings) {
+	FrameSample sample {};
+	sample.frame = frame_count;
+	sample.frame_ms = timings.frame_ns / 1e6f;
+	for(std::size_t stage = 0; stage < FrameStage_Count; ++stage) {
+		sample.stage_ms[stage] = timings.stage_ns[stage] / 1e6f;
+	}
+
+	bool gpu_bound = sample.stage_ms[FrameStage_FenceWait] >= gpu_bound_fraction * sample.frame_ms;
+	sample.bound = gpu_bound ? FrameBound::GPU : FrameBound::CPU;
+	++bound_counts[static_cast<std::size_t>(sample.bound)];
+
+	sample.hitch = frame_count > 0 && sample.frame_ms > std::max(hitch_min_ms, percentiles.p50 * hitch_median_factor);
+	sample.hitch_cause = FrameStage_Other;
+	if(sample.hitch) {
+		float max_excess = -1.f;
+		for(std::size_t stage = 0; stage < FrameStage_Count; ++stage) {
+			float excess = sample.stage_ms[stage] - stage_averages[stage];
+			if(excess > max_excess) {
+				max_excess = excess;
+				sample.hitch_cause = static_cast<FrameStage>(stage);
+			}
+		}
+
+		hitches[hitch_count % max_recorded_hitches] = sample;
+		++hitch_count;
+	}
+	else {
+		for(std::size_t stage = 0; stage < FrameStage_Count; ++stage) {
+			float& average = stage_averages[stage];
+			average = frame_count ? average + (sample.stage_ms[stage] - average) * stage_average_weight : sample.stage_ms[stage];
+		}
+	}
+
+	std::size_t bin = std::min(static_cast<std::size_t>(sample.frame_ms / frame_histogram_bin_ms), frame_histogram_bins - 1);
+	++histogram[bin];
+
+	frame_history[frame_count % frame_history_size] = sample.frame_ms;
+	last_frame = sample;
+	++frame_count;
+
+	if(frame_count < percentile_update_interval || frame_count % percentile_update_interval == 0) {
+		update_percentiles();
+	}
+}
+
+void FrameStatistics::add_submit_statistics(const GPU::SubmitStatistics& statistics) {
+	GPU::add_submit_statistics(submit_totals, statistics);
+	++submit_frame_count;
+}
+
+void FrameStatistics::add_allocation_statistics(const Memory::AllocationStats& statistics) {
+	auto add_counters = [](Memory::AllocationCounters& totals, const Memory::AllocationCounters& counters) {
+		totals.allocations += counters.allocations;
+		totals.frees += counters.frees;
+		totals.allocated_bytes += counters.allocated_bytes;
+		totals.freed_bytes += counters.freed_bytes;
+	};
+
+	add_counters(allocation_totals.total, statistics.total);
+	for(std::size_t tag = 0; tag < Memory::MemoryTag_Count; ++tag) {
+		add_counters(allocation_totals.tags[tag], statistics.tags[tag]);
+	}
+	allocation_totals.frame = statistics.frame;
+	allocation_totals.steady_state_violations = statistics.steady_state_violations;
+	++allocation_frame_count;
+}
+
+void FrameStatistics::reset() {
+	std::fill(std::begin(frame_history), std::end(frame_history), 0.f);
+	std::fill(std::begin(histogram), std::end(histogram), 0);
+	std::fill(std::begin(stage_averages), std::end(stage_averages), 0.f);
+	std::fill(std::begin(bound_counts), std::end(bound_counts), 0);
+
+	last_frame = {};
+	percentiles = {};
+	frame_count = 0;
+	hitch_count = 0;
+	submit_totals = {};
+	submit_frame_count = 0;
+	allocation_totals = {};
+	allocation_frame_count = 0;
+}
+
+void FrameStatistics::set_hitch_threshold(float min_ms, float median_factor) {
+	hitch_min_ms = min_ms;
+	hitch_median_factor = median_factor;
+}
+
+void FrameStatistics::set_gpu_bound_threshold(float fence_wait_fraction) {
+	gpu_bound_fraction = fence_wait_fraction;
+}
+
+std::size_t FrameStatistics::get_recorded_hitch_count() const {
+	return static_cast<std::size_t>(std::min<std::uint64_t>(hitch_count, max_recorded_hitches));
+}
+
+const FrameSample& FrameStatistics::get_recorded_hitch(std::size_t index) const {
+	CD_ASSERT(index < get_recorded_hitch_count());
+	std::uint64_t first = hitch_count - get_recorded_hitch_count();
+	return hitches[(first + index) % max_recorded_hitches];
+}
+
+void FrameStatistics::write_report(std::ostream& stream) const {
+	stream << "frames " << frame_count
+		<< " cpu_bound " << get_bound_count(FrameBound::CPU)
+		<< " gpu_bound " << get_bound_count(FrameBound::GPU)
+		<< " hitches " << hitch_count << "\n";
+	stream << "p50 " << percentiles.p50
+		<< " p95 " << percentiles.p95
+		<< " p99 " << percentiles.p99
+		<< " max " << percentiles.max << "\n";
+
+	for(std::size_t bin = 0; bin < frame_histogram_bins; ++bin) {
+		if(histogram[bin]) {
+			stream << "[" << bin * frame_histogram_bin_ms << ", ";
+			if(bin + 1 < frame_histogram_bins) {
+				stream << (bin + 1) * frame_histogram_bin_ms;
+			}
+			else {
+				stream << "inf";
+			}
+			stream << ") ms " << histogram[bin] << "\n";
+		}
+	}
+
+	for(std::size_t i = 0; i < get_recorded_hitch_count(); ++i) {
+		const FrameSample& hitch = get_recorded_hitch(i);
+		stream << "hitch frame " << hitch.frame << " " << hitch.frame_ms << " ms cause " << get_stage_name(hitch.hitch_cause);
+		for(std::size_t stage = 0; stage < FrameStage_Count; ++stage) {
+			stream << " " << get_stage_name(static_cast<FrameStage>(stage)) << " " << hitch.stage_ms[stage];
+		}
+		stream << "\n";
+	}
+
+	if(submit_frame_count) {
+		double frames = static_cast<double>(submit_frame_count);
+		stream << "per frame submits " << submit_totals.submits / frames
+			<< " command_buffers " << submit_totals.command_buffers / frames
+			<< " reused " << submit_totals.reused_command_buffers / frames
+			<< " command_bytes " << submit_totals.command_bytes / frames
+			<< " translation_ms " << submit_totals.translation_ns / frames / 1e6 << "\n";
+		stream << "per frame pipeline_switches " << submit_totals.pipeline_switches / frames
+			<< " root_signature_switches " << submit_totals.root_signature_switches / frames
+			<< " root_argument_binds " << submit_totals.root_argument_binds / frames
+			<< " root_argument_hits " << submit_totals.root_argument_hits / frames
+			<< " barriers " << submit_totals.barriers / frames
+			<< " barrier_calls " << submit_totals.barrier_calls / frames
+			<< " split_barriers " << submit_totals.split_barriers / frames
+			<< " state_fixups " << submit_totals.state_fixups / frames << "\n";
+		if(submit_totals.command_allocator_acquires) {
+			stream << "per frame command_allocators " << submit_totals.command_allocators / frames
+				<< " allocator_acquires " << submit_totals.command_allocator_acquires / frames
+				<< " allocator_reuse_rate " << static_cast<double>(submit_totals.command_allocator_reuses) / submit_totals.command_allocator_acquires << "\n";
+		}
+		if(submit_totals.async_batches) {
+			stream << "per frame async_batches " << submit_totals.async_batches / frames
+				<< " queue_waits " << submit_totals.queue_waits / frames
+				<< " async_work " << submit_totals.async_work / frames
+				<< " overlap_rate " << (submit_totals.async_work ? static_cast<double>(submit_totals.overlapped_work) / submit_totals.async_work : 0.) << "\n";
+		}
+
+		for(std::size_t type = 0; type < GPU::command_type_count; ++type) {
+			if(submit_totals.command_counts[type]) {
+				stream << "per frame " << GPU::get_command_type_name(static_cast<GPU::CommandType>(type)) << " " << submit_totals.command_counts[type] / frames << "\n";
+			}
+		}
+	}
+
+	if(allocation_frame_count) {
+		double frames = static_cast<double>(allocation_frame_count);
+		stream << "per frame allocations " << allocation_totals.total.allocations / frames
+			<< " frees " << allocation_totals.total.frees / frames
+			<< " allocated_bytes " << allocation_totals.total.allocated_bytes / frames
+			<< " steady_state_violations " << allocation_totals.steady_state_violations << "\n";
+		for(std::size_t tag = 0; tag < Memory::MemoryTag_Count; ++tag) {
+			const Memory::AllocationCounters& counters = allocation_totals.tags[tag];
+			if(counters.allocations || counters.frees) {
+				stream << "per frame allocations " << Memory::get_tag_name(static_cast<Memory::MemoryTag>(tag)) << " " << counters.allocations / frames
+					<< " frees " << counters.frees / frames
+					<< " allocated_bytes " << counters.allocated_bytes / frames << "\n";
+			}
+		}
+	}
+}
+
+const char* FrameStatistics::get_stage_name(FrameStage stage) {
+	constexpr const char* names[FrameStage_Count] {
+		"FenceWait",
+		"Build",
+		"CopyWait",
+		"Present",
+		"Pacing",
+		"Other"
+	};
+
+	CD_ASSERT(stage < FrameStage_Count);
+	return names[stage];
+}
+
+void FrameStatistics::update_percentiles() {
+	std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(frame_count, frame_history_size));
+	if(!count) {
+		percentiles = {};
+		return;
+	}
+
+	float* begin = percentile_scratch;
+	float* end = percentile_scratch + count;
+	std::copy(frame_history, frame_history + count, begin);
+
+	float* p50 = begin + (count - 1) / 2;
+	float* p95 = begin + (count - 1) * 95 / 100;
+	float* p99 = begin + (count - 1) * 99 / 100;
+
+	std::nth_element(begin, p50, end);
+	std::nth_element(p50, p95, end);
+	std::nth_element(p95, p99, end);
+
+	percentiles.p50 = *p50;
+	percentiles.p95 = *p95;
+	percentiles.p99 = *p99;
+	percentiles.max = *std::max_element(p99, end);
+}
+
+}
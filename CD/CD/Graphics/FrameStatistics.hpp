@@ -0,0 +1,141 @@
+#pragma once
+
+#include <CD/Common/Common.hpp>
+#include <CD/Common/AllocationTracker.hpp>
+#include <CD/GPU/CommandBuffer.hpp>
+#include <ostream>
+
+namespace CD {
+
+enum FrameStage : std::uint8_t {
+	FrameStage_FenceWait,
+	FrameStage_Build,
+	FrameStage_CopyWait,
+	FrameStage_Present,
+	FrameStage_Pacing,
+	FrameStage_Other,
+	FrameStage_Count
+};
+
+enum class FrameBound : std::uint8_t {
+	CPU,
+	GPU
+};
+
+struct FrameTimings {
+	std::uint64_t frame_ns;
+	std::uint64_t stage_ns[FrameStage_Count];
+};
+
+struct FrameSample {
+	std::uint64_t frame;
+	float frame_ms;
+	float stage_ms[FrameStage_Count];
+	FrameBound bound;
+	bool hitch;
+	FrameStage hitch_cause;
+};
+
+struct FramePercentiles {
+	float p50;
+	float p95;
+	float p99;
+	float max;
+};
+
+constexpr std::size_t frame_history_size = 1024;
+constexpr std::size_t frame_histogram_bins = 64;
+constexpr float frame_histogram_bin_ms = .5f;
+constexpr std::size_t max_recorded_hitches = 32;
+
+class FrameStatistics {
+public:
+	FrameStatistics();
+
+	void add_frame(const FrameTimings&);
+	void add_submit_statistics(const GPU::SubmitStatistics&);
+	void add_allocation_statistics(const Memory::AllocationStats&);
+	void reset();
+
+	void set_hitch_threshold(float min_ms, float median_factor);
+	void set_gpu_bound_threshold(float fence_wait_fraction);
+
+	const FrameSample& get_last_frame() const;
+	const FramePercentiles& get_percentiles() const;
+	const std::uint64_t* get_histogram() const;
+
+	std::uint64_t get_frame_count() const;
+	std::uint64_t get_hitch_count() const;
+	std::uint64_t get_bound_count(FrameBound) const;
+	const GPU::SubmitStatistics& get_submit_totals() const;
+	const Memory::AllocationStats& get_allocation_totals() const;
+
+	std::size_t get_recorded_hitch_count() const;
+	const FrameSample& get_recorded_hitch(std::size_t index) const;
+
+	void write_report(std::ostream&) const;
+
+	static const char* get_stage_name(FrameStage);
+private:
+	static constexpr std::uint64_t percentile_update_interval = 64;
+	static constexpr float stage_average_weight = .05f;
+
+	float frame_history[frame_history_size];
+	float percentile_scratch[frame_history_size];
+	std::uint64_t histogram[frame_histogram_bins];
+
+	FrameSample hitches[max_recorded_hitches];
+	FrameSample last_frame;
+	FramePercentiles percentiles;
+
+	float stage_averages[FrameStage_Count];
+	float hitch_min_ms;
+	float hitch_median_factor;
+	float gpu_bound_fraction;
+
+	std::uint64_t frame_count;
+	std::uint64_t hitch_count;
+	std::uint64_t bound_counts[2];
+
+	GPU::SubmitStatistics submit_totals;
+	std::uint64_t submit_frame_count;
+
+	Memory::AllocationStats allocation_totals;
+	std::uint64_t allocation_frame_count;
+
+	void update_percentiles();
+};
+
+inline const FrameSample& FrameStatistics::get_last_frame() const {
+	return last_frame;
+}
+
+inline const FramePercentiles& FrameStatistics::get_percentiles() const {
+	return percentiles;
+}
+
+inline const std::uint64_t* FrameStatistics::get_histogram() const {
+	return histogram;
+}
+
+inline std::uint64_t FrameStatistics::get_frame_count() const {
+	return frame_count;
+}
+
+inline std::uint64_t FrameStatistics::get_hitch_count() const {
+	return hitch_count;
+}
+
+inline std::uint64_t FrameStatistics::get_bound_count(FrameBound bound) const {
+	return bound_counts[static_cast<std::size_t>(bound)];
+}
+
+inline const GPU::SubmitStatistics& FrameStatistics::get_submit_totals() const {
+	return submit_totals;
+}
+
+inline const Memory::AllocationStats& FrameStatistics::get_allocation_totals() const {
+	return allocation_totals;
+}
+
+}
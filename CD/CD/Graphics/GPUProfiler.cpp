@@ -0,0 +1,372 @@
+#include <CD/Graphics/GPUProfiler.hpp>
+#include <CD/Graphics/Frame.hpp>
+#include <CD/Common/Debug.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace CD {
+
+constexpr std::uint32_t queries_per_range = 2;
+constexpr std::uint32_t max_retained_statistics = 8;
+
+static void add_statistics(GPU::PipelineStatistics& total, const GPU::PipelineStatistics& statistics) {
+	total.ia_vertices += statistics.ia_vertices;
+	total.ia_primitives += statistics.ia_primitives;
+	total.vs_invocations += statistics.vs_invocations;
+	total.gs_invocations += statistics.gs_invocations;
+	total.gs_primitives += statistics.gs_primitives;
+	total.c_invocations += statistics.c_invocations;
+	total.c_primitives += statistics.c_primitives;
+	total.ps_invocations += statistics.ps_invocations;
+	total.hs_invocations += statistics.hs_invocations;
+	total.ds_invocations += statistics.ds_invocations;
+	total.cs_invocations += statistics.cs_invocations;
+}
+
+GPUProfiler::GPUProfiler(GPU::Device& device, std::uint32_t latency) :
+	device(device),
+	timestamp_frequency(),
+	slots(latency),
+	current_slot(0),
+	range_capacity(static_cast<std::uint32_t>(GPU::default_timestamp_queries / (queries_per_range * latency))),
+	grow(false),
+	pipeline_statistics_enabled(true),
+	readback_buffer(GPU::BufferHandle::Null),
+	statistics_buffer(GPU::BufferHandle::Null),
+	passes(),
+	retained_passes(),
+	statistics() {
+	CD_ASSERT(latency && range_capacity);
+
+	const GPU::DeviceFeatureInfo info = device.report_feature_info();
+	for(std::size_t queue = 0; queue < GPU::CommandQueueType_Count; ++queue) {
+		timestamp_frequency[queue] = info.timestamp_frequency[queue];
+	}
+
+	create_readback_buffers();
+}
+
+GPUProfiler::~GPUProfiler() {
+	destroy_readback_buffers();
+}
+
+// Reads back the results the slot held latency frames ago. When the last frame dropped ranges, every slot is read
+// back before the query heap and the readback buffer grow.
+void GPUProfiler::begin_frame(std::uint32_t slot) {
+	CD_ASSERT(slot < slots.size());
+
+	if(grow) {
+		read_back();
+
+		range_capacity *= 2;
+		destroy_readback_buffers();
+		create_readback_buffers();
+		grow = false;
+	}
+	else {
+		read_slot(slots[slot], slot);
+	}
+
+	current_slot = slot;
+}
+
+void GPUProfiler::end_frame(const GPU::Signal* fences, std::size_t num_fences) {
+	FrameSlot& frame_slot = slots[current_slot];
+	for(std::size_t i = 0; i < num_fences; ++i) {
+		frame_slot.fences[fences[i].queue] = fences[i];
+	}
+}
+
+void GPUProfiler::read_back() {
+	for(std::uint32_t slot = 0; slot < slots.size(); ++slot) {
+		read_slot(slots[slot], slot);
+	}
+}
+
+GPURange GPUProfiler::begin_range(GPU::CommandBuffer& command_buffer, GPU::CommandQueueType queue, const char* name, bool pipeline_statistics) {
+	return add_range(command_buffer, queue, name, pipeline_statistics, false);
+}
+
+// Queries are resolved on the queue that wrote them, readback offsets match query indices.
+void GPUProfiler::end_range(GPU::CommandBuffer& command_buffer, const GPURange& range) {
+	if(range.index == GPU::no_scope_timestamp) {
+		return;
+	}
+
+	FrameSlot& frame_slot = slots[current_slot];
+	const std::uint32_t record = range.index / queries_per_range;
+	CD_ASSERT(record - current_slot * range_capacity < frame_slot.ranges.size());
+
+	RangeRecord& range_record = frame_slot.ranges[record - current_slot * range_capacity];
+	CD_ASSERT(!range_record.ended && range_record.queue == range.queue);
+	range_record.ended = true;
+
+	if(range_record.pipeline_statistics) {
+		if(!range_record.retained_statistics) {
+			GPU::EndPipelineStatisticsDesc end;
+			end.index = range_record.statistics_query;
+			command_buffer.add_command(end);
+		}
+
+		GPU::ResolvePipelineStatisticsDesc resolve;
+		resolve.index = range_record.statistics_query;
+		resolve.query_count = 1;
+		resolve.dest = statistics_buffer;
+		resolve.aligned_offset = range_record.statistics_query * static_cast<std::uint32_t>(sizeof(GPU::PipelineStatistics));
+		command_buffer.add_command(resolve);
+	}
+
+	GPU::InsertTimestampDesc timestamp;
+	timestamp.index = range.index + 1;
+	command_buffer.add_command(timestamp);
+
+	GPU::ResolveTimestampsDesc resolve;
+	resolve.index = range.index;
+	resolve.timestamp_count = queries_per_range;
+	resolve.dest = readback_buffer;
+	resolve.aligned_offset = range.index * static_cast<std::uint32_t>(sizeof(std::uint64_t));
+	command_buffer.add_command(resolve);
+}
+
+std::uint32_t GPUProfiler::get_retained_statistics_query(std::uint32_t slot, const char* name) {
+	CD_ASSERT(slot < slots.size());
+
+	const std::uint32_t pass = get_pass_index(name);
+	auto it = std::find(retained_passes.begin(), retained_passes.end(), pass);
+	if(it == retained_passes.end()) {
+		CD_ASSERT(retained_passes.size() < max_retained_statistics);
+		it = retained_passes.insert(retained_passes.end(), pass);
+	}
+
+	return slot * max_retained_statistics + static_cast<std::uint32_t>(it - retained_passes.begin());
+}
+
+GPURange GPUProfiler::begin_retained_range(GPU::CommandBuffer& command_buffer, GPU::CommandQueueType queue, const char* name) {
+	return add_range(command_buffer, queue, name, true, true);
+}
+
+const GPUPassTimings* GPUProfiler::find_pass(const char* name) const {
+	auto it = std::find_if(passes.begin(), passes.end(), [name](const GPUPassTimings& pass) {
+		return std::strncmp(pass.name, name, GPU::max_scope_label_length - 1) == 0;
+	});
+	return it != passes.end() ? &*it : nullptr;
+}
+
+GPU::PipelineStatistics GPUProfiler::get_average_statistics(std::size_t index) const {
+	const GPUPassTimings& pass = passes[index];
+	if(!pass.statistics_samples) {
+		return {};
+	}
+
+	const GPU::PipelineStatistics& total = pass.total_statistics;
+	const std::uint64_t samples = pass.statistics_samples;
+	return {
+		total.ia_vertices / samples,
+		total.ia_primitives / samples,
+		total.vs_invocations / samples,
+		total.gs_invocations / samples,
+		total.gs_primitives / samples,
+		total.c_invocations / samples,
+		total.c_primitives / samples,
+		total.ps_invocations / samples,
+		total.hs_invocations / samples,
+		total.ds_invocations / samples,
+		total.cs_invocations / samples
+	};
+}
+
+void GPUProfiler::reset_statistics() {
+	for(GPUPassTimings& pass : passes) {
+		pass.samples = 0;
+		pass.total_ms = 0.;
+		pass.min_ms = 0.;
+		pass.max_ms = 0.;
+		pass.statistics_samples = 0;
+		pass.total_statistics = {};
+	}
+
+	statistics.resolved_frames = 0;
+	statistics.dropped_ranges = 0;
+}
+
+void GPUProfiler::write_report(std::ostream& stream) const {
+	stream << "gpu frames " << statistics.resolved_frames
+		<< " range_capacity " << statistics.range_capacity
+		<< " dropped_ranges " << statistics.dropped_ranges << "\n";
+
+	for(std::size_t i = 0; i < passes.size(); ++i) {
+		const GPUPassTimings& pass = passes[i];
+		stream << "gpu pass " << pass.name
+			<< " samples " << pass.samples
+			<< " avg_ms " << get_average_ms(i)
+			<< " min_ms " << pass.min_ms
+			<< " max_ms " << pass.max_ms << "\n";
+
+		if(pass.statistics_samples) {
+			const GPU::PipelineStatistics average = get_average_statistics(i);
+			stream << "gpu pass " << pass.name
+				<< " vertices " << average.ia_vertices
+				<< " primitives " << average.ia_primitives
+				<< " vs_invocations " << average.vs_invocations
+				<< " rasterized " << average.c_primitives
+				<< " ps_invocations " << average.ps_invocations
+				<< " cs_invocations " << average.cs_invocations << "\n";
+		}
+	}
+}
+
+GPURange GPUProfiler::add_range(GPU::CommandBuffer& command_buffer, GPU::CommandQueueType queue, const char* name, bool pipeline_statistics, bool retained_statistics) {
+	FrameSlot& frame_slot = slots[current_slot];
+	if(frame_slot.ranges.size() == range_capacity) {
+		++statistics.dropped_ranges;
+		grow = true;
+		return {GPU::no_scope_timestamp, queue};
+	}
+
+	const std::uint32_t record = current_slot * range_capacity + static_cast<std::uint32_t>(frame_slot.ranges.size());
+	const std::uint32_t index = record * queries_per_range;
+	const std::uint32_t statistics_query = retained_statistics ? get_retained_statistics_query(current_slot, name) : get_retained_query_count() + record;
+	pipeline_statistics = pipeline_statistics && pipeline_statistics_enabled && queue != GPU::CommandQueueType_Copy;
+	frame_slot.ranges.push_back({get_pass_index(name), statistics_query, queue, pipeline_statistics, retained_statistics, false});
+
+	GPU::InsertTimestampDesc timestamp;
+	timestamp.index = index;
+	command_buffer.add_command(timestamp);
+
+	if(pipeline_statistics && !retained_statistics) {
+		GPU::BeginPipelineStatisticsDesc begin;
+		begin.index = statistics_query;
+		command_buffer.add_command(begin);
+	}
+
+	return {index, queue};
+}
+
+std::uint32_t GPUProfiler::get_retained_query_count() const {
+	return static_cast<std::uint32_t>(slots.size()) * max_retained_statistics;
+}
+
+// The query heaps and the readback buffers hold range_capacity ranges for each slot, the statistics queries of the
+// retained buffers come first.
+void GPUProfiler::create_readback_buffers() {
+	const std::uint32_t num_ranges = static_cast<std::uint32_t>(slots.size()) * range_capacity;
+	const std::uint32_t num_statistics_queries = get_retained_query_count() + num_ranges;
+	device.reserve_queries(GPU::QueryType_Timestamp, num_ranges * queries_per_range);
+	device.reserve_queries(GPU::QueryType_PipelineStatistics, num_statistics_queries);
+
+	GPU::BufferDesc readback_desc {
+		num_ranges * queries_per_range * sizeof(std::uint64_t),
+		GPU::BufferStorage::Readback,
+		GPU::BindFlags_None
+	};
+	readback_buffer = device.create_buffer(readback_desc);
+
+	GPU::BufferDesc statistics_desc {
+		num_statistics_queries * sizeof(GPU::PipelineStatistics),
+		GPU::BufferStorage::Readback,
+		GPU::BindFlags_None
+	};
+	statistics_buffer = device.create_buffer(statistics_desc);
+
+	for(FrameSlot& frame_slot : slots) {
+		frame_slot.ranges.reserve(range_capacity);
+	}
+	statistics.range_capacity = range_capacity;
+}
+
+void GPUProfiler::destroy_readback_buffers() {
+	device.destroy_buffer(readback_buffer);
+	device.destroy_buffer(statistics_buffer);
+}
+
+// The frame reusing the slot has waited for its fences, waiting here does not block in the common case. The
+// buffer is mapped from its start as the D3D12 backend returns the start of the buffer whatever the offset.
+void GPUProfiler::read_slot(FrameSlot& frame_slot, std::uint32_t slot) {
+	if(frame_slot.ranges.empty()) {
+		return;
+	}
+
+	for(GPU::Signal& fence : frame_slot.fences) {
+		if(fence.value) {
+			device.wait_for_fence(fence);
+			fence.value = 0;
+		}
+	}
+
+	const std::uint64_t first_range = static_cast<std::uint64_t>(slot) * range_capacity;
+	const std::uint64_t last_range = first_range + frame_slot.ranges.size();
+
+	void* data = nullptr;
+	device.map_buffer(readback_buffer, &data, 0, last_range * queries_per_range * sizeof(std::uint64_t));
+	const std::uint64_t* ticks = static_cast<const std::uint64_t*>(data) + first_range * queries_per_range;
+
+	const bool read_statistics = std::any_of(frame_slot.ranges.begin(), frame_slot.ranges.end(), [](const RangeRecord& range) {
+		return range.ended && range.pipeline_statistics;
+	});
+
+	void* statistics_data = nullptr;
+	if(read_statistics) {
+		device.map_buffer(statistics_buffer, &statistics_data, 0, (get_retained_query_count() + last_range) * sizeof(GPU::PipelineStatistics));
+	}
+	const GPU::PipelineStatistics* pipeline_statistics = static_cast<const GPU::PipelineStatistics*>(statistics_data);
+
+	for(std::size_t i = 0; i < frame_slot.ranges.size(); ++i) {
+		const RangeRecord& range = frame_slot.ranges[i];
+		if(!range.ended) {
+			continue;
+		}
+
+		GPUPassTimings& pass = passes[range.pass];
+		if(range.pipeline_statistics) {
+			pass.last_statistics = pipeline_statistics[range.statistics_query];
+			add_statistics(pass.total_statistics, pass.last_statistics);
+			++pass.statistics_samples;
+		}
+
+		const std::uint64_t begin = ticks[i * queries_per_range];
+		const std::uint64_t end = ticks[i * queries_per_range + 1];
+		if(end < begin || !timestamp_frequency[range.queue]) {
+			continue;
+		}
+
+		const double ms = static_cast<double>(end - begin) * 1e3 / timestamp_frequency[range.queue];
+		pass.min_ms = pass.samples ? std::min(pass.min_ms, ms) : ms;
+		pass.max_ms = pass.samples ? std::max(pass.max_ms, ms) : ms;
+		pass.last_ms = ms;
+		pass.total_ms += ms;
+		++pass.samples;
+	}
+
+	device.unmap_buffer(readback_buffer, 0, 0);
+	if(read_statistics) {
+		device.unmap_buffer(statistics_buffer, 0, 0);
+	}
+
+	frame_slot.ranges.clear();
+	++statistics.resolved_frames;
+}
+
+std::uint32_t GPUProfiler::get_pass_index(const char* name) {
+	if(const GPUPassTimings* pass = find_pass(name)) {
+		return static_cast<std::uint32_t>(pass - passes.data());
+	}
+
+	GPUPassTimings& pass = passes.emplace_back();
+	const std::size_t name_length = std::min(std::strlen(name), GPU::max_scope_label_length - 1);
+	std::memcpy(pass.name, name, name_length);
+	pass.name[name_length] = '\0';
+
+	return static_cast<std::uint32_t>(passes.size() - 1);
+}
+
+GPUProfileScope::GPUProfileScope(Frame& frame, const char* label) :
+	frame(frame),
+	scope(frame.get_command_buffer(), label),
+	range(frame.begin_gpu_range(label, true)) {
+}
+
+GPUProfileScope::~GPUProfileScope() {
+	frame.end_gpu_range(range);
+}
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <CD/GPU/CommandBuffer.hpp>
+#include <CD/GPU/Device.hpp>
+#include <ostream>
+#include <vector>
+
+namespace CD {
+
+class Frame;
+
+struct GPURange {
+	std::uint32_t index;
+	GPU::CommandQueueType queue;
+};
+
+struct GPUPassTimings {
+	char name[GPU::max_scope_label_length];
+	std::uint64_t samples;
+	double last_ms;
+	double total_ms;
+	double min_ms;
+	double max_ms;
+	std::uint64_t statistics_samples;
+	GPU::PipelineStatistics last_statistics;
+	GPU::PipelineStatistics total_statistics;
+};
+
+struct GPUProfilerStatistics {
+	std::uint64_t resolved_frames;
+	std::uint64_t dropped_ranges;
+	std::uint32_t range_capacity;
+};
+
+// Times named ranges of GPU commands with pairs of timestamp queries, ranges opened with pipeline statistics also
+// count the work recorded in them. Each of the latency frame slots owns a block of the query heaps and the matching
+// regions of the readback buffers, a range resolves its queries when it ends. A slot is read back when it is reused
+// latency frames later, its fences have completed by then. Ranges past the capacity of a frame are dropped and the
+// capacity doubles at the next frame. Retained command buffers collect their pipeline statistics in queries reserved
+// per slot ahead of the ranges, those keep their index when the capacity grows.
+class GPUProfiler {
+public:
+	GPUProfiler(GPU::Device&, std::uint32_t latency);
+	~GPUProfiler();
+
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+	void begin_frame(std::uint32_t slot);
+	void end_frame(const GPU::Signal* fences, std::size_t num_fences);
+	void read_back();
+
+	// Both ends of a range are recorded to the same queue and outside of render passes. They may be in different
+	// command buffers unless the range collects pipeline statistics.
+	GPURange begin_range(GPU::CommandBuffer&, GPU::CommandQueueType, const char* name, bool pipeline_statistics = false);
+	void end_range(GPU::CommandBuffer&, const GPURange&);
+
+	// A retained command buffer begins and ends the statistics query of its pass for the slot it is executed in, the
+	// range around it only resolves that query.
+	std::uint32_t get_retained_statistics_query(std::uint32_t slot, const char* name);
+	GPURange begin_retained_range(GPU::CommandBuffer&, GPU::CommandQueueType, const char* name);
+	void set_pipeline_statistics(bool enable);
+
+	std::size_t get_pass_count() const;
+	const GPUPassTimings& get_pass(std::size_t index) const;
+	const GPUPassTimings* find_pass(const char* name) const;
+	double get_average_ms(std::size_t index) const;
+	GPU::PipelineStatistics get_average_statistics(std::size_t index) const;
+
+	const GPUProfilerStatistics& get_statistics() const;
+	void reset_statistics();
+
+	void write_report(std::ostream&) const;
+private:
+	struct RangeRecord {
+		std::uint32_t pass;
+		std::uint32_t statistics_query;
+		GPU::CommandQueueType queue;
+		bool pipeline_statistics;
+		bool retained_statistics;
+		bool ended;
+	};
+
+	struct FrameSlot {
+		std::vector<RangeRecord> ranges;
+		GPU::Signal fences[GPU::CommandQueueType_Count];
+	};
+
+	GPU::Device& device;
+	std::uint64_t timestamp_frequency[GPU::CommandQueueType_Count];
+
+	std::vector<FrameSlot> slots;
+	std::uint32_t current_slot;
+	std::uint32_t range_capacity;
+	bool grow;
+	bool pipeline_statistics_enabled;
+
+	GPU::BufferHandle readback_buffer;
+	GPU::BufferHandle statistics_buffer;
+	std::vector<GPUPassTimings> passes;
+	std::vector<std::uint32_t> retained_passes;
+
+	GPUProfilerStatistics statistics;
+
+	GPURange add_range(GPU::CommandBuffer&, GPU::CommandQueueType, const char* name, bool pipeline_statistics, bool retained_statistics);
+	std::uint32_t get_retained_query_count() const;
+	void create_readback_buffers();
+	void destroy_readback_buffers();
+	void read_slot(FrameSlot&, std::uint32_t slot);
+	std::uint32_t get_pass_index(const char* name);
+};
+
+// Opens a command scope and a profiler range of the same name collecting pipeline statistics for its lifetime.
+class GPUProfileScope {
+public:
+	GPUProfileScope(Frame&, const char* label);
+	GPUProfileScope(const GPUProfileScope&) = delete;
+	GPUProfileScope(GPUProfileScope&&) = delete;
+	GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+	GPUProfileScope& operator=(GPUProfileScope&&) = delete;
+	~GPUProfileScope();
+private:
+	Frame& frame;
+	GPU::CommandScope scope;
+	GPURange range;
+};
+
+inline std::size_t GPUProfiler::get_pass_count() const {
+	return passes.size();
+}
+
+inline const GPUPassTimings& GPUProfiler::get_pass(std::size_t index) const {
+	return passes[index];
+}
+
+inline double GPUProfiler::get_average_ms(std::size_t index) const {
+	const GPUPassTimings& pass = passes[index];
+	return pass.samples ? pass.total_ms / pass.samples : 0.;
+}
+
+inline void GPUProfiler::set_pipeline_statistics(bool enable) {
+	pipeline_statistics_enabled = enable;
+}
+
+inline const GPUProfilerStatistics& GPUProfiler::get_statistics() const {
+	return statistics;
+}
+
+}
@@ -1,4 +1,7 @@
 #include <CD/Graphics/GraphicsManager.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <CD/Common/AllocationTracker.hpp>
+#include <CD/Common/Clock.hpp>
 
 namespace CD {
 
@@ -9,7 +12,9 @@ GraphicsManager::GraphicsManager(GPU::Device& device, float width, float height)
 	material_system(device),
 	renderer(frame),
 	sky(frame),
-	render_pipeline(frame, renderer, sky, material_system) {
+	render_pipeline(frame, renderer, sky, material_system),
+	frame_statistics(),
+	last_render_end() {
 }
 
 RenderPipeline& GraphicsManager::get_render_pipeline() {
@@ -36,14 +41,61 @@ Sky& GraphicsManager::get_sky() {
 	return sky;
 }
 
+FrameStatistics& GraphicsManager::get_frame_statistics() {
+	return frame_statistics;
+}
+
 void GraphicsManager::render() {
-	frame.begin();
+	CD_PROFILE_FRAME();
+	CD_PROFILE_SCOPE("GraphicsManager::render");
+	CD_MEMORY_FRAME();
+	CD_MEMORY_TAG(MemoryTag_Graphics);
+	CD_NO_ALLOCATION_SCOPE();
+
+	{
+		CD_PROFILE_SCOPE("Frame::begin");
+		frame.begin();
+	}
+
+	std::uint64_t build_begin = Clock::timestamp_ns();
+	{
+		CD_PROFILE_SCOPE("Scene::update_data");
+		scene.update_data();
+	}
 
-	scene.update_data();
 	renderer.build(scene.get_camera());
-	render_pipeline.render(scene);
 
-	frame.present();
+	{
+		CD_PROFILE_SCOPE("RenderPipeline::render");
+		render_pipeline.render(scene);
+	}
+
+	std::uint64_t present_begin = Clock::timestamp_ns();
+	{
+		CD_PROFILE_SCOPE("Frame::present");
+		frame.present();
+	}
+
+	std::uint64_t render_end = Clock::timestamp_ns();
+	if(last_render_end) {
+		FrameTimings timings {};
+		timings.frame_ns = render_end - last_render_end;
+		timings.stage_ns[FrameStage_FenceWait] = frame.get_fence_wait_ns();
+		timings.stage_ns[FrameStage_Build] = present_begin - build_begin;
+		timings.stage_ns[FrameStage_CopyWait] = frame.get_copy_wait_ns();
+		timings.stage_ns[FrameStage_Present] = render_end - present_begin - frame.get_copy_wait_ns() - frame.get_pacing_wait_ns();
+		timings.stage_ns[FrameStage_Pacing] = frame.get_pacing_wait_ns();
+
+		std::uint64_t measured = timings.stage_ns[FrameStage_FenceWait] + timings.stage_ns[FrameStage_Build] + render_end - present_begin;
+		timings.stage_ns[FrameStage_Other] = timings.frame_ns > measured ? timings.frame_ns - measured : 0;
+
+		frame_statistics.add_frame(timings);
+		frame_statistics.add_submit_statistics(frame.get_submit_statistics());
+#if CD_ALLOCATION_TRACKING
+		frame_statistics.add_allocation_statistics(Memory::get_frame_stats());
+#endif
+	}
+	last_render_end = render_end;
 }
 
 void GraphicsManager::resize(float width, float height) {
@@ -4,6 +4,7 @@
 #include <CD/Graphics/Renderer.hpp>
 #include <CD/Graphics/Sky.hpp>
 #include <CD/Graphics/Frame.hpp>
+#include <CD/Graphics/FrameStatistics.hpp>
 #include <CD/GPU/Device.hpp>
 
 namespace CD {
@@ -18,6 +19,7 @@ public:
 	Scene& get_scene();
 	MaterialSystem& get_material_system();
 	Sky& get_sky();
+	FrameStatistics& get_frame_statistics();
 
 	void render();
 	void resize(float width, float height);
@@ -31,6 +33,9 @@ private:
 	Renderer renderer;
 	Sky sky;
 	RenderPipeline render_pipeline;
+
+	FrameStatistics frame_statistics;
+	std::uint64_t last_render_end;
 };
 
 }
\ No newline at end of file
@@ -17,7 +17,7 @@ Lighting::Lighting(Frame& frame, MaterialSystem& material_system) :
 		GPU::ShaderStage::Compute
 	};
 	auto shader = compiler.compile_shader(shader_desc);
-	desc.compute_shader = {shader->GetBufferPointer(), shader->GetBufferSize()};
+	desc.compute_shader = {shader->bytecode.get(), shader->size};
 
 	GPU::PipelineInputLayout layout {};
 	set_default_samplers(layout);
@@ -73,9 +73,17 @@ void Lighting::apply(GPU::CommandBuffer& command_buffer, const Scene& scene, GPU
 }
 
 Tonemapper::Tonemapper(Frame& frame) :
-	frame(frame) {
+	frame(frame),
+	command_buffer(frame.get_command_pages()),
+	recorded_in(),
+	recorded_sky(),
+	recorded_out(),
+	recorded_x(),
+	recorded_y() {
+	command_buffer.set_retained(true);
+
 	GPU::PipelineInputLayout layout {};
-	layout.num_entries = 2;
+	layout.num_entries = 3;
 
 	layout.entries[0] = GPU::pipeline_input_list_defaults(GPU::resource_list_defaults(1, GPU::DescriptorType::SRV, 0, 0));
 	layout.entries[0].type = GPU::PipelineInputGroupType::ResourceList;
@@ -83,6 +91,9 @@ Tonemapper::Tonemapper(Frame& frame) :
 	layout.entries[1] = GPU::pipeline_input_list_defaults(GPU::resource_list_defaults(1, GPU::DescriptorType::UAV, 0, 0));
 	layout.entries[1].type = GPU::PipelineInputGroupType::ResourceList;
 
+	layout.entries[2] = GPU::pipeline_input_list_defaults(GPU::resource_list_defaults(1, GPU::DescriptorType::SRV, 1, 0));
+	layout.entries[2].type = GPU::PipelineInputGroupType::ResourceList;
+
 	GPU::ComputePipelineDesc tonemapping_pipeline_desc;
 	GPU::CompileShaderDesc cs_desc {
 		L"Resources/Shaders/Tonemapping.hlsl",
@@ -91,32 +102,50 @@ Tonemapper::Tonemapper(Frame& frame) :
 	};
 	auto cs = frame.get_shader_compiler().compile_shader(cs_desc);
 
-	tonemapping_pipeline_desc.compute_shader = {cs->GetBufferPointer(), cs->GetBufferSize()};
+	tonemapping_pipeline_desc.compute_shader = {cs->bytecode.get(), cs->size};
 
 	tonemapping_pipeline = frame.create_pipeline(tonemapping_pipeline_desc, layout);
 }
 
-void Tonemapper::apply(GPU::CommandBuffer& cb, GPU::PipelineHandle in, GPU::PipelineHandle out) {
-	GPU::PipelineInputState state {};
+void Tonemapper::apply(GPU::PipelineHandle in, GPU::PipelineHandle sky, GPU::PipelineHandle out) {
+	const GPU::Viewport& viewport = frame.get_viewport();
+	const std::uint32_t x = std::uint32_t((viewport.width + 15) / 16);
+	const std::uint32_t y = std::uint32_t((viewport.height + 15) / 16);
 
-	state.num_elements = 2;
+	if(!command_buffer.get_command_count() || !(in == recorded_in) || !(sky == recorded_sky) || !(out == recorded_out) || x != recorded_x || y != recorded_y) {
+		GPU::PipelineInputState state {};
 
-	state.types[0] = GPU::PipelineInputGroupType::ResourceList;
-	state.input_elements[0].resource_list = in;
+		state.num_elements = 3;
 
-	state.types[1] = GPU::PipelineInputGroupType::ResourceList;
-	state.input_elements[1].resource_list = out;
+		state.types[0] = GPU::PipelineInputGroupType::ResourceList;
+		state.input_elements[0].resource_list = in;
 
-	const GPU::Viewport& viewport = frame.get_viewport();
+		state.types[1] = GPU::PipelineInputGroupType::ResourceList;
+		state.input_elements[1].resource_list = out;
 
-	GPU::DispatchDesc dispatch;
-	dispatch.x = std::uint32_t((viewport.width + 15) / 16);
-	dispatch.y = std::uint32_t((viewport.height + 15) / 16);
-	dispatch.z = 1;
-	dispatch.compute_pipeline = tonemapping_pipeline->handle;
-	dispatch.pipeline_input_state = state;
+		state.types[2] = GPU::PipelineInputGroupType::ResourceList;
+		state.input_elements[2].resource_list = sky;
+
+		GPU::DispatchDesc dispatch;
+		dispatch.x = x;
+		dispatch.y = y;
+		dispatch.z = 1;
+		dispatch.compute_pipeline = tonemapping_pipeline->handle;
+		dispatch.pipeline_input_state = state;
+
+		command_buffer.reset();
+		GPU::begin_scope(command_buffer, "Tonemapping");
+		command_buffer.add_command(dispatch);
+		GPU::end_scope(command_buffer);
+
+		recorded_in = in;
+		recorded_sky = sky;
+		recorded_out = out;
+		recorded_x = x;
+		recorded_y = y;
+	}
 
-	cb.add_command(dispatch);
+	frame.execute_retained(command_buffer);
 }
 
 }
\ No newline at end of file
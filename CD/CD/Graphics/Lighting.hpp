@@ -35,11 +35,18 @@ class Tonemapper {
 public:
 	Tonemapper(Frame&);
 
-	void apply(GPU::CommandBuffer&, GPU::PipelineHandle in, GPU::PipelineHandle out);
+	void apply(GPU::PipelineHandle in, GPU::PipelineHandle sky, GPU::PipelineHandle out);
 private:
 	Frame& frame;
 
 	const ComputePipeline* tonemapping_pipeline;
+
+	GPU::CommandBuffer command_buffer;
+	GPU::PipelineHandle recorded_in;
+	GPU::PipelineHandle recorded_sky;
+	GPU::PipelineHandle recorded_out;
+	std::uint32_t recorded_x;
+	std::uint32_t recorded_y;
 };
 
 }
\ No newline at end of file
@@ -5,8 +5,10 @@
 
 namespace CD {
 
-ScopedRenderPass::ScopedRenderPass(GPU::CommandBuffer& command_buffer, const GPU::PipelineHandle& render_pass, const GPU::TextureView* color_buffers, std::uint32_t num_render_targets, const GPU::TextureView& depth_stencil, bool depth_write, const GPU::Viewport& viewport) :
+ScopedRenderPass::ScopedRenderPass(GPU::CommandBuffer& command_buffer, const char* label, const GPU::PipelineHandle& render_pass, const GPU::TextureView* color_buffers, std::uint32_t num_render_targets, const GPU::TextureView& depth_stencil, bool depth_write, const GPU::Viewport& viewport) :
 	command_buffer(command_buffer) {
+	GPU::begin_scope(command_buffer, label);
+
 	GPU::BeginRenderPassDesc begin_render_pass {};
 
 	begin_render_pass.render_pass = render_pass;
@@ -28,6 +30,63 @@ ScopedRenderPass::ScopedRenderPass(GPU::CommandBuffer& command_buffer, const GPU
 ScopedRenderPass::~ScopedRenderPass() {
 	GPU::EndRenderPassDesc end_render_pass;
 	command_buffer.add_command(end_render_pass);
+
+	GPU::end_scope(command_buffer);
+}
+
+RetainedPass::RetainedPass(Frame& frame, const char* name) :
+	frame(frame),
+	name(name) {
+	for(RecordedCommands& commands : recorded) {
+		commands.command_buffer = std::make_unique<GPU::CommandBuffer>(frame.get_command_pages());
+		commands.command_buffer->set_retained(true);
+		commands.version = 0;
+		commands.texture_generation = 0;
+		commands.width = 0.f;
+		commands.height = 0.f;
+		commands.recording = false;
+	}
+}
+
+GPU::CommandBuffer* RetainedPass::begin(std::uint64_t version) {
+	RecordedCommands& commands = recorded[frame.get_frame_index()];
+	const GPU::Viewport& viewport = frame.get_viewport();
+
+	if(commands.command_buffer->get_command_count()
+		&& commands.version == version
+		&& commands.texture_generation == frame.get_texture_generation()
+		&& commands.width == viewport.width
+		&& commands.height == viewport.height) {
+		return nullptr;
+	}
+
+	commands.command_buffer->reset();
+	commands.version = version;
+	commands.texture_generation = frame.get_texture_generation();
+	commands.width = viewport.width;
+	commands.height = viewport.height;
+	commands.recording = true;
+
+	GPU::BeginPipelineStatisticsDesc begin_statistics;
+	begin_statistics.index = frame.get_gpu_profiler().get_retained_statistics_query(frame.get_frame_index(), name);
+	commands.command_buffer->add_command(begin_statistics);
+
+	return commands.command_buffer.get();
+}
+
+void RetainedPass::execute() {
+	RecordedCommands& commands = recorded[frame.get_frame_index()];
+
+	if(commands.recording) {
+		GPU::EndPipelineStatisticsDesc end_statistics;
+		end_statistics.index = frame.get_gpu_profiler().get_retained_statistics_query(frame.get_frame_index(), name);
+		commands.command_buffer->add_command(end_statistics);
+		commands.recording = false;
+	}
+
+	GPURange range = frame.begin_retained_gpu_range(name);
+	frame.execute_retained(*commands.command_buffer);
+	frame.end_gpu_range(range);
 }
 
 RenderPipeline::RenderPipeline(Frame& frame, Renderer& renderer, Sky& sky, MaterialSystem& material_system) :
@@ -35,7 +94,12 @@ RenderPipeline::RenderPipeline(Frame& frame, Renderer& renderer, Sky& sky, Mater
 	renderer(renderer),
 	sky(sky),
 	lighting(frame, material_system),
-	tonemapper(frame) {
+	tonemapper(frame),
+	depth_commands(frame, "Depth"),
+	geometry_commands(frame, "Geometry"),
+	sky_commands(frame, "Sky"),
+	final_image_ready(false),
+	final_image_generation(0) {
 
 	geometry_view = frame.get_device().create_pipeline_input_list(5);
 
@@ -43,94 +107,127 @@ RenderPipeline::RenderPipeline(Frame& frame, Renderer& renderer, Sky& sky, Mater
 	create_resources();
 }
 
+// The sky is drawn into its own target and composited by the tonemapper, so it overlaps the lighting dispatch when
+// compute runs asynchronously. The image tonemapped by the previous frame is presented after the lighting dispatch,
+// the depth and geometry passes are submitted in their own batch and overlap that tonemapping. Frames are shown one
+// frame after they are rendered.
 void RenderPipeline::render(Scene& scene) {
 	execute_depth();
 	execute_geometry();
+
+	frame.begin_async_compute();
 	execute_lighting(scene);
-	execute_tonemapping();
-	execute_sky(scene);
+	frame.end_async_compute();
+
 	execute_present();
+	execute_sky(scene);
+
+	frame.begin_async_compute();
+	execute_tonemapping();
+	frame.end_async_compute();
+
+	final_image_ready = true;
+	final_image_generation = frame.get_texture_generation();
 }
 
+// The depth, geometry, sky and tonemapping passes are recorded in retained command buffers and only translated again
+// when what they draw changes. Their scopes and pipeline statistics queries are recorded in the retained buffers, they
+// cannot span command buffers. The profiler ranges can, they are timed around the retained buffers.
 void RenderPipeline::execute_depth() {
-	GPU::CommandBuffer& command_buffer = frame.get_command_buffer();
-
 	auto& depth_texture = frame.get_texture(depth_pass.depth_buffer);
-	GPU::TextureView depth_view = GPU::texture_view_defaults(depth_texture.texture.handle, depth_texture.texture.desc);
 
 	frame.bind_resources(&depth_pass.depth_buffer, 1, GPU::ResourceState::DepthWrite);
 
-	ScopedRenderPass render_pass(command_buffer, depth_pass.render_pass->handle, nullptr, 0, depth_view, true, frame.get_viewport());
+	if(GPU::CommandBuffer* command_buffer = depth_commands.begin(renderer.get_depth_version())) {
+		GPU::TextureView depth_view = GPU::texture_view_defaults(depth_texture.texture.handle, depth_texture.texture.desc);
+
+		ScopedRenderPass render_pass(*command_buffer, "DepthPass", depth_pass.render_pass->handle, nullptr, 0, depth_view, true, frame.get_viewport());
+
+		renderer.draw_depth(*command_buffer);
+	}
 
-	renderer.draw_depth(command_buffer);
+	depth_commands.execute();
 }
 
 void RenderPipeline::execute_geometry() {
-	GPU::CommandBuffer& command_buffer = frame.get_command_buffer();
-
 	FrameResourceIndex color_out[] {gbuffer.normals, gbuffer.uv, gbuffer.duv, gbuffer.material_indices};
 
 	const auto& depth_texture = frame.get_texture(depth_pass.depth_buffer);
-	GPU::TextureView depth_view = GPU::texture_view_defaults(depth_texture.texture.handle, depth_texture.texture.desc);
 
 	frame.bind_resources(color_out, std::size(color_out), GPU::ResourceState::RTV);
 	frame.bind_resources(&depth_pass.depth_buffer, 1, GPU::ResourceState::DepthRead);
 
-	ScopedRenderPass render_pass(command_buffer, gbuffer.render_pass->handle, gbuffer.view_desc, static_cast<std::uint32_t>(std::size(gbuffer.view_desc)), depth_view, false, frame.get_viewport());
+	if(GPU::CommandBuffer* command_buffer = geometry_commands.begin(renderer.get_gbuffer_version())) {
+		GPU::TextureView depth_view = GPU::texture_view_defaults(depth_texture.texture.handle, depth_texture.texture.desc);
+
+		ScopedRenderPass render_pass(*command_buffer, "GBufferPass", gbuffer.render_pass->handle, gbuffer.view_desc, static_cast<std::uint32_t>(std::size(gbuffer.view_desc)), depth_view, false, frame.get_viewport());
 
-	renderer.draw_gbuffer(command_buffer);
+		renderer.draw_gbuffer(*command_buffer);
+	}
+
+	geometry_commands.execute();
 }
 
 void RenderPipeline::execute_lighting(Scene& scene) {
 	GPU::CommandBuffer& command_buffer = frame.get_command_buffer();
+	GPUProfileScope scope(frame, "Lighting");
 
 	FrameResourceIndex gbuffer_resources[] {gbuffer.normals, gbuffer.uv, gbuffer.duv, gbuffer.material_indices};
 
 	auto& texture = frame.get_texture(lighting_out);
 
 	frame.bind_resources(gbuffer_resources, std::size(gbuffer_resources), GPU::ResourceState::Common);
+	frame.bind_resources(&depth_pass.depth_buffer, 1, GPU::ResourceState::Common);
 	frame.bind_resources(&lighting_out, 1, GPU::ResourceState::UAV);
 
-	lighting.apply(frame.get_command_buffer(), scene, geometry_view, texture.views->uav);
+	lighting.apply(command_buffer, scene, geometry_view, texture.views->uav);
 }
 
 void RenderPipeline::execute_tonemapping() {
-	GPU::CommandBuffer& command_buffer = frame.get_command_buffer();
-
 	auto& lighting_texture = frame.get_texture(lighting_out);
+	auto& sky_texture = frame.get_texture(sky_out);
 	auto& final_texture = frame.get_texture(final_image);
 
 	frame.bind_resources(&lighting_out, 1, GPU::ResourceState::Common);
+	frame.bind_resources(&sky_out, 1, GPU::ResourceState::Common);
 	frame.bind_resources(&final_image, 1, GPU::ResourceState::UAV);
 
-	tonemapper.apply(command_buffer, lighting_texture.views->srv, final_texture.views->uav);
+	GPURange range = frame.begin_gpu_range("Tonemapping");
+	tonemapper.apply(lighting_texture.views->srv, sky_texture.views->srv, final_texture.views->uav);
+	frame.end_gpu_range(range);
 }
 
 void RenderPipeline::execute_sky(Scene& scene) {
-	GPU::CommandBuffer& command_buffer = frame.get_command_buffer();
+	auto& render_texture = frame.get_texture(sky_out);
 
-	const auto& depth_texture = frame.get_texture(depth_pass.depth_buffer);
-	GPU::TextureView depth_view = GPU::texture_view_defaults(depth_texture.texture.handle, depth_texture.texture.desc);
+	frame.bind_resources(&sky_out, 1, GPU::ResourceState::RTV);
 
-	auto& render_texture = frame.get_texture(final_image);
-	GPU::TextureView render_view = GPU::texture_view_defaults(render_texture.texture.handle, render_texture.texture.desc);
+	sky.update(scene.get_camera());
 
-	frame.bind_resources(&final_image, 1, GPU::ResourceState::RTV);
-	frame.bind_resources(&depth_pass.depth_buffer, 1, GPU::ResourceState::DepthRead);
+	if(GPU::CommandBuffer* command_buffer = sky_commands.begin(sky.get_version())) {
+		GPU::TextureView render_view = GPU::texture_view_defaults(render_texture.texture.handle, render_texture.texture.desc);
+
+		ScopedRenderPass render_pass(*command_buffer, "SkyPass", sky_pass.render_pass->handle, &render_view, 1, {}, false, frame.get_viewport());
 
-	ScopedRenderPass render_pass(command_buffer, sky_pass.render_pass->handle, &render_view, 1, depth_view, false, frame.get_viewport());
+		sky.render(*command_buffer);
+	}
 
-	sky.render(command_buffer, scene.get_camera());
+	sky_commands.execute();
 }
 
+// Nothing is copied before the first frame is tonemapped or once the frame textures are recreated.
 void RenderPipeline::execute_present() {
+	if(!final_image_ready || final_image_generation != frame.get_texture_generation()) {
+		return;
+	}
+
 	auto& final_texture = frame.get_texture(final_image);
 
 	GPU::CommandBuffer& command_buffer = frame.get_command_buffer();
+	GPUProfileScope scope(frame, "Present");
 
 	GPU::CopyToSwapChainDesc copy;
 	copy.texture = GPU::texture_view_defaults(final_texture.texture.handle, final_texture.texture.desc);
-	copy.texture_state = final_texture.state;
 
 	command_buffer.add_command(copy);
 }
@@ -166,16 +263,13 @@ void RenderPipeline::create_render_passes() {
 		GPU::RenderPassDesc sky_pass_desc {};
 
 		GPU::RenderPassRenderTargetDesc rt {
-			GPU::RenderPassBeginOp::Preserve,
+			GPU::RenderPassBeginOp::Clear,
 			GPU::RenderPassEndOp::Preserve,
 			GPU::BufferFormat::R8G8B8A8_UNORM
 		};
 
-		GPU::RenderPassDepthStencilTargetDesc ds = GPU::render_pass_depth_stencil_defaults(GPU::RenderPassBeginOp::Preserve);
-
 		sky_pass_desc.num_render_targets = 1;
 		sky_pass_desc.render_targets[0] = rt;
-		sky_pass_desc.depth_stencil_target = &ds;
 
 		sky_pass.render_pass = frame.create_render_pass(sky_pass_desc);
 	}
@@ -221,6 +315,11 @@ void RenderPipeline::create_resources() {
 		lighting_out = frame.add_texture(lighting_output);
 	}
 
+	{
+		GPU::TextureDesc sky_output = GPU::texture_desc_defaults(w, h, GPU::BufferFormat::R8G8B8A8_UNORM, GPU::TextureDimension::Texture2D, 1, 1, static_cast<GPU::BindFlags>(GPU::BindFlags_ShaderResource | GPU::BindFlags_RenderTarget));
+		sky_out = frame.add_texture(sky_output);
+	}
+
 	{
 		GPU::TextureDesc final_texture_desc = GPU::texture_desc_defaults(w, h, GPU::BufferFormat::R8G8B8A8_UNORM, GPU::TextureDimension::Texture2D, 1, 1, static_cast<GPU::BindFlags>(GPU::BindFlags_RW | GPU::BindFlags_RenderTarget));
 		final_image = frame.add_texture(final_texture_desc);
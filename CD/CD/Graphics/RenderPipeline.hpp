@@ -2,13 +2,14 @@
 
 #include <CD/Graphics/Frame.hpp>
 #include <CD/Graphics/Lighting.hpp>
+#include <memory>
 #include <vector>
 
 namespace CD {
 
 class ScopedRenderPass {
 public:
-	ScopedRenderPass(GPU::CommandBuffer&, const GPU::PipelineHandle& render_pass, const GPU::TextureView* color_buffers, std::uint32_t num_render_targets, const GPU::TextureView& depth_stencil, bool depth_write, const GPU::Viewport&);
+	ScopedRenderPass(GPU::CommandBuffer&, const char* label, const GPU::PipelineHandle& render_pass, const GPU::TextureView* color_buffers, std::uint32_t num_render_targets, const GPU::TextureView& depth_stencil, bool depth_write, const GPU::Viewport&);
 	ScopedRenderPass(const ScopedRenderPass&) = delete;
 	ScopedRenderPass(ScopedRenderPass&&) = delete;
 	ScopedRenderPass& operator=(const ScopedRenderPass&) = delete;
@@ -18,6 +19,32 @@ private:
 	GPU::CommandBuffer& command_buffer;
 };
 
+// A pass recorded into a retained command buffer for each frame in flight. The commands of a frame are recorded again
+// when the version passed by the caller, the viewport or the frame textures change, the per frame data they read is
+// written to the same location for the frame, see FrameDataBuffer. begin returns nullptr when the commands are reused.
+// The commands of a frame collect their pipeline statistics in the query the profiler reserves for the pass and the
+// frame slot, execute times them and resolves that query.
+class RetainedPass {
+public:
+	RetainedPass(Frame&, const char* name);
+
+	GPU::CommandBuffer* begin(std::uint64_t version);
+	void execute();
+private:
+	struct RecordedCommands {
+		std::unique_ptr<GPU::CommandBuffer> command_buffer;
+		std::uint64_t version;
+		std::uint64_t texture_generation;
+		float width;
+		float height;
+		bool recording;
+	};
+
+	Frame& frame;
+	const char* name;
+	RecordedCommands recorded[Frame::max_latency];
+};
+
 class Renderer;
 class Sky;
 
@@ -36,6 +63,10 @@ private:
 	Lighting lighting;
 	Tonemapper tonemapper;
 
+	RetainedPass depth_commands;
+	RetainedPass geometry_commands;
+	RetainedPass sky_commands;
+
 	struct DepthPass {
 		const RenderPass* render_pass;
 
@@ -64,7 +95,10 @@ private:
 	SkyboxPass sky_pass;
 
 	FrameResourceIndex lighting_out;
+	FrameResourceIndex sky_out;
 	FrameResourceIndex final_image;
+	bool final_image_ready;
+	std::uint64_t final_image_generation;
 
 	GPU::PipelineHandle geometry_view;
 
@@ -1,29 +1,37 @@
 #include <CD/Graphics/Renderer.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <CD/Common/AllocationTracker.hpp>
 #include <algorithm>
+#include <functional>
 #include <DirectXCollision.h>
 
 namespace CD {
 
-RenderQueue::RenderQueue(RenderQueueConsumer type) :
+RenderQueue::RenderQueue(RenderQueueConsumer type, Frame& frame) :
 	type(type),
-	buffer_allocator(nullptr),
+	frame(frame),
+	queue_data(frame.get_device(), Frame::max_latency),
+	instance_data(frame.get_device(), Frame::max_latency),
 	queue_data_buffer(),
-	copy_fence() {
+	instance_buffer(),
+	previous_batches(),
+	batch_version(),
+	indices(frame.get_frame_allocator()),
+	meshes(frame.get_frame_allocator()),
+	sort_keys(frame.get_frame_allocator()),
+	batches(frame.get_frame_allocator()),
+	instance_transforms(frame.get_frame_allocator()) {
 }
 
-void RenderQueue::setup(GPUBufferAllocator& allocator, const void* queue_data, std::uint32_t num_bytes) {
-	buffer_allocator = &allocator;
-	queue_data_buffer = buffer_allocator->create_buffer(num_bytes, queue_data);
+void RenderQueue::setup(const void* data, std::uint32_t num_bytes) {
+	queue_data_buffer = queue_data.write(frame.get_frame_index(), data, num_bytes);
 }
 
 void RenderQueue::add_mesh(const MaterialInstance* material, const Mesh& mesh, const Matrix4x4&, std::uint32_t transform_index) {
 	MeshInstance instance;
 	instance.mesh = &mesh;
 	instance.material = material;
-
-	std::uint32_t material_index = material ? material->get_constants().index : 0;
-	MeshInstanceBuffer instance_constants {transform_index, material_index};
-	instance.instance_data = buffer_allocator->create_buffer(sizeof(MeshInstanceBuffer), &instance_constants);
+	instance.transform_index = transform_index;
 
 	meshes.push_back(instance);
 	sort_keys.push_back(0);
@@ -31,34 +39,65 @@ void RenderQueue::add_mesh(const MaterialInstance* material, const Mesh& mesh, c
 }
 
 void RenderQueue::build() {
-	buffer_allocator->update_data();
-	copy_fence = buffer_allocator->flush();
+	build_batches();
+
+	auto same_batch = [](const MeshBatch& l, const MeshBatch& r) {
+		return l.material == r.material && l.mesh == r.mesh && l.first_instance == r.first_instance && l.num_instances == r.num_instances;
+	};
 
-	if(type == RenderQueueConsumer_DepthPass) {
-		std::stable_sort(indices.begin(), indices.end(), [this](std::uint32_t l, std::uint32_t r) { return sort_keys[l] < sort_keys[r]; });
+	if(batches.size() != previous_batches.size() || !std::equal(batches.begin(), batches.end(), previous_batches.begin(), same_batch)) {
+		previous_batches.assign(batches.begin(), batches.end());
+		++batch_version;
 	}
 }
 
-void RenderQueue::reset() {
-	indices.clear();
-	meshes.clear();
-	sort_keys.clear();
+void RenderQueue::reset(LinearAllocator& frame_allocator) {
+	rebind_arena_vector(indices, frame_allocator);
+	rebind_arena_vector(meshes, frame_allocator);
+	rebind_arena_vector(sort_keys, frame_allocator);
+	rebind_arena_vector(batches, frame_allocator);
+	rebind_arena_vector(instance_transforms, frame_allocator);
+}
+
+void RenderQueue::build_batches() {
+	std::sort(indices.begin(), indices.end(), [this](std::uint32_t l, std::uint32_t r) {
+		if(sort_keys[l] != sort_keys[r]) {
+			return sort_keys[l] < sort_keys[r];
+		}
+		if(meshes[l].mesh != meshes[r].mesh) {
+			return std::less<const Mesh*>()(meshes[l].mesh, meshes[r].mesh);
+		}
+		if(meshes[l].material != meshes[r].material) {
+			return std::less<const MaterialInstance*>()(meshes[l].material, meshes[r].material);
+		}
+		return l < r;
+	});
+
+	for(std::uint32_t index : indices) {
+		const MeshInstance& instance = meshes[index];
+
+		if(batches.empty() || batches.back().mesh != instance.mesh || batches.back().material != instance.material) {
+			batches.push_back({instance.material, instance.mesh, static_cast<std::uint32_t>(instance_transforms.size()), 0});
+		}
+
+		++batches.back().num_instances;
+		instance_transforms.push_back(instance.transform_index);
+	}
+
+	const std::uint32_t num_instances = static_cast<std::uint32_t>(instance_transforms.size());
+	instance_buffer = instance_data.write(frame.get_frame_index(), num_instances ? instance_transforms.data() : nullptr, std::max(num_instances, 1u) * sizeof(std::uint32_t));
 }
 
 const BufferAllocation& RenderQueue::get_buffer() const {
 	return queue_data_buffer;
 }
 
-const std::vector<MeshInstance>& RenderQueue::get_meshes() const {
-	return meshes;
-};
-
-const std::vector<std::uint32_t>& RenderQueue::get_indices() const {
-	return indices;
+const BufferAllocation& RenderQueue::get_instance_buffer() const {
+	return instance_buffer;
 }
 
-const GPU::Signal& RenderQueue::get_copy_fence() const {
-	return copy_fence;
+const ArenaVector<MeshBatch>& RenderQueue::get_batches() const {
+	return batches;
 }
 
 std::uint64_t RenderQueue::get_sort_key(const Mesh& mesh, float depth, const MaterialInstance* material) {
@@ -77,18 +116,38 @@ std::uint64_t RenderQueue::get_sort_key(const Mesh& mesh, float depth, const Mat
 	return 0;
 }
 
-static void set_input_buffer(GPU::DrawDesc& desc, const IndexedInputBuffer& buffer) {
-	desc.input_buffer = buffer.input_buffer;
-	desc.index_buffer = buffer.index_buffer;
-	desc.index_buffer_size = buffer.index_buffer_size;
-	desc.num_instances = 1;
-	desc.num_elements = buffer.num_indices;
-	desc.num_vertex_buffers = MeshVertexElement_Count;
-	for(std::size_t element_index = 0; element_index < MeshVertexElement_Count; ++element_index) {
-		desc.vertex_buffer_offsets[element_index] = buffer.vertex_buffer_offsets[element_index];
-		desc.vertex_buffer_strides[element_index] = buffer.vertex_buffer_strides[element_index];
-		desc.vertex_buffer_sizes[element_index] = buffer.vertex_buffer_sizes[element_index];
+static void set_input_buffer(GPU::CommandBuffer& command_buffer, std::uint32_t slot, const BufferAllocation& buffer, GPU::DescriptorType type) {
+	GPU::SetInputGroupDesc desc {};
+	desc.slot = slot;
+	desc.type = GPU::PipelineInputGroupType::Buffer;
+	desc.input.buffer = {buffer.handle, buffer.offset, type};
+	command_buffer.add_command(desc);
+}
+
+static void set_vertex_input(GPU::CommandBuffer& command_buffer, const IndexedInputBuffer& buffer, std::uint32_t num_streams) {
+	GPU::SetVertexStreamsDesc streams {};
+	streams.input_buffer = buffer.input_buffer;
+	streams.num_streams = num_streams;
+	for(std::size_t element_index = 0; element_index < num_streams; ++element_index) {
+		streams.streams[element_index] = {
+			buffer.vertex_buffer_offsets[element_index],
+			buffer.vertex_buffer_sizes[element_index],
+			buffer.vertex_buffer_strides[element_index]
+		};
 	}
+	command_buffer.add_command(streams, GPU::vertex_streams_command_size(num_streams));
+
+	GPU::SetIndexBufferDesc index_buffer {};
+	index_buffer.index_buffer = buffer.index_buffer;
+	index_buffer.size = buffer.index_buffer_size;
+	command_buffer.add_command(index_buffer);
+}
+
+static void draw_indexed(GPU::CommandBuffer& command_buffer, const IndexedInputBuffer& buffer, std::uint32_t num_instances) {
+	GPU::DrawIndexedDesc draw {};
+	draw.num_indices = buffer.num_indices;
+	draw.num_instances = num_instances;
+	command_buffer.add_command(draw);
 }
 
 static bool frustum_aabb_intersection(const AABB& aabb, const Matrix4x4& transform, const Camera& camera) {
@@ -117,16 +176,23 @@ static bool frustum_aabb_intersection(const AABB& aabb, const Matrix4x4& transfo
 
 Renderer::Renderer(Frame& frame) :
 	frame(frame),
-	gbuffer_queue(RenderQueueConsumer_Geometry),
-	depth_queue(RenderQueueConsumer_DepthPass),
-	transform_buffer(),
-	upload_fence() {
+	gbuffer_queue(RenderQueueConsumer_Geometry, frame),
+	depth_queue(RenderQueueConsumer_DepthPass, frame),
+	frame_models(frame.get_frame_allocator()),
+	frame_transforms(frame.get_frame_allocator()),
+	transform_data(frame.get_device(), Frame::max_latency),
+	transform_buffer() {
+
+	for(auto& components : frame_transform_components) {
+		rebind_arena_vector(components, frame.get_frame_allocator());
+	}
 
 	GPU::PipelineInputLayout layout {};
 	layout.num_entries = RendererInputSlot_Count;
 	layout.entries[RendererInputSlot_Transforms] = GPU::pipeline_input_buffer_defaults(GPU::DescriptorType::SRV, 0, 0);
 	layout.entries[RendererInputSlot_RenderQueueConstants] = GPU::pipeline_input_buffer_defaults(GPU::DescriptorType::CBV, 0, 0);
-	layout.entries[RendererInputSlot_MeshInstance] = GPU::pipeline_input_buffer_defaults(GPU::DescriptorType::CBV, 1, 0);
+	layout.entries[RendererInputSlot_MeshInstances] = GPU::pipeline_input_buffer_defaults(GPU::DescriptorType::SRV, 1, 0);
+	layout.entries[RendererInputSlot_DrawConstants] = GPU::pipeline_input_constants_defaults(sizeof(DrawConstants) / sizeof(std::uint32_t), 1, 0);
 
 	GPU::ShaderCompiler& compiler = frame.get_shader_compiler();
 
@@ -140,7 +206,7 @@ Renderer::Renderer(Frame& frame) :
 		GPU::ShaderPtr depth_vs = compiler.compile_shader(vs_desc);
 
 		GPU::GraphicsPipelineDesc depth_pipeline_desc = GPU::graphics_pipeline_defaults(0);
-		depth_pipeline_desc.vs = {depth_vs->GetBufferPointer(), depth_vs->GetBufferSize()};
+		depth_pipeline_desc.vs = {depth_vs->bytecode.get(), depth_vs->size};
 
 		GPU::InputElement vertex_elements[] {
 			GPU::input_element_defaults("POSITION", GPU::BufferFormat::R32G32B32_FLOAT, 0, 0),
@@ -171,8 +237,8 @@ Renderer::Renderer(Frame& frame) :
 		GPU::ShaderPtr gbuffer_ps = compiler.compile_shader(ps_desc);
 
 		GPU::GraphicsPipelineDesc gbuffer_desc = GPU::graphics_pipeline_defaults(static_cast<std::uint32_t>(std::size(gbuffer_render_target_formats)));
-		gbuffer_desc.vs = {gbuffer_vs->GetBufferPointer(), gbuffer_vs->GetBufferSize()};
-		gbuffer_desc.ps = {gbuffer_ps->GetBufferPointer(), gbuffer_ps->GetBufferSize()};
+		gbuffer_desc.vs = {gbuffer_vs->bytecode.get(), gbuffer_vs->size};
+		gbuffer_desc.ps = {gbuffer_ps->bytecode.get(), gbuffer_ps->size};
 
 		GPU::InputElement vertex_elements[] {
 			GPU::input_element_defaults("POSITION", GPU::BufferFormat::R32G32B32_FLOAT, 0, 0),
@@ -197,21 +263,31 @@ Renderer::Renderer(Frame& frame) :
 void Renderer::add_model(const Model* model, const Transform& transform) {
 	frame_models.push_back(model);
 
-	frame_transforms.push_back(matrix_transform(transform));
+	const float components[TransformComponent_Count] {
+		transform.orientation.x, transform.orientation.y, transform.orientation.z, transform.orientation.w,
+		transform.position.x, transform.position.y, transform.position.z,
+		transform.scale.x, transform.scale.y, transform.scale.z
+	};
+	for(std::size_t component = 0; component < TransformComponent_Count; ++component) {
+		frame_transform_components[component].push_back(components[component]);
+	}
 }
 
 void Renderer::build(const Camera& camera) {
+	CD_PROFILE_SCOPE("Renderer::build");
+	CD_MEMORY_TAG(MemoryTag_RenderQueue);
+
 	copy_frame_data();
 
 	GBufferConstants gbuffer_constants {
 		camera.get_view_projection()
 	};
-	gbuffer_queue.setup(frame.get_buffer_allocator(), &gbuffer_constants, sizeof(GBufferConstants));
+	gbuffer_queue.setup(&gbuffer_constants, sizeof(GBufferConstants));
 
 	DepthPassConstants depth_constants {
 		camera.get_view_projection()
 	};
-	depth_queue.setup(frame.get_buffer_allocator(), &depth_constants, sizeof(DepthPassConstants));
+	depth_queue.setup(&depth_constants, sizeof(DepthPassConstants));
 	
 	for(std::size_t model_index = 0; model_index < frame_models.size(); ++model_index) {
 		const auto& meshes = frame_models[model_index]->get_meshes();
@@ -229,119 +305,99 @@ void Renderer::build(const Camera& camera) {
 		}
 	}
 
-	depth_queue.build();
-	gbuffer_queue.build();
+	{
+		CD_PROFILE_SCOPE("RenderQueue::build");
+		depth_queue.build();
+		gbuffer_queue.build();
+	}
 }
 
 void Renderer::clear_render_state() {
-	depth_queue.reset();
-	gbuffer_queue.reset();
+	LinearAllocator& frame_allocator = frame.get_frame_allocator();
 
-	frame_models.clear();
-	frame_transforms.clear();
+	depth_queue.reset(frame_allocator);
+	gbuffer_queue.reset(frame_allocator);
+
+	rebind_arena_vector(frame_models, frame_allocator);
+	rebind_arena_vector(frame_transforms, frame_allocator);
+	for(auto& components : frame_transform_components) {
+		rebind_arena_vector(components, frame_allocator);
+	}
 }
 
 void Renderer::draw_gbuffer(GPU::CommandBuffer& command_buffer) {
-	GPU::PipelineInputState input_state {};
-	input_state.num_elements = RendererInputSlot_Count;
-
-	set_global_state(input_state);
-	set_render_queue_state(input_state, gbuffer_queue);
-
-	const GPU::Viewport& vp = frame.get_viewport();
-
-	for(const MeshInstance& instance : gbuffer_queue.get_meshes()) {
-		const IndexedInputBuffer& input_buffer = instance.mesh->get_input_buffer();
-
-		set_instance_state(input_state, instance);
-
-		GPU::DrawDesc draw_desc {};
-		draw_desc.graphics_pipeline = gbuffer_pipeline->handle;
-		draw_desc.pipeline_input_state = input_state;
-
-		draw_desc.rect = {
-			0,
-			0,
-			static_cast<std::uint32_t>(vp.width),
-			static_cast<std::uint32_t>(vp.height)
-		};
-
-		set_input_buffer(draw_desc, input_buffer);
-
-		command_buffer.add_command(draw_desc);
-	}
+	begin_draw(command_buffer, *gbuffer_pipeline, gbuffer_queue);
+	draw_batches(command_buffer, gbuffer_queue, MeshVertexElement_Count);
 }
 
 void Renderer::draw_depth(GPU::CommandBuffer& command_buffer) {
-	GPU::PipelineInputState input_state {};
-	input_state.num_elements = RendererInputSlot_Count;
+	begin_draw(command_buffer, *depth_pipeline, depth_queue);
+	draw_batches(command_buffer, depth_queue, 1);
+}
 
-	set_global_state(input_state);
-	set_render_queue_state(input_state, depth_queue);
+void Renderer::begin_draw(GPU::CommandBuffer& command_buffer, const GraphicsPipeline& pipeline, const RenderQueue& render_queue) {
+	GPU::SetGraphicsPipelineDesc set_pipeline {};
+	set_pipeline.graphics_pipeline = pipeline.handle;
+	command_buffer.add_command(set_pipeline);
 
 	const GPU::Viewport& vp = frame.get_viewport();
 
-	const auto& indices = depth_queue.get_indices();
-	const auto& depth_queue_meshes = depth_queue.get_meshes();
-	for(std::size_t index = 0; index < indices.size(); ++index) {
-		const MeshInstance& instance = depth_queue_meshes[index];
-
-		const IndexedInputBuffer& input_buffer = instance.mesh->get_input_buffer();
-
-		set_instance_state(input_state, instance);
-
-		GPU::DrawDesc draw_desc {};
-		draw_desc.graphics_pipeline = depth_pipeline->handle;
-		draw_desc.pipeline_input_state = input_state;
+	GPU::SetScissorDesc scissor {};
+	scissor.rect = {
+		0,
+		0,
+		static_cast<std::uint32_t>(vp.width),
+		static_cast<std::uint32_t>(vp.height)
+	};
+	command_buffer.add_command(scissor);
 
-		draw_desc.rect = {
-			0,
-			0,
-			static_cast<std::uint32_t>(vp.width),
-			static_cast<std::uint32_t>(vp.height)
-		};
+	set_global_state(command_buffer);
+	set_render_queue_state(command_buffer, render_queue);
+}
 
-		draw_desc.input_buffer = input_buffer.input_buffer;
-		draw_desc.index_buffer = input_buffer.index_buffer;
-		draw_desc.index_buffer_size = input_buffer.index_buffer_size;
-		draw_desc.num_elements = input_buffer.num_indices;
-		draw_desc.num_instances = 1;
-		draw_desc.num_vertex_buffers = 1;
-		draw_desc.vertex_buffer_sizes[0] = input_buffer.vertex_buffer_sizes[0];
-		draw_desc.vertex_buffer_strides[0] = sizeof(Vector3);
+void Renderer::draw_batches(GPU::CommandBuffer& command_buffer, const RenderQueue& render_queue, std::uint32_t num_streams) {
+	const IndexedInputBuffer* current_input = nullptr;
+	for(const MeshBatch& batch : render_queue.get_batches()) {
+		const IndexedInputBuffer& input_buffer = batch.mesh->get_input_buffer();
+		if(&input_buffer != current_input) {
+			set_vertex_input(command_buffer, input_buffer, num_streams);
+			current_input = &input_buffer;
+		}
 
-		command_buffer.add_command(draw_desc);
+		set_batch_state(command_buffer, batch);
+		draw_indexed(command_buffer, input_buffer, batch.num_instances);
 	}
 }
 
-void Renderer::set_global_state(GPU::PipelineInputState& state) {
-	state.types[RendererInputSlot_Transforms] = GPU::PipelineInputGroupType::Buffer;
-	state.input_elements[RendererInputSlot_Transforms].buffer.buffer = transform_buffer.handle;
-	state.input_elements[RendererInputSlot_Transforms].buffer.offset = transform_buffer.offset;
-	state.input_elements[RendererInputSlot_Transforms].buffer.type = GPU::DescriptorType::SRV;
+void Renderer::set_global_state(GPU::CommandBuffer& command_buffer) {
+	set_input_buffer(command_buffer, RendererInputSlot_Transforms, transform_buffer, GPU::DescriptorType::SRV);
 }
 
-void Renderer::set_render_queue_state(GPU::PipelineInputState& state, const RenderQueue& render_queue) {
-	const BufferAllocation& buffer = render_queue.get_buffer();
-
-	state.types[RendererInputSlot_RenderQueueConstants] = GPU::PipelineInputGroupType::Buffer;
-	state.input_elements[RendererInputSlot_RenderQueueConstants].buffer.buffer = buffer.handle;
-	state.input_elements[RendererInputSlot_RenderQueueConstants].buffer.offset = buffer.offset;
-	state.input_elements[RendererInputSlot_RenderQueueConstants].buffer.type = GPU::DescriptorType::CBV;
+void Renderer::set_render_queue_state(GPU::CommandBuffer& command_buffer, const RenderQueue& render_queue) {
+	set_input_buffer(command_buffer, RendererInputSlot_RenderQueueConstants, render_queue.get_buffer(), GPU::DescriptorType::CBV);
+	set_input_buffer(command_buffer, RendererInputSlot_MeshInstances, render_queue.get_instance_buffer(), GPU::DescriptorType::SRV);
 }
 
-void Renderer::set_instance_state(GPU::PipelineInputState& state, const MeshInstance& mesh) {
-	state.types[RendererInputSlot_MeshInstance] = GPU::PipelineInputGroupType::Buffer;
-	state.input_elements[RendererInputSlot_MeshInstance].buffer.buffer = mesh.instance_data.handle;
-	state.input_elements[RendererInputSlot_MeshInstance].buffer.offset = mesh.instance_data.offset;
-	state.input_elements[RendererInputSlot_MeshInstance].buffer.type = GPU::DescriptorType::CBV;
+void Renderer::set_batch_state(GPU::CommandBuffer& command_buffer, const MeshBatch& batch) {
+	GPU::SetInputGroupDesc desc {};
+	desc.slot = RendererInputSlot_DrawConstants;
+	desc.type = GPU::PipelineInputGroupType::Constants;
+	desc.input.constants.values[0] = batch.first_instance;
+	desc.input.constants.values[1] = batch.material ? batch.material->get_constants().index : 0;
+	desc.input.constants.num_values = sizeof(DrawConstants) / sizeof(std::uint32_t);
+	command_buffer.add_command(desc);
 }
 
 void Renderer::copy_frame_data() {
-	GPUBufferAllocator& buffer_allocator = frame.get_buffer_allocator();
-	transform_buffer = buffer_allocator.create_buffer(static_cast<std::uint32_t>(frame_transforms.size() * sizeof(Matrix4x4)), frame_transforms.data());
+	TransformStreams streams;
+	for(std::size_t component = 0; component < TransformComponent_Count; ++component) {
+		streams.components[component] = frame_transform_components[component].data();
+	}
+	frame_transforms.resize(frame_models.size());
+	matrix_transform_batch(streams, frame_models.size(), frame_transforms.data());
 
-	upload_fence = buffer_allocator.flush();
+	const std::uint32_t num_transforms = static_cast<std::uint32_t>(frame_transforms.size());
+	transform_buffer = transform_data.write(frame.get_frame_index(), num_transforms ? frame_transforms.data() : nullptr, std::max(num_transforms, 1u) * sizeof(Matrix4x4));
 }
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <CD/Graphics/Model.hpp>
 #include <CD/Graphics/Frame.hpp>
 #include <CD/Graphics/Scene.hpp>
+#include <CD/Common/TransformBatch.hpp>
 #include <vector>
 
 namespace CD {
@@ -11,7 +12,16 @@ namespace CD {
 struct MeshInstance {
 	const MaterialInstance* material;
 	const Mesh* mesh;
-	BufferAllocation instance_data;
+	std::uint32_t transform_index;
+};
+
+// Instances of the same mesh and material drawn with a single instanced draw. Their transform indices are
+// stored contiguously in the render queue instance buffer, starting at first_instance.
+struct MeshBatch {
+	const MaterialInstance* material;
+	const Mesh* mesh;
+	std::uint32_t first_instance;
+	std::uint32_t num_instances;
 };
 
 enum RenderQueueConsumer : std::uint8_t {
@@ -20,36 +30,40 @@ enum RenderQueueConsumer : std::uint8_t {
 	RenderQueueConsumer_Count
 };
 
+// The queue data and instance buffers are written to the frame's slot of a FrameDataBuffer, draws recorded for a frame
+// stay valid until the batches change. The version changes with the batches and when a buffer is recreated.
 class RenderQueue {
 public:
-	RenderQueue(RenderQueueConsumer);
+	RenderQueue(RenderQueueConsumer, Frame&);
 
-	void setup(GPUBufferAllocator&, const void* queue_data, std::uint32_t num_bytes);
+	void setup(const void* queue_data, std::uint32_t num_bytes);
 	void add_mesh(const MaterialInstance*, const Mesh&, const Matrix4x4&, std::uint32_t transform_index);
 	void build();
-	void reset();
+	void reset(LinearAllocator&);
 
 	const BufferAllocation& get_buffer() const;
-	const std::vector<MeshInstance>& get_meshes() const;
-	const std::vector<std::uint32_t>& get_indices() const;
-
-	const GPU::Signal& get_copy_fence() const;
+	const BufferAllocation& get_instance_buffer() const;
+	const ArenaVector<MeshBatch>& get_batches() const;
+	std::uint64_t get_version() const;
 private:
 	RenderQueueConsumer type;
+	Frame& frame;
 
-	GPUBufferAllocator* buffer_allocator;
+	FrameDataBuffer queue_data;
+	FrameDataBuffer instance_data;
 	BufferAllocation queue_data_buffer;
-	GPU::Signal copy_fence;
+	BufferAllocation instance_buffer;
 
-	std::vector<std::uint32_t> indices;
-	std::vector<MeshInstance> meshes;
-	std::vector<std::uint64_t> sort_keys;
+	std::vector<MeshBatch> previous_batches;
+	std::uint64_t batch_version;
 
-	struct MeshInstanceBuffer {
-		std::uint32_t transform_index;
-		std::uint32_t material_index;
-	};
+	ArenaVector<std::uint32_t> indices;
+	ArenaVector<MeshInstance> meshes;
+	ArenaVector<std::uint64_t> sort_keys;
+	ArenaVector<MeshBatch> batches;
+	ArenaVector<std::uint32_t> instance_transforms;
 
+	void build_batches();
 	std::uint64_t get_sort_key(const Mesh&, float depth, const MaterialInstance*);
 };
 
@@ -70,16 +84,19 @@ public:
 
 	void draw_gbuffer(GPU::CommandBuffer&);
 	void draw_depth(GPU::CommandBuffer&);
+	std::uint64_t get_gbuffer_version() const;
+	std::uint64_t get_depth_version() const;
 private:
 	Frame& frame;
 
 	RenderQueue gbuffer_queue;
 	RenderQueue depth_queue;
 
-	std::vector<const Model*> frame_models;
-	std::vector<Matrix4x4> frame_transforms;
+	ArenaVector<const Model*> frame_models;
+	ArenaVector<float> frame_transform_components[TransformComponent_Count];
+	ArenaVector<Matrix4x4> frame_transforms;
+	FrameDataBuffer transform_data;
 	BufferAllocation transform_buffer;
-	GPU::Signal upload_fence;
 
 	const GraphicsPipeline* gbuffer_pipeline;
 	const GraphicsPipeline* depth_pipeline;
@@ -92,18 +109,38 @@ private:
 		Matrix4x4 view_projection;
 	};
 
+	struct DrawConstants {
+		std::uint32_t first_instance;
+		std::uint32_t material_index;
+	};
+
 	enum RendererInputSlot : std::uint8_t {
 		RendererInputSlot_Transforms,
 		RendererInputSlot_RenderQueueConstants,
-		RendererInputSlot_MeshInstance,
+		RendererInputSlot_MeshInstances,
+		RendererInputSlot_DrawConstants,
 		RendererInputSlot_Count
 	};
 
-	void set_global_state(GPU::PipelineInputState&);
-	void set_render_queue_state(GPU::PipelineInputState&, const RenderQueue&);
-	void set_instance_state(GPU::PipelineInputState&, const MeshInstance&);
+	void begin_draw(GPU::CommandBuffer&, const GraphicsPipeline&, const RenderQueue&);
+	void draw_batches(GPU::CommandBuffer&, const RenderQueue&, std::uint32_t num_streams);
+	void set_global_state(GPU::CommandBuffer&);
+	void set_render_queue_state(GPU::CommandBuffer&, const RenderQueue&);
+	void set_batch_state(GPU::CommandBuffer&, const MeshBatch&);
 
 	void copy_frame_data();
 };
 
+inline std::uint64_t RenderQueue::get_version() const {
+	return batch_version + queue_data.get_generation() + instance_data.get_generation();
+}
+
+inline std::uint64_t Renderer::get_gbuffer_version() const {
+	return gbuffer_queue.get_version() + transform_data.get_generation();
+}
+
+inline std::uint64_t Renderer::get_depth_version() const {
+	return depth_queue.get_version() + transform_data.get_generation();
+}
+
 }
\ No newline at end of file
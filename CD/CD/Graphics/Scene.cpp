@@ -1,4 +1,5 @@
 #include <CD/Graphics/Scene.hpp>
+#include <CD/Common/TransformBatch.hpp>
 
 namespace CD {
 
@@ -36,13 +37,8 @@ const Matrix4x4& Camera::get_inv_view_projection() const {
 }
 
 void Camera::update_transform(const Transform& t) {
-	using namespace DirectX;
-
 	transform = matrix_transform(t);
-
-	XMMATRIX tm = XMLoadFloat4x4(&transform);
-	XMMATRIX inv = XMMatrixInverse(nullptr, tm);
-	XMStoreFloat4x4(&world_to_view, inv);
+	matrix_affine_inverse_batch(&transform, 1, &world_to_view);
 
 	update();
 }
@@ -56,18 +52,17 @@ void Camera::set_parameters(float fov, float ar, float nz, float fz) {
 void Camera::update() {
 	using namespace DirectX;
 
-	XMMATRIX t = XMLoadFloat4x4(&transform);
-	XMMATRIX v = XMLoadFloat4x4(&world_to_view);
 	XMMATRIX p = XMLoadFloat4x4(&perspective);
-
-	XMMATRIX vp = v * p;
-	XMStoreFloat4x4(&view_projection, vp);
-
 	XMMATRIX inv_p = XMMatrixInverse(nullptr, p);
 	XMStoreFloat4x4(&inv_projection, inv_p);
 
-	XMMATRIX inv_vp = inv_p * t;
-	XMStoreFloat4x4(&inv_view_projection, inv_vp);
+	const Matrix4x4 l[] {world_to_view, inv_projection};
+	const Matrix4x4 r[] {perspective, transform};
+	Matrix4x4 products[2];
+	matrix_multiply_batch(l, r, 2, products);
+
+	view_projection = products[0];
+	inv_view_projection = products[1];
 }
 
 Scene::Scene(Frame& frame) :
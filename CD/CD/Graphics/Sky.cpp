@@ -6,7 +6,10 @@ namespace CD {
 
 Sky::Sky(Frame& frame) :
 	frame(frame),
-	texture(nullptr) {
+	texture(nullptr),
+	camera_data(frame.get_device(), Frame::max_latency),
+	camera_buffer(),
+	texture_version() {
 
 	GPU::CompileShaderDesc vs_desc {
 		L"Resources/Shaders/Sky.hlsl",
@@ -24,13 +27,10 @@ Sky::Sky(Frame& frame) :
 	auto vs = compiler.compile_shader(vs_desc);
 	auto ps = compiler.compile_shader(ps_desc);
 
-	GPU::GraphicsPipelineDesc pipeline_desc = GPU::graphics_pipeline_defaults(1, GPU::depth_stencil_defaults(true));
+	GPU::GraphicsPipelineDesc pipeline_desc = GPU::graphics_pipeline_defaults(1);
 
-	pipeline_desc.vs = {vs->GetBufferPointer(), vs->GetBufferSize()};
-	pipeline_desc.ps = {ps->GetBufferPointer(), ps->GetBufferSize()};
-
-	pipeline_desc.depth_stencil.depth_write_mask = GPU::DepthWriteMask::Zero;
-	pipeline_desc.depth_stencil_format = GPU::BufferFormat::D32_FLOAT_S8X24_UINT;
+	pipeline_desc.vs = {vs->bytecode.get(), vs->size};
+	pipeline_desc.ps = {ps->bytecode.get(), ps->size};
 
 	pipeline_desc.render_target_format[0] = GPU::BufferFormat::R8G8B8A8_UNORM;
 
@@ -50,45 +50,57 @@ Sky::~Sky() = default;
 
 void Sky::set_texture(const Texture* sky_texture) {
 	texture = sky_texture;
+	++texture_version;
 
 	GPU::TextureView view = GPU::texture_view_defaults(texture->handle, texture->desc, 0, 0, 0, GPU::TextureViewDimension::TextureCube);
 
 	frame.get_device().update_pipeline_input_list(skybox, GPU::DescriptorType::SRV, &view, 1, 0);
 }
 
-void Sky::render(GPU::CommandBuffer& cb, const Camera& camera) {
+// The camera constants are written to the frame's slot of the camera buffer, so the recorded draw reads them from the
+// same location every time the frame is reused.
+void Sky::update(const Camera& camera) {
 	if(texture) {
-		GPU::PipelineInputState input {};
-		input.num_elements = 2;
-
 		SkyCameraConstants constants = {
 			camera.get_transform(),
 			camera.get_inv_projection()
 		};
-		BufferAllocation constant_buffer = frame.get_buffer_allocator().create_buffer(sizeof(SkyCameraConstants), &constants, false);
-
-		input.types[0] = GPU::PipelineInputGroupType::Buffer;
-		input.input_elements[0].buffer = {constant_buffer.handle, constant_buffer.offset, GPU::DescriptorType::CBV};
-
-		input.types[1] = GPU::PipelineInputGroupType::ResourceList;
-		input.input_elements[1].resource_list = skybox;
+		camera_buffer = camera_data.write(frame.get_frame_index(), &constants, sizeof(SkyCameraConstants));
+	}
+}
 
-		GPU::DrawDesc draw {};
+void Sky::render(GPU::CommandBuffer& cb) {
+	if(texture) {
+		GPU::SetGraphicsPipelineDesc set_pipeline {};
+		set_pipeline.graphics_pipeline = graphics_pipeline->handle;
+		cb.add_command(set_pipeline);
 
 		const GPU::Viewport& vp = frame.get_viewport();
-		draw.rect = {
+
+		GPU::SetScissorDesc scissor {};
+		scissor.rect = {
 			0,
 			0,
 			static_cast<std::uint32_t>(vp.width),
 			static_cast<std::uint32_t>(vp.height)
 		};
+		cb.add_command(scissor);
 
-		draw.graphics_pipeline = graphics_pipeline->handle;
-		draw.pipeline_input_state = input;
+		GPU::SetInputGroupDesc camera_input {};
+		camera_input.slot = 0;
+		camera_input.type = GPU::PipelineInputGroupType::Buffer;
+		camera_input.input.buffer = {camera_buffer.handle, camera_buffer.offset, GPU::DescriptorType::CBV};
+		cb.add_command(camera_input);
 
-		draw.num_instances = 1;
-		draw.num_elements = 3;
+		GPU::SetInputGroupDesc skybox_input {};
+		skybox_input.slot = 1;
+		skybox_input.type = GPU::PipelineInputGroupType::ResourceList;
+		skybox_input.input.resource_list = skybox;
+		cb.add_command(skybox_input);
 
+		GPU::DrawDesc draw {};
+		draw.num_vertices = 3;
+		draw.num_instances = 1;
 		cb.add_command(draw);
 	}
 }
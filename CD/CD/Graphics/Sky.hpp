@@ -2,10 +2,10 @@
 
 #include <CD/Graphics/Common.hpp>
 #include <CD/Graphics/Scene.hpp>
+#include <CD/Graphics/Frame.hpp>
 
 namespace CD {
 
-class Frame;
 
 class Sky {
 public:
@@ -14,13 +14,18 @@ public:
 
 	void set_texture(const Texture*);
 
-	void render(GPU::CommandBuffer&, const Camera&);
+	void update(const Camera&);
+	void render(GPU::CommandBuffer&);
+	std::uint64_t get_version() const;
 private:
 	Frame& frame;
 
 	const Texture* texture;
 	const GraphicsPipeline* graphics_pipeline;
 	GPU::PipelineHandle skybox;
+	FrameDataBuffer camera_data;
+	BufferAllocation camera_buffer;
+	std::uint64_t texture_version;
 
 	struct SkyCameraConstants {
 		Matrix4x4 view;
@@ -28,4 +33,8 @@ private:
 	};
 };
 
+inline std::uint64_t Sky::get_version() const {
+	return texture_version + camera_data.get_generation();
+}
+
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <CD/Graphics/Model.hpp>
 #include <CD/Graphics/Scene.hpp>
 #include <CD/Common/Debug.hpp>
+#include <CD/Common/Profiler.hpp>
+#include <CD/Common/AllocationTracker.hpp>
 #include <CD/Common/Transform.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -22,6 +24,9 @@ ResourceLoader::~ResourceLoader() {
 }
 
 const Texture* ResourceLoader::load_texture2d(const wchar_t* path, GPU::BufferFormat format, GPU::TextureDimension dimension) {
+	CD_PROFILE_SCOPE("ResourceLoader::load_texture2d");
+	CD_MEMORY_TAG(MemoryTag_Loader);
+
 	using namespace DirectX;
 
 	TexMetadata metadata;
@@ -46,7 +51,10 @@ const Texture* ResourceLoader::load_texture2d(const wchar_t* path, GPU::BufferFo
 		}
 	}
 
-	copy_context.flush();
+	{
+		CD_PROFILE_SCOPE("CopyContext::flush");
+		copy_context.flush();
+	}
 
 	return texture.get();
 }
@@ -68,6 +76,9 @@ constexpr std::uint32_t strides[] {
 };
 
 const Model* ResourceLoader::load_model(const char* path, const MaterialInstance& material) {
+	CD_PROFILE_SCOPE("ResourceLoader::load_model");
+	CD_MEMORY_TAG(MemoryTag_Loader);
+
 	Assimp::Importer importer;
 
 	auto scene_model = importer.ReadFile(path, aiPostProcessSteps::aiProcess_CalcTangentSpace | aiPostProcessSteps::aiProcess_Triangulate | aiProcess_MakeLeftHanded | aiProcess_FlipUVs | aiProcess_FlipWindingOrder | aiPostProcessSteps::aiProcess_GenBoundingBoxes);
@@ -2,19 +2,22 @@ struct DepthPassConstants {
 	float4x4 view_projection;
 };
 
-struct MeshInstanceConstants {
-	uint transform_index;
+struct DrawConstants {
+	uint first_instance;
 	uint _;
 };
 
 StructuredBuffer<float4x4> transforms : register(t0, space0);
 
+StructuredBuffer<uint> instance_transforms : register(t1, space0);
+
 ConstantBuffer<DepthPassConstants> depth_constants : register(b0, space0);
 
-ConstantBuffer<MeshInstanceConstants> mesh_constants : register(b1, space0);
+ConstantBuffer<DrawConstants> draw_constants : register(b1, space0);
 
 struct VSIn {
 	float3 position : POSITION;
+	uint instance_id : SV_InstanceID;
 };
 
 struct VSOut {
@@ -22,7 +25,7 @@ struct VSOut {
 };
 
 VSOut vs_main(VSIn input) {
-	const float4x4 transform = transforms[mesh_constants.transform_index];
+	const float4x4 transform = transforms[instance_transforms[draw_constants.first_instance + input.instance_id]];
 	const float4x4 local_to_clip = mul(transform, depth_constants.view_projection);
 
 	VSOut output;
@@ -7,22 +7,25 @@ struct GBufferConstants {
 	float4x4 view_projection;
 };
 
-struct MeshInstanceConstants {
-	uint transform_index;
+struct DrawConstants {
+	uint first_instance;
 	uint material_index;
 };
 
 StructuredBuffer<float4x4> transforms : register(t0, space0);
 
+StructuredBuffer<uint> instance_transforms : register(t1, space0);
+
 ConstantBuffer<GBufferConstants> pass_constants : register(b0, space0);
 
-ConstantBuffer<MeshInstanceConstants> instance_constants : register(b1, space0);
+ConstantBuffer<DrawConstants> draw_constants : register(b1, space0);
 
 struct VSIn {
 	float3 position : POSITION;
 	float3 normal : NORMAL;
 	float3 tangent : TANGENT;
 	float2 uv : UV;
+	uint instance_id : SV_InstanceID;
 };
 
 struct VSOut {
@@ -40,7 +43,7 @@ struct GBuffer {
 };
 
 VSOut vs_main(VSIn input) {
-	const float4x4 transform = transforms[instance_constants.transform_index];
+	const float4x4 transform = transforms[instance_transforms[draw_constants.first_instance + input.instance_id]];
 	const float4x4 local_to_clip = mul(transform, pass_constants.view_projection);
 
 	VSOut output;
@@ -61,7 +64,7 @@ GBuffer ps_main(VSOut input) {
 	output.normal = uint4(normal_tangent_16(normalize(input.normal), normalize(input.tangent).xyz), 0.f);
 	output.uv = input.uv;
 	output.duv = float4(ddx(input.uv), ddy(input.uv));
-	output.material = instance_constants.material_index;
+	output.material = draw_constants.material_index;
 	
 	return output;
 }
\ No newline at end of file
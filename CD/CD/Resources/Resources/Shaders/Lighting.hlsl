@@ -68,9 +68,9 @@ void main(uint3 dt_id : SV_DispatchThreadID) {
 		lighting.lights = lights;
 		lighting.num_lights = parameters.num_lights;
 
-		output_texture[dt_id.xy] = compute_lighting(lighting);
+		output_texture[dt_id.xy] = float4(compute_lighting(lighting).xyz, 1.f);
 	}
 	else {
-		output_texture[dt_id.xy] = float4(1.f, 0.f, 1.f, 1.f);
+		output_texture[dt_id.xy] = 0.f;
 	}
 }
\ No newline at end of file
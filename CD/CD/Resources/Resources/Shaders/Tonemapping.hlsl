@@ -1,4 +1,5 @@
 Texture2D<float4> input : register(t0, space0);
+Texture2D<float4> sky : register(t1, space0);
 RWTexture2D<float4> output : register(u0, space0);
 
 float4 tonemapping_reinhardt(float4 color) {
@@ -7,5 +8,6 @@ float4 tonemapping_reinhardt(float4 color) {
 
 [numthreads(16, 16, 1)]
 void main(uint3 dt_id : SV_DispatchThreadID) {
-	output[dt_id.xy] = tonemapping_reinhardt(input.Load(uint3(dt_id.xy, 0)));
+	const float4 color = input.Load(uint3(dt_id.xy, 0));
+	output[dt_id.xy] = color.a > 0.f ? tonemapping_reinhardt(color) : sky.Load(uint3(dt_id.xy, 0));
 }
\ No newline at end of file
@@ -54,6 +54,7 @@ DeferredTest::DeferredTest() {
 	GPU::CreateDeviceDesc device_desc {};
 	device_desc.swapchain = &swapchain;
 	device_desc.allow_uma = true;
+	device_desc.job_system = &jobs;
 
 	device = nullptr;
 	for(std::uint32_t i = 0; !device && i < factory.get_device_count(); device = factory.create_device(device_desc, i), ++i);
@@ -62,7 +63,11 @@ DeferredTest::DeferredTest() {
 		CD_FAIL("no compatible device found");
 	}
 
-	graphics = std::make_unique<GraphicsManager>(*device, float(width), float(height));
+	capture = std::make_unique<GPU::Capture::Device>(*device);
+
+	graphics = std::make_unique<GraphicsManager>(*capture, float(width), float(height));
+	graphics->get_frame().set_frame_limit(target_frame_ms);
+	graphics->get_frame().set_command_optimization(true);
 
 	resource_loader = std::make_unique<ResourceLoader>(graphics->get_frame());
 
@@ -115,6 +120,9 @@ DeferredTest::DeferredTest() {
 DeferredTest::~DeferredTest() = default;
 
 void DeferredTest::run() {
+	CD_PROFILE_THREAD("Main");
+	Memory::set_steady_state_frame(steady_state_frame);
+
 	CursorPosition pos = window->cursor_position();
 	float pf = 20.f;
 	float rf = 5.f;
@@ -128,6 +136,10 @@ void DeferredTest::run() {
 			window->close();
 		}
 
+		if(window->key_state(Key::F12) == KeyState::Pressed && !capture->is_capturing()) {
+			capture->begin_capture("DeferredTest.capture", 1);
+		}
+
 		Vector3 dp {};
 		Vector2 dr {};
 
@@ -168,6 +180,12 @@ void DeferredTest::run() {
 	}
 
 	graphics->get_frame().wait();
+
+	Profiler::export_chrome_trace("DeferredTest.trace.json");
+
+	std::ofstream frame_report("DeferredTest.frames.txt");
+	graphics->get_frame_statistics().write_report(frame_report);
+	graphics->get_frame().get_gpu_profiler().write_report(frame_report);
 }
 
 int WINAPI wWinMain(HINSTANCE, HINSTANCE, PWSTR, int) {
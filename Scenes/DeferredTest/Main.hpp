@@ -1,14 +1,22 @@
 #pragma once
 
 #include <CD/Loader/Main.hpp>
+#include <CD/Common/AllocationTracker.hpp>
 #include <CD/Common/Clock.hpp>
+#include <CD/Common/JobSystem.hpp>
+#include <CD/Common/Profiler.hpp>
 #include <CD/Common/Window.hpp>
 #include <CD/Loader/ResourceLoader.hpp>
 #include <CD/GPU/D3D12/Factory.hpp>
+#include <CD/GPU/Capture/Device.hpp>
 #include <CD/Graphics/GraphicsManager.hpp>
+#include <fstream>
 
 using namespace CD;
 
+constexpr std::uint32_t steady_state_frame = 120;
+constexpr double target_frame_ms = 1000. / 60.;
+
 class CameraController {
 public:
 	CameraController(Camera&);
@@ -39,11 +47,13 @@ public:
 	void run() final;
 private:
 	Clock clock;
+	JobSystem jobs;
 
 	std::unique_ptr<Window> window;
 
 	GPU::D3D12::Factory factory;
 	GPU::Device* device;
+	std::unique_ptr<GPU::Capture::Device> capture;
 
 	std::unique_ptr<GraphicsManager> graphics;
 
@@ -0,0 +1,55 @@
+#include <CD/GPU/Capture/Replay.hpp>
+#include <CD/GPU/Null/Device.hpp>
+#include <CD/Common/Clock.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace CD;
+
+int main(int argc, char** argv) {
+	if(argc < 2) {
+		std::cerr << "usage: CaptureReplay <capture> [iterations]\n";
+		return 1;
+	}
+
+	const std::uint32_t iterations = argc > 2 ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 100;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if(!file) {
+		std::cerr << "cannot open " << argv[1] << "\n";
+		return 1;
+	}
+
+	GPU::Null::Device device;
+	GPU::Capture::Replay replay(device);
+	if(!replay.load(file)) {
+		std::cerr << argv[1] << " is not a capture of this build\n";
+		return 1;
+	}
+
+	replay.create_resources();
+	replay.reset_statistics();
+
+	Clock clock;
+	for(std::uint32_t i = 0; i < iterations; ++i) {
+		for(std::size_t frame = 0; frame < replay.get_frame_count(); ++frame) {
+			replay.replay_frame(frame);
+		}
+	}
+	const double total_ms = clock.get_elapsed_time_ms();
+
+	const GPU::Capture::ReplayStatistics& stats = replay.get_statistics();
+	const double frames = stats.frames ? static_cast<double>(stats.frames) : 1.;
+
+	std::cout << "frames:           " << stats.frames << "\n";
+	std::cout << "submits/frame:    " << stats.submits / frames << "\n";
+	std::cout << "buffers/frame:    " << stats.command_buffers / frames << "\n";
+	std::cout << "commands/frame:   " << stats.commands / frames << "\n";
+	std::cout << "bytes/frame:      " << stats.command_bytes / frames << "\n";
+	std::cout << "frame ms:         " << total_ms / frames << "\n";
+	std::cout << "submit ms/frame:  " << stats.submit_ms / frames << "\n";
+
+	replay.destroy_resources();
+	return 0;
+}
@@ -0,0 +1,200 @@
+#include <CD/Common/JobSystem.hpp>
+#include <CD/Common/Clock.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace CD;
+
+namespace {
+
+constexpr std::uint32_t parallel_for_count = 4096;
+constexpr std::uint32_t parallel_for_grain = 64;
+constexpr std::uint32_t stage_jobs = 64;
+constexpr std::uint32_t empty_job_batch = 1024;
+constexpr std::uint32_t empty_job_batches = 64;
+
+struct DependencyStages {
+	std::atomic<std::uint32_t> first;
+	std::atomic<std::uint32_t> second;
+	std::atomic<std::uint32_t> failures;
+};
+
+struct BenchmarkResult {
+	double parallel_for_us;
+	double dependency_us;
+	double empty_jobs_per_second;
+	std::uint32_t failures;
+};
+
+// parallel_for waits on a counter on its stack, the counter is destroyed as soon as the wait returns. A job that
+// still touches it after the last decrement shows up here under ThreadSanitizer or as a wrong sum.
+std::uint32_t run_parallel_for(JobSystem& job_system) {
+	std::atomic<std::uint64_t> sum {};
+	job_system.parallel_for(0, parallel_for_count, parallel_for_grain, [&sum](std::uint32_t begin, std::uint32_t end) {
+		std::uint64_t partial = 0;
+		for(std::uint32_t i = begin; i < end; ++i) {
+			partial += i;
+		}
+		sum.fetch_add(partial, std::memory_order_relaxed);
+	});
+
+	const std::uint64_t expected = static_cast<std::uint64_t>(parallel_for_count) * (parallel_for_count - 1) / 2;
+	return sum.load() == expected ? 0 : 1;
+}
+
+// Three stages on stack counters, the second parked on the first and the third on the second. Every job checks
+// that the stage it depends on has finished.
+std::uint32_t run_dependencies(JobSystem& job_system, std::uint32_t num_jobs) {
+	DependencyStages stages {};
+
+	JobDesc first[stage_jobs];
+	JobDesc second[stage_jobs];
+	JobDesc third[stage_jobs];
+	for(std::uint32_t i = 0; i < num_jobs; ++i) {
+		first[i] = {[](void* data, std::uint32_t, std::uint32_t) {
+			static_cast<DependencyStages*>(data)->first.fetch_add(1);
+		}, &stages, 0, 1};
+
+		second[i] = {[](void* data, std::uint32_t, std::uint32_t) {
+			DependencyStages& stages = *static_cast<DependencyStages*>(data);
+			if(stages.first.load() != stage_jobs) {
+				stages.failures.fetch_add(1);
+			}
+			stages.second.fetch_add(1);
+		}, &stages, 0, 1};
+
+		third[i] = {[](void* data, std::uint32_t, std::uint32_t) {
+			DependencyStages& stages = *static_cast<DependencyStages*>(data);
+			if(stages.second.load() != stage_jobs) {
+				stages.failures.fetch_add(1);
+			}
+		}, &stages, 0, 1};
+	}
+
+	JobCounter first_done;
+	JobCounter second_done;
+	JobCounter third_done;
+	job_system.run(first, num_jobs, &first_done);
+	job_system.run(second, num_jobs, &second_done, &first_done);
+	job_system.run(third, num_jobs, &third_done, &second_done);
+
+	job_system.wait(third_done);
+	job_system.wait(second_done);
+	job_system.wait(first_done);
+
+	return stages.failures.load();
+}
+
+// More dependent jobs than the waiting pool holds, the jobs that do not fit wait for the dependency before they
+// are pushed.
+std::uint32_t run_waiting_overflow(JobSystem& job_system) {
+	static JobDesc dependents[max_waiting_jobs + 256];
+	DependencyStages stages {};
+
+	JobDesc slow {[](void* data, std::uint32_t, std::uint32_t) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		static_cast<DependencyStages*>(data)->first.store(stage_jobs);
+	}, &stages, 0, 1};
+
+	for(JobDesc& dependent : dependents) {
+		dependent = {[](void* data, std::uint32_t, std::uint32_t) {
+			DependencyStages& stages = *static_cast<DependencyStages*>(data);
+			if(stages.first.load() != stage_jobs) {
+				stages.failures.fetch_add(1);
+			}
+		}, &stages, 0, 1};
+	}
+
+	JobCounter slow_done;
+	JobCounter dependents_done;
+	job_system.run(&slow, 1, &slow_done);
+	job_system.run(dependents, static_cast<std::uint32_t>(std::size(dependents)), &dependents_done, &slow_done);
+	job_system.wait(dependents_done);
+	job_system.wait(slow_done);
+
+	return stages.failures.load();
+}
+
+double run_empty_jobs(JobSystem& job_system) {
+	static JobDesc jobs[empty_job_batch];
+	for(JobDesc& job : jobs) {
+		job = {[](void*, std::uint32_t, std::uint32_t) {}, nullptr, 0, 1};
+	}
+
+	Clock clock;
+	for(std::uint32_t batch = 0; batch < empty_job_batches; ++batch) {
+		JobCounter counter;
+		job_system.run(jobs, empty_job_batch, &counter);
+		job_system.wait(counter);
+	}
+	const double elapsed_ms = clock.get_elapsed_time_ms();
+
+	return static_cast<double>(empty_job_batch) * empty_job_batches / (elapsed_ms / 1000.);
+}
+
+BenchmarkResult run_benchmark(std::uint32_t num_threads, std::uint32_t iterations) {
+	JobSystem job_system(num_threads - 1);
+	BenchmarkResult result {};
+
+	Clock parallel_for_clock;
+	for(std::uint32_t i = 0; i < iterations; ++i) {
+		result.failures += run_parallel_for(job_system);
+	}
+	result.parallel_for_us = parallel_for_clock.get_elapsed_time_ms() * 1000. / iterations;
+
+	Clock dependency_clock;
+	for(std::uint32_t i = 0; i < iterations; ++i) {
+		result.failures += run_dependencies(job_system, stage_jobs);
+	}
+	result.dependency_us = dependency_clock.get_elapsed_time_ms() * 1000. / iterations;
+
+	result.failures += run_waiting_overflow(job_system);
+	result.empty_jobs_per_second = run_empty_jobs(job_system);
+
+	return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+	std::uint32_t max_threads = argc > 1 ? static_cast<std::uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 0;
+	const std::uint32_t iterations = argc > 2 ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000;
+
+	if(!max_threads) {
+		max_threads = std::max(std::thread::hardware_concurrency(), 2u);
+	}
+	max_threads = std::min(max_threads, max_job_workers);
+
+	if(!iterations) {
+		std::cerr << "usage: JobSystemBenchmark [threads, 0 for all] [iterations]\n";
+		return 1;
+	}
+
+	std::cout << std::setw(8) << "threads" << std::setw(18) << "parallel_for us" << std::setw(18) << "dependencies us" << std::setw(16) << "empty jobs/s" << "\n";
+
+	std::uint32_t failures = 0;
+	for(std::uint32_t num_threads = 1;; num_threads = std::min(num_threads * 2, max_threads)) {
+		BenchmarkResult result = run_benchmark(num_threads, iterations);
+		failures += result.failures;
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(8) << num_threads
+			<< std::setw(18) << result.parallel_for_us
+			<< std::setw(18) << result.dependency_us
+			<< std::setw(16) << static_cast<std::uint64_t>(result.empty_jobs_per_second) << "\n";
+
+		if(num_threads == max_threads) {
+			break;
+		}
+	}
+
+	if(failures) {
+		std::cerr << failures << " failed checks\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include <CD/GPU/Null/Device.hpp>
+#include <CD/Common/Clock.hpp>
+#ifdef CD_RESOURCE_STRESS_D3D12
+#include <CD/GPU/D3D12/Factory.hpp>
+#endif
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace CD;
+
+namespace {
+
+constexpr std::uint32_t live_resources = 64;
+
+// Keeps a window of live buffers and textures per thread, every iteration creates one of each and destroys the
+// oldest pair once the window is full.
+void stress_device(GPU::Device& device, std::uint32_t iterations) {
+	GPU::BufferDesc buffer_desc {};
+	buffer_desc.size = 256;
+	buffer_desc.storage = GPU::BufferStorage::Device;
+	buffer_desc.flags = GPU::BindFlags_ShaderResource;
+
+	GPU::TextureDesc texture_desc {};
+	texture_desc.width = 16;
+	texture_desc.height = 16;
+	texture_desc.depth = 1;
+	texture_desc.mip_levels = 1;
+	texture_desc.sample_count = 1;
+	texture_desc.format = GPU::BufferFormat::R16G16B16A16_FLOAT;
+	texture_desc.dimension = GPU::TextureDimension::Texture2D;
+	texture_desc.flags = static_cast<GPU::BindFlags>(GPU::BindFlags_ShaderResource | GPU::BindFlags_RenderTarget);
+
+	GPU::BufferHandle buffers[live_resources] {};
+	GPU::TextureHandle textures[live_resources] {};
+
+	for(std::uint32_t i = 0; i < iterations; ++i) {
+		const std::uint32_t slot = i % live_resources;
+		if(i >= live_resources) {
+			device.destroy_buffer(buffers[slot]);
+			device.destroy_texture(textures[slot]);
+		}
+		buffers[slot] = device.create_buffer(buffer_desc);
+		textures[slot] = device.create_texture(texture_desc);
+	}
+
+	for(std::uint32_t i = 0; i < live_resources && i < iterations; ++i) {
+		device.destroy_buffer(buffers[i]);
+		device.destroy_texture(textures[i]);
+	}
+}
+
+}
+
+int main(int argc, char** argv) {
+	const std::uint32_t max_threads = argc > 1 ? static_cast<std::uint32_t>(std::strtoul(argv[1], nullptr, 10)) : std::thread::hardware_concurrency();
+	const std::uint32_t iterations = argc > 2 ? static_cast<std::uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 100000;
+	const bool use_d3d12 = argc > 3 && !std::strcmp(argv[3], "d3d12");
+
+	if(!max_threads || !iterations) {
+		std::cerr << "usage: ResourceStress [threads] [iterations per thread] [null|d3d12]\n";
+		return 1;
+	}
+
+	std::unique_ptr<GPU::Device> null_device;
+	GPU::Device* device = nullptr;
+#ifdef CD_RESOURCE_STRESS_D3D12
+	GPU::D3D12::Factory factory;
+	if(use_d3d12) {
+		GPU::CreateDeviceDesc desc {};
+		device = factory.create_device(desc, 0);
+	}
+#else
+	if(use_d3d12) {
+		std::cerr << "the D3D12 device is not available in this build\n";
+		return 1;
+	}
+#endif
+	if(!device) {
+		null_device = std::make_unique<GPU::Null::Device>();
+		device = null_device.get();
+	}
+
+	std::cout << std::setw(8) << "threads" << std::setw(20) << "create+destroy/s" << std::setw(10) << "scaling" << "\n";
+	double single_thread_rate = 0.;
+	for(std::uint32_t num_threads = 1;; num_threads = std::min(num_threads * 2, max_threads)) {
+		std::vector<std::thread> threads;
+		threads.reserve(num_threads);
+
+		Clock clock;
+		for(std::uint32_t i = 0; i < num_threads; ++i) {
+			threads.emplace_back(stress_device, std::ref(*device), iterations);
+		}
+		for(std::thread& thread : threads) {
+			thread.join();
+		}
+		const double elapsed_ms = clock.get_elapsed_time_ms();
+
+		const double rate = 2. * num_threads * iterations / (elapsed_ms / 1000.);
+		if(num_threads == 1) {
+			single_thread_rate = rate;
+		}
+		std::cout << std::setw(8) << num_threads << std::setw(20) << static_cast<std::uint64_t>(rate) << std::setw(9) << std::setprecision(3) << rate / single_thread_rate << "x\n";
+
+		if(num_threads == max_threads) {
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include <CD/Common/TransformBatch.hpp>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace CD;
+
+namespace {
+
+constexpr float tolerance = 1e-4f;
+
+// Batch sizes around the 4 and 8 wide SIMD steps, so every tail length is covered for both paths.
+constexpr std::size_t batch_sizes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 13, 15, 16, 17, 23, 31, 33, 127, 1021};
+
+// The streams start one element into their arrays so no path can rely on aligned input.
+constexpr std::size_t stream_offset = 1;
+
+constexpr float canary = 12345.f;
+
+const char* path_name(TransformBatchPath path) {
+	switch(path) {
+	case TransformBatchPath::Scalar:
+		return "scalar";
+	case TransformBatchPath::SSE:
+		return "SSE";
+	case TransformBatchPath::AVX2:
+		return "AVX2";
+	}
+	return "unknown";
+}
+
+bool matrices_equal(const Matrix4x4& a, const Matrix4x4& b) {
+	for(std::size_t row = 0; row < 4; ++row) {
+		for(std::size_t column = 0; column < 4; ++column) {
+			float x = a.m[row][column];
+			float y = b.m[row][column];
+			if(std::fabs(x - y) > tolerance * std::fmax(1.f, std::fmax(std::fabs(x), std::fabs(y)))) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void fill_canary(std::vector<Matrix4x4>& matrices) {
+	for(Matrix4x4& matrix : matrices) {
+		for(auto& row : matrix.m) {
+			for(float& value : row) {
+				value = canary;
+			}
+		}
+	}
+}
+
+// Compares the first count outputs with the scalar results and checks that nothing around them was written.
+std::size_t compare(const char* function, TransformBatchPath path, std::size_t count, const Matrix4x4* expected, const std::vector<Matrix4x4>& actual) {
+	std::size_t failures = 0;
+	for(std::size_t i = 0; i < actual.size(); ++i) {
+		bool inside = i >= stream_offset && i - stream_offset < count;
+		bool valid = inside ? matrices_equal(expected[i - stream_offset], actual[i]) : actual[i].m[0][0] == canary && actual[i].m[3][3] == canary;
+		if(!valid) {
+			if(!failures) {
+				std::cerr << function << " " << path_name(path) << ": count " << count << (inside ? " differs from scalar at " : " wrote outside the batch at ") << static_cast<std::ptrdiff_t>(i) - static_cast<std::ptrdiff_t>(stream_offset) << "\n";
+			}
+			++failures;
+		}
+	}
+	return failures;
+}
+
+}
+
+int main() {
+	const TransformBatchPath detected = transform_batch_path();
+	const std::size_t max_count = batch_sizes[std::size(batch_sizes) - 1];
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::uniform_real_distribution<float> scale(.1f, 4.f);
+
+	std::vector<float> streams[TransformComponent_Count];
+	for(auto& stream : streams) {
+		stream.resize(max_count + stream_offset);
+	}
+	for(std::size_t i = 0; i < max_count + stream_offset; ++i) {
+		float q[4] = {unit(rng), unit(rng), unit(rng), unit(rng)};
+		float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		for(std::size_t c = 0; c < 4; ++c) {
+			streams[TransformComponent_OrientationX + c][i] = length > 1e-3f ? q[c] / length : (c == 3 ? 1.f : 0.f);
+		}
+		for(std::size_t c = 0; c < 3; ++c) {
+			streams[TransformComponent_PositionX + c][i] = unit(rng) * 100.f;
+			streams[TransformComponent_ScaleX + c][i] = scale(rng);
+		}
+	}
+
+	TransformStreams input {};
+	for(std::size_t c = 0; c < TransformComponent_Count; ++c) {
+		input.components[c] = streams[c].data() + stream_offset;
+	}
+
+	std::vector<Matrix4x4> world(max_count + stream_offset);
+	matrix_transform_batch_scalar(input, max_count, world.data() + stream_offset);
+	const Matrix4x4* matrices = world.data() + stream_offset;
+	const Matrix4x4* reversed = world.data();
+
+	std::vector<Matrix4x4> expected(max_count);
+	std::vector<Matrix4x4> actual(max_count + 2 * stream_offset);
+	Matrix4x4* output = actual.data() + stream_offset;
+
+	std::size_t failures = 0;
+	std::size_t checked_paths = 0;
+	for(auto path : {TransformBatchPath::SSE, TransformBatchPath::AVX2}) {
+		if(path > detected) {
+			std::cout << path_name(path) << ": not supported, skipped\n";
+			continue;
+		}
+		set_transform_batch_path(path);
+		++checked_paths;
+
+		for(std::size_t count : batch_sizes) {
+			matrix_transform_batch_scalar(input, count, expected.data());
+			fill_canary(actual);
+			matrix_transform_batch(input, count, output);
+			failures += compare("matrix_transform_batch", path, count, expected.data(), actual);
+
+			matrix_affine_inverse_batch_scalar(matrices, count, expected.data());
+			fill_canary(actual);
+			matrix_affine_inverse_batch(matrices, count, output);
+			failures += compare("matrix_affine_inverse_batch", path, count, expected.data(), actual);
+
+			matrix_multiply_batch_scalar(matrices, reversed, count, expected.data());
+			fill_canary(actual);
+			matrix_multiply_batch(matrices, reversed, count, output);
+			failures += compare("matrix_multiply_batch", path, count, expected.data(), actual);
+		}
+		std::cout << path_name(path) << ": checked against scalar\n";
+	}
+	set_transform_batch_path(detected);
+
+	if(failures) {
+		std::cerr << failures << " matrices differ from the scalar path\n";
+		return 1;
+	}
+	if(!checked_paths) {
+		std::cout << "no SIMD path on this target\n";
+	}
+	return 0;
+}